@@ -1,20 +1,21 @@
 #include "Trig.glsl"
+#include "Precision.glsl"
 
 bool sameHemisphere(vec3 w, vec3 wp) {
     return w.z * wp.z > 0.0f;
 }
 
 
-vec3 schlickF0FromRelativeIOR(float eta) {
+color3 schlickF0FromRelativeIOR(float eta) {
     float a = (1.0 - eta) / (1.0 + eta);
-    return vec3(a * a);
+    return color3(a * a);
 }
 
-vec3 Fr_Schlick(float cosThetaI, vec3 f0) {
-    float a = max(0.0f, 1.0f - cosThetaI);
-    float a2 = a * a;
-    float a5 = a2 * a2 * a;
-    return f0 + (vec3(1.0f) - f0) * a5;
+color3 Fr_Schlick(float cosThetaI, color3 f0) {
+    colorScalar a = colorScalar(max(0.0f, 1.0f - cosThetaI));
+    colorScalar a2 = a * a;
+    colorScalar a5 = a2 * a2 * a;
+    return f0 + (color3(1.0f) - f0) * a5;
 }
 
 float D_GGX(vec3 wh, float alpha) {
@@ -55,15 +56,15 @@ float G2_None(vec3 wi, vec3 wo, float alpha) {
 
 
 // BxDF functions
-vec3 diffuse_Lambert(vec3 wi, vec3 wo, vec3 diffuseColor) {
+color3 diffuse_Lambert(vec3 wi, vec3 wo, color3 diffuseColor) {
     if (!sameHemisphere(wi, wo)) {
-        return vec3(0.0f);
+        return color3(0.0f);
     }
 
-    return diffuseColor * M_ONE_OVER_PI;
+    return diffuseColor * colorScalar(M_ONE_OVER_PI);
 }
 
-vec3 microfacetReflection_GGX(vec3 wi, vec3 wo, vec3 f0, float eta, float alpha) {
+vec3 microfacetReflection_GGX(vec3 wi, vec3 wo, color3 f0, float eta, float alpha) {
     if (!sameHemisphere(wi, wo) || cosTheta(wi) == 0.0f || cosTheta(wo) == 0.0f) {
         return vec3(0.0f);
     }
@@ -74,11 +75,11 @@ vec3 microfacetReflection_GGX(vec3 wi, vec3 wo, vec3 f0, float eta, float alpha)
     }
     wh = normalize(wh);
 
-    vec3 F;
+    color3 F;
     if (eta < 1.0f) {
         float cosThetaT = dot(wi, wh);
         float cos2ThetaT = cosThetaT * cosThetaT;
-        F = cos2ThetaT > 0.0f ? Fr_Schlick(abs(cosThetaT), f0) : vec3(1.0f);
+        F = cos2ThetaT > 0.0f ? Fr_Schlick(abs(cosThetaT), f0) : color3(1.0f);
     }
     else {
         F = Fr_Schlick(abs(dot(wh, wo)), f0);
@@ -86,10 +87,10 @@ vec3 microfacetReflection_GGX(vec3 wi, vec3 wo, vec3 f0, float eta, float alpha)
 
     float G = G2_SmithHeightCorrelated_GGX(wi, wo, alpha);
     float D = D_GGX(wh, alpha);
-    return F * G * D / (4.0f * abs(cosTheta(wi)) * abs(cosTheta(wo)));
+    return vec3(F) * (G * D / (4.0f * abs(cosTheta(wi)) * abs(cosTheta(wo))));
 }
 
-vec3 microfacetTransmission_GGX(vec3 wi, vec3 wo, vec3 f0, float eta, float alpha) {
+vec3 microfacetTransmission_GGX(vec3 wi, vec3 wo, color3 f0, float eta, float alpha) {
     if (sameHemisphere(wi, wo) || cosTheta(wi) == 0.0f || cosTheta(wo) == 0.0f) {
         return vec3(0.0f);
     }
@@ -104,11 +105,11 @@ vec3 microfacetTransmission_GGX(vec3 wi, vec3 wo, vec3 f0, float eta, float alph
         return vec3(0.0f);
     }
 
-    vec3 F;
+    color3 F;
     if (eta < 1.0f) {
         float cosThetaT = dot(wi, wh);
         float cos2ThetaT = cosThetaT * cosThetaT;
-        F = cos2ThetaT > 0.0f ? Fr_Schlick(abs(cosThetaT), f0) : vec3(1.0f);
+        F = cos2ThetaT > 0.0f ? Fr_Schlick(abs(cosThetaT), f0) : color3(1.0f);
     }
     else {
         F = Fr_Schlick(abs(dot(wh, wo)), f0);
@@ -117,8 +118,8 @@ vec3 microfacetTransmission_GGX(vec3 wi, vec3 wo, vec3 f0, float eta, float alph
     float G = G2_SmithHeightCorrelated_GGX(wi, wo, alpha);
     float D = D_GGX(wh, alpha);
     float denomSqrt = dot(wi, wh) + eta * dot(wo, wh);
-    return (vec3(1.0f) - F) * D * G * abs(dot(wi, wh)) * abs(dot(wo, wh))
-        / (denomSqrt * denomSqrt * abs(cosTheta(wi)) * abs(cosTheta(wo)));
+    return vec3(color3(1.0f) - F) * (D * G * abs(dot(wi, wh)) * abs(dot(wo, wh))
+        / (denomSqrt * denomSqrt * abs(cosTheta(wi)) * abs(cosTheta(wo))));
 }
 
 
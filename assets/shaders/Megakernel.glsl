@@ -0,0 +1,108 @@
+// The megakernel, shared by tracer.comp and tracer_rayquery.comp which only differ in the traversal. The
+// including file declares the version and extensions.
+#include "Structs.glsl"
+#include "Scatter.glsl"
+#include "Frame.glsl"
+
+layout (local_size_x_id = 0, local_size_y_id = 1) in;
+layout (binding = 0, rgba16f) uniform writeonly image2D resultImage;
+layout (binding = 1, rgba32f) uniform image2D accumulationImage;
+layout (binding = 2) readonly uniform UniformBufferObjectStruct { RayGenUBO Camera; };
+
+layout (std430, binding = 3) readonly buffer VertexBuffer { Vertex vertices[]; };
+layout (std430, binding = 4) readonly buffer IndexBuffer { uint indices[]; };
+layout (std430, binding = 5) readonly buffer TriBuffer { Tri triangles[]; };
+layout (std430, binding = 6) readonly buffer BVHNodeBuffer { BVHNode bvhNodes[]; };
+layout (std430, binding = 7) readonly buffer NormalBuffer { Normal normals[]; };
+layout (std430, binding = 8) readonly buffer MaterialBuffer { Material materials[]; };
+layout (std430, binding = 13) buffer TraceStatisticsBuffer
+{
+	// 64 bit totals as a low and a high word each
+	uint busyLaneSteps; uint busyLaneStepsHigh;
+	uint laneSteps; uint laneStepsHigh;
+	uint rayCount; uint rayCountHigh;
+	uint workCounter;
+};
+// triangle + 1 seen through each pixel by the first sample of the dispatch, 0 for none (VisibilityPass)
+layout (binding = 16, r32ui) uniform readonly uimage2D visibilityImage;
+
+// the ray query tracer (tracer_rayquery.comp) walks the hardware acceleration structure instead
+#ifdef RAY_QUERY
+#include "RayQueryTraversal.glsl"
+#include "Triangle.glsl"
+#else
+#include "SceneTraversal.glsl"
+#endif
+
+#include "Surface.glsl"
+#include "PathTrace.glsl"
+
+// The first bounce of a path from the visibility buffer. The raster pass drew the scene with the jitter of the
+// dispatch's first sample, so the pixel's ray only has to be intersected with the triangle it found there.
+// Where the two disagree, on an edge the rasterizer rounded differently or a silhouette whose centre it
+// missed, the ray is traced as usual.
+bool extendPrimaryPath(inout Path path, in uvec2 pixel)
+{
+	uint visible = imageLoad(visibilityImage, ivec2(pixel)).r;
+
+	Intersection isect;
+	isect.t_hit = 1e30f;
+	bool hit = false;
+	if(visible != 0)
+	{
+		vec3 v0, v1, v2;
+		isect.objIdx = visible - 1;
+		triangleVertices(isect.objIdx, v0, v1, v2);
+		hit = IntersectTriangle(path.ray, v0, v1, v2, isect);
+	}
+	hit = hit || IntersectBVH(path.ray, isect);
+
+	return shadeHit(path, hit, isect);
+}
+
+// Every other bit of x, the inverse of interleaving.
+uint compactBits(uint x)
+{
+	x &= 0x55555555u;
+	x = (x | (x >> 1)) & 0x33333333u;
+	x = (x | (x >> 2)) & 0x0f0f0f0fu;
+	x = (x | (x >> 4)) & 0x00ff00ffu;
+	x = (x | (x >> 8)) & 0x0000ffffu;
+	return x;
+}
+
+// Position in the tile. With Morton order the workgroups are 1D and the dispatch is laid out in blocks
+// of sqrt(local_size_x) pixels square, consecutive lanes stay close in both directions.
+uvec2 tilePixel()
+{
+	if(!MORTON_ORDER) return gl_GlobalInvocationID.xy;
+
+	uint blockSize = 1u << (findMSB(gl_WorkGroupSize.x) / 2);
+	uint lane = gl_LocalInvocationIndex;
+	return gl_WorkGroupID.xy * blockSize + uvec2(compactBits(lane), compactBits(lane >> 1));
+}
+
+void main()
+{
+	uvec2 position = tilePixel();
+	if(position.x >= tileExtent.x || position.y >= tileExtent.y) return;
+	uvec2 pixel = tileOffset + position;
+
+	vec4 samples = vec4(0.0);
+	uint steps = 0;
+	for(uint s = 0; s < samplesPerDispatch; s++)
+	{
+		Path path = startPath(pixel, sampleIndex(Camera.firstSample, s));
+		steps++;
+		bool extending = VISIBILITY_BUFFER && s == 0 ? extendPrimaryPath(path, pixel) : extendPath(path);
+		while(extending)
+		{
+			steps++;
+			extending = extendPath(path);
+		}
+		samples += sampleValue(path.throughput);
+	}
+
+	reportLaneUsage(steps);
+	accumulateSamples(ivec2(pixel), samples);
+}
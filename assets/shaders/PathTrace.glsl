@@ -0,0 +1,116 @@
+// A megakernel path, advanced one bounce at a time. tracer.comp runs each path to the end, the persistent
+// variant starts a new path on a lane as soon as its previous one has terminated.
+
+struct Path
+{
+	Ray ray;
+	vec3 throughput;
+	uint bounce;
+	uint seed;
+};
+
+Path startPath(in uvec2 pixel, in uint index)
+{
+	Path path;
+	uint pixelSeed = WangHash(index);
+	vec2 pixelOffset = vec2(RandomFloat(pixelSeed), RandomFloat(pixelSeed));
+	path.seed = randSeed(ivec2(pixel), index);
+	getPrimaryRay(pixel.x, pixel.y, pixelOffset, Camera, path.ray);
+	path.throughput = vec3(1.0);
+	path.bounce = 0;
+	return path;
+}
+
+// Continues the path at the hit of its ray, or ends it in the environment if there is none. Returns false
+// once the path has terminated, its throughput is then the sample.
+bool shadeHit(inout Path path, in bool hit, in Intersection isect)
+{
+	if(!hit)
+	{
+		path.throughput *= Camera.environment.rgb;
+		return false;
+	}
+
+	SurfaceInteraction inter;
+	getSurfaceProperties(inter, isect);
+	Frame surf = setFromUp(inter.normal);
+
+	vec3 hitColor = inter.mat.albedo;
+
+	float rrProb = 1.0;
+	if(path.bounce >= ROULETTE_START)
+	{
+		rrProb = clamp(max(max(path.throughput.x, path.throughput.y), path.throughput.z), 0.05, 0.95);
+		float rr = RandomFloat(path.seed);
+		if(rr > rrProb)
+		{
+			path.throughput *= vec3(0.0);
+			return false;
+		}
+	}
+	if(inter.mat.emission > 0.0)
+	{
+		path.throughput *= hitColor * inter.mat.emission;
+		return false;
+	}
+	Mat mat;
+	mat.baseColor_ = hitColor;
+	mat.roughness_ = inter.mat.roughness;
+	mat.metalness_ = inter.mat.metalness;
+	mat.transmission_ = inter.mat.transmission;
+	mat.ior_ = inter.mat.ior;
+	mat.emittance_ = vec3(0.0);
+	mat.alpha_ = max(MIN_ALPHA, mat.roughness_ * mat.roughness_);
+
+	float pdf;
+	vec3 wi = sampleDirection(path.seed, mat, ToLocal(surf, -path.ray.direction), pdf);
+	float cosThetaI = abs(cosTheta(wi));
+	if (cosThetaI <= 0.0f || pdf <= 0.0f) {
+		return false;
+	}
+	vec3 bsdf = evaluate(mat, wi, ToLocal(surf, -path.ray.direction));
+	path.throughput *= (bsdf * cosThetaI)/(rrProb*pdf);
+	path.ray = getRay(rayPnt(path.ray, isect.t_hit) + sign(cosTheta(wi)) * inter.normal * 0.001f , ToWorld(surf,wi));
+	return ++path.bounce < MAX_BOUNCES;
+}
+
+// Traces the next bounce.
+bool extendPath(inout Path path)
+{
+	Intersection isect;
+	isect.t_hit = 1e30f;
+	bool hit = IntersectBVH(path.ray, isect);
+	return shadeHit(path, hit, isect);
+}
+
+// Clamped like a single sample, alpha counts the samples.
+vec4 sampleValue(in vec3 value)
+{
+	return min(vec4(value, 1.0), SAMPLE_CLAMP);
+}
+
+// The only accumulation image access of a dispatch, however many samples it traced.
+void accumulateSamples(in ivec2 pixel, in vec4 samples)
+{
+	vec4 accumulated = clearAccumulation != 0 ? vec4(0.0) : imageLoad(accumulationImage, pixel);
+	accumulated += samples;
+	imageStore(accumulationImage, pixel, accumulated);
+	imageStore(resultImage, pixel, accumulated/accumulated.a);
+}
+
+// Every lane of a subgroup is issued for as many steps as its busiest lane, the rest of that time it idles.
+// Each step traces one ray. A large image with many samples and bounces overflows 32 bit totals, the lane
+// whose add wraps the low word carries into the high one.
+#define ADD_WIDE(low, high, value) if(atomicAdd(low, value) > ~0u - (value)) atomicAdd(high, 1u)
+
+void reportLaneUsage(in uint steps)
+{
+	uint busy = subgroupAdd(steps);
+	uint issued = subgroupMax(steps) * gl_SubgroupSize;
+	if(subgroupElect())
+	{
+		ADD_WIDE(busyLaneSteps, busyLaneStepsHigh, busy);
+		ADD_WIDE(laneSteps, laneStepsHigh, issued);
+		ADD_WIDE(rayCount, rayCountHigh, busy);
+	}
+}
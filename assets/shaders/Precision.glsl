@@ -0,0 +1,11 @@
+// Precision of the BSDF's colour terms. The *_fp16 kernels define BSDF_FP16 and enable
+// GL_EXT_shader_explicit_arithmetic_types_float16, the colours, Fresnel terms and lobe weights are then half
+// floats. Directions, the microfacet distribution and the pdfs stay 32 bit: at the GGX roughness floor alpha^2
+// is below the half float range, and D alone overflows it for near specular lobes.
+#ifdef BSDF_FP16
+#define color3 f16vec3
+#define colorScalar float16_t
+#else
+#define color3 vec3
+#define colorScalar float
+#endif
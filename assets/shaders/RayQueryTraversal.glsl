@@ -0,0 +1,26 @@
+// IntersectBVH of SceneTraversal.glsl on the hardware acceleration structure (SceneAccelerationStructure).
+// Primitive i of its single geometry is triangles[primitiveTriangles[i]], and the barycentrics weight the
+// second and third vertex like IntersectTriangle's, so the hit reads the scene arrays the same way.
+layout (binding = 15) uniform accelerationStructureEXT sceneStructure;
+layout (std430, binding = 17) readonly buffer TriangleMapBuffer { uint primitiveTriangles[]; };
+
+bool IntersectBVH(in Ray ray, inout Intersection isect)
+{
+	rayQueryEXT query;
+	// both faces are hit, the instance disables culling
+	rayQueryInitializeEXT(query, sceneStructure, gl_RayFlagsOpaqueEXT, 0xFF, ray.origin, 0.0, ray.direction, isect.t_hit);
+	// opaque geometry commits its hits itself, proceed only returns false
+	while(rayQueryProceedEXT(query))
+	{
+	}
+
+	if(rayQueryGetIntersectionTypeEXT(query, true) != gl_RayQueryCommittedIntersectionTriangleEXT)
+	{
+		return false;
+	}
+
+	isect.t_hit = rayQueryGetIntersectionTEXT(query, true);
+	isect.objIdx = primitiveTriangles[rayQueryGetIntersectionPrimitiveIndexEXT(query, true)];
+	isect.barycentric = rayQueryGetIntersectionBarycentricsEXT(query, true);
+	return true;
+}
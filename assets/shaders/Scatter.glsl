@@ -24,16 +24,16 @@ float computeRelativeIOR(in Mat mat, in vec3 wo) {
 
 void computeLobeProbabilities(in Mat mat, in vec3 wo, out float pDiffuse, out float pSpecular, out float pTransmission) {
     float eta = computeRelativeIOR(mat, wo);
-    vec3 f0 = mix(schlickF0FromRelativeIOR(eta), mat.baseColor_, mat.metalness_);
-    vec3 fresnel = Fr_Schlick(abs(cosTheta(wo)), f0);
+    color3 f0 = mix(schlickF0FromRelativeIOR(eta), color3(mat.baseColor_), colorScalar(mat.metalness_));
+    color3 fresnel = Fr_Schlick(abs(cosTheta(wo)), f0);
 
-    float diffuseWeight = (1.0f - mat.metalness_) * (1.0f - mat.transmission_);
-    float transmissionWeight = (1.0f - mat.metalness_) * mat.transmission_;
-    vec3 diff = (mat.baseColor_) ;
-    pDiffuse = max(diff.x, max(diff.y, diff.z))* diffuseWeight;
-    pSpecular = max(fresnel.x, max(fresnel.y,fresnel.z));
-    vec3 trans = vec3(1.0f) - fresnel;
-    pTransmission = max(trans.x, max(trans.y, trans.z)) * transmissionWeight;
+    colorScalar diffuseWeight = colorScalar((1.0f - mat.metalness_) * (1.0f - mat.transmission_));
+    colorScalar transmissionWeight = colorScalar((1.0f - mat.metalness_) * mat.transmission_);
+    color3 diff = color3(mat.baseColor_);
+    pDiffuse = float(max(diff.x, max(diff.y, diff.z)) * diffuseWeight);
+    pSpecular = float(max(fresnel.x, max(fresnel.y, fresnel.z)));
+    color3 trans = color3(1.0f) - fresnel;
+    pTransmission = float(max(trans.x, max(trans.y, trans.z)) * transmissionWeight);
 
     float normFactor = 1.0f / (pDiffuse + pSpecular + pTransmission);
     pDiffuse *= normFactor;
@@ -56,6 +56,14 @@ vec3 refl(in vec3 w, in vec3 n) {
     return 2.0 * dot(w, n) * n - w;
 }
 vec3 sampleDirection(inout uint seed, in Mat mat, in vec3 wo, inout float pdf) {
+    if (DIFFUSE_ONLY) {
+        float u1 = RandomFloat(seed);
+        float u2 = RandomFloat(seed);
+        vec3 wi = sign(cosTheta(wo)) * sampleCosineHemisphere(u1, u2);
+        pdf = pdfCosineHemisphere(wi, wo);
+        return wi;
+    }
+
     float eta = computeRelativeIOR(mat, wo);
     float pDiffuse, pSpecular, pTransmission;
     computeLobeProbabilities(mat, wo, pDiffuse, pSpecular, pTransmission);
@@ -98,15 +106,20 @@ vec3 lerp(vec3 x, vec3 y, float t) {
 	return x * (1.f - t) + y * t;
 }
 vec3 evaluate(in Mat mat, in vec3 wi, in vec3 wo) {
+    if (DIFFUSE_ONLY) {
+        return vec3(diffuse_Lambert(wi, wo, color3(mat.baseColor_)));
+    }
+
     float eta = computeRelativeIOR(mat, wo);
-    vec3 f0 = lerp(schlickF0FromRelativeIOR(eta), mat.baseColor_, mat.metalness_);
+    color3 baseColor = color3(mat.baseColor_);
+    color3 f0 = mix(schlickF0FromRelativeIOR(eta), baseColor, colorScalar(mat.metalness_));
 
-    vec3 diffuse = diffuse_Lambert(wi, wo, mat.baseColor_);
+    color3 diffuse = diffuse_Lambert(wi, wo, baseColor);
     vec3 specular = microfacetReflection_GGX(wi, wo, f0, eta, mat.alpha_);
     vec3 transmission = mat.baseColor_ * microfacetTransmission_GGX(wi, wo, f0, eta, mat.alpha_);
     
-    float diffuseWeight = (1.0f - mat.metalness_) * (1.0f - mat.transmission_);
+    colorScalar diffuseWeight = colorScalar((1.0f - mat.metalness_) * (1.0f - mat.transmission_));
     float transmissionWeight = (1.0f - mat.metalness_) * mat.transmission_;
 
-    return diffuseWeight * diffuse + specular + transmissionWeight * transmission;
+    return vec3(diffuseWeight * diffuse) + specular + transmissionWeight * transmission;
 }
\ No newline at end of file
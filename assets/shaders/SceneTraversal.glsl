@@ -1,31 +1,4 @@
-
-bool IntersectTriangle(in Ray ray, vec3 v0, vec3 v1, vec3 v2, inout Intersection isect)
-{
-    vec3 A = v1 - v0;
-    vec3 B = v2 - v0;
-    vec3 pvec = cross(ray.direction, B);
-    float det = dot(A, pvec);
-
-    float invDeterminant = 1.0 / det;
-
-    vec3 tvec = ray.origin - v0;
-    float u = dot(tvec, pvec) * invDeterminant;
-    if (u < 0 || u  > 1) return false;
-
-    vec3 qvec = cross(tvec, A);
-    float v = dot(ray.direction, qvec) * invDeterminant;
-    if (v < 0 || u + v > 1) return false;
-
-    float t = dot(B, qvec) * invDeterminant;
-    if (t < isect.t_hit && t > 0)
-    {
-        isect.t_hit = t;
-        isect.barycentric = vec2(u, v);
-        return true;
-
-    }
-    return false;
-}
+#include "Triangle.glsl"
 
 float IntersectAABB(in Ray ray, in vec3 bmin, in vec3 bmax, in float t_hit)
 {
@@ -38,7 +11,8 @@ float IntersectAABB(in Ray ray, in vec3 bmin, in vec3 bmax, in float t_hit)
 	if (tmax >= tmin && tmin < t_hit && tmax > 0) return tmin; else return 1e30f;
 }
 
-bool IntersectBVH(in Ray ray, inout Intersection isect)
+// One ray per lane with a private stack of whole nodes.
+bool IntersectBVHPerLane(in Ray ray, inout Intersection isect)
 {
 	BVHNode node = bvhNodes[0], stack[32];
 	uint stackPtr = 0;
@@ -99,4 +73,118 @@ bool IntersectBVH(in Ray ray, inout Intersection isect)
 		}
 	}
 	return hit;
-}
\ No newline at end of file
+}
+
+// The subgroup traversal, only compiled into the kernels that define SUBGROUP_TRAVERSAL (tracer_subgroup.comp),
+// which need the ballot and vote subgroup operations.
+#ifdef SUBGROUP_TRAVERSAL
+// It keeps the first SHARED_STACK_SIZE entries of each lane's stack, node indices, in workgroup shared memory
+// and spills the rest to registers. Entry i of lane l is at i * lanes + l, a subgroup pushing together writes
+// consecutive words.
+const uint SHARED_STACK_SIZE = 12;
+const uint SPILL_STACK_SIZE = 20;
+const uint TRAVERSAL_LANES = gl_WorkGroupSize.x * gl_WorkGroupSize.y * gl_WorkGroupSize.z;
+shared uint sharedStack[SHARED_STACK_SIZE * TRAVERSAL_LANES];
+
+// Coherent rays, primary rays especially, walk the top of the tree together. When all the active lanes are at
+// the same node it is fetched once through a subgroup uniform index instead of by every lane.
+BVHNode fetchNode(in uint index)
+{
+	if (subgroupAllEqual(index))
+	{
+		return bvhNodes[subgroupBroadcastFirst(index)];
+	}
+	return bvhNodes[index];
+}
+
+// IntersectBVH with the subgroup cooperating. If the rays of all the active lanes point into the same octant
+// the subgroup is taken to be coherent, and each lane descends into the child most of the lanes found nearer
+// rather than its own nearer one, so the lanes stay on the same nodes and share their fetches.
+bool IntersectBVHSubgroup(in Ray ray, inout Intersection isect)
+{
+	bvec3 octant = lessThan(ray.direction, vec3(0.0));
+	bool coherent = subgroupAllEqual(octant.x) && subgroupAllEqual(octant.y) && subgroupAllEqual(octant.z);
+
+	uint spill[SPILL_STACK_SIZE];
+	uint stackPtr = 0;
+	BVHNode node = fetchNode(0);
+	bool hit = false;
+	while (true)
+	{
+		bool pop = true;
+		if (node.triCount > 0)
+		{
+			for (uint i = 0; i < node.triCount; i++)
+			{
+				vec3 v0, v1, v2;
+				triangleVertices(node.leftFirst + i, v0, v1, v2);
+				if (IntersectTriangle(ray, v0, v1, v2, isect))
+				{
+					hit = true;
+					isect.objIdx = node.leftFirst + i;
+				}
+			}
+		}
+		else
+		{
+			uint near = node.leftFirst, far = node.leftFirst + 1;
+			BVHNode child1 = fetchNode(near);
+			BVHNode child2 = fetchNode(far);
+			float dist1 = IntersectAABB(ray, vec3(child1.minx, child1.miny, child1.minz), vec3(child1.maxx, child1.maxy, child1.maxz), isect.t_hit);
+			float dist2 = IntersectAABB(ray, vec3(child2.minx, child2.miny, child2.minz), vec3(child2.maxx, child2.maxy, child2.maxz), isect.t_hit);
+
+			bool swap = dist1 > dist2;
+			if (coherent)
+			{
+				swap = 2 * subgroupBallotBitCount(subgroupBallot(swap)) > subgroupBallotBitCount(subgroupBallot(true));
+			}
+			if (swap)
+			{
+				float d = dist1; dist1 = dist2; dist2 = d;
+				BVHNode c = child1; child1 = child2; child2 = c;
+				uint n = near; near = far; far = n;
+			}
+
+			// with the order voted the nearer child may be the one missed
+			if (dist1 != 1e30f)
+			{
+				node = child1;
+				pop = false;
+				if (dist2 != 1e30f)
+				{
+					if (stackPtr < SHARED_STACK_SIZE) sharedStack[stackPtr * TRAVERSAL_LANES + gl_LocalInvocationIndex] = far;
+					else spill[stackPtr - SHARED_STACK_SIZE] = far;
+					stackPtr++;
+				}
+			}
+			else if (dist2 != 1e30f)
+			{
+				node = child2;
+				pop = false;
+			}
+		}
+
+		if (pop)
+		{
+			if (stackPtr == 0)
+			{
+				break;
+			}
+			stackPtr--;
+			node = fetchNode(stackPtr < SHARED_STACK_SIZE ? sharedStack[stackPtr * TRAVERSAL_LANES + gl_LocalInvocationIndex] : spill[stackPtr - SHARED_STACK_SIZE]);
+		}
+	}
+	return hit;
+}
+
+#endif
+
+// Closest hit of the ray in the scene, with the traversal of the kernel.
+bool IntersectBVH(in Ray ray, inout Intersection isect)
+{
+#ifdef SUBGROUP_TRAVERSAL
+	return IntersectBVHSubgroup(ray, isect);
+#else
+	return IntersectBVHPerLane(ray, isect);
+#endif
+}
@@ -6,13 +6,46 @@ struct RayGenUBO
 	vec4 coord_z;
 	vec4 horizontal;
 	vec4 vertical;
+	vec4 environment;
 	float invWidth;
 	float invHeight;
 	float focusDist;
 	float aperture;
-	uint frameIndex;
+	uint firstSample; // of the dispatch, counted from 1 since accumulation restarted
 };
 
+layout (push_constant) uniform TraceConstants
+{
+	uint samplesPerDispatch;
+	uint currentSample; // wavefront only, the sample being traced
+	uint pathCapacity; // wavefront only
+	uint currentQueue; // wavefront only
+	// the part of the image this dispatch traces, the whole image unless it is split into tiles
+	uvec2 tileOffset;
+	uvec2 tileExtent;
+	uint clearAccumulation; // first visit of the tile since accumulation restarted
+};
+
+// Specialization constants, set per tracer variant (ComputeTracer::TracerVariant). Ids 0 and 1 are the
+// megakernel workgroup size.
+layout (constant_id = 2) const uint MAX_BOUNCES = 30;
+layout (constant_id = 3) const uint ROULETTE_START = 4; // first bounce Russian roulette may end a path at
+layout (constant_id = 4) const bool DIFFUSE_ONLY = false; // every surface a Lambertian reflector of its albedo
+layout (constant_id = 5) const float MIN_ALPHA = 0.001; // GGX roughness floor
+layout (constant_id = 6) const float SAMPLE_CLAMP = 50.0;
+// megakernel only, 1D workgroups each covering a square block of pixels in Morton order
+layout (constant_id = 7) const bool MORTON_ORDER = false;
+// wavefront only, shade the hits in the order of the hit sort
+layout (constant_id = 8) const bool SORT_HITS = false;
+// megakernel only, the first sample of a dispatch takes its first hit from the rasterized visibility buffer
+layout (constant_id = 9) const bool VISIBILITY_BUFFER = false;
+
+// Index of sample s of a dispatch over the whole accumulation, seeds the random sequence.
+uint sampleIndex(in uint firstSample, in uint s)
+{
+	return firstSample + s;
+}
+
 struct Ray
 {
 	vec3 origin;
@@ -43,6 +76,10 @@ struct Material
 {
 	vec3 albedo;
 	float emission;
+	float roughness;
+	float metalness;
+	float transmission;
+	float ior;
 };
 
 struct BVHNode
@@ -0,0 +1,26 @@
+struct SurfaceInteraction
+{
+	vec3 normal;
+	vec2 uv;
+	Material mat;
+};
+
+void getSurfaceProperties(inout SurfaceInteraction interaction, inout Intersection isect)
+{
+	Tri tri = triangles[isect.objIdx];
+	interaction.mat = materials[tri.materialIdx];
+	Vertex v0 = vertices[tri.modelOffset + indices[tri.v_indices]];
+	Vertex v1 = vertices[tri.modelOffset + indices[tri.v_indices + 1]];
+	Vertex v2 = vertices[tri.modelOffset + indices[tri.v_indices + 2]];
+	Normal n0 = normals[tri.modelOffset + indices[tri.v_indices]];
+	Normal n1 = normals[tri.modelOffset + indices[tri.v_indices + 1]];
+	Normal n2 = normals[tri.modelOffset + indices[tri.v_indices + 2]];
+
+	interaction.normal = (1 - isect.barycentric.x - isect.barycentric.y) * n0.normal + isect.barycentric.x* n1.normal + isect.barycentric.y * n2.normal;
+	
+	vec2 uv0 = vec2(v0.u, n0.v);
+	vec2 uv1 = vec2(v1.u, n1.v);
+	vec2 uv2 = vec2(v2.u, n2.v);
+
+	interaction.uv = (1 - isect.barycentric.x - isect.barycentric.y) * uv0 + isect.barycentric.x* uv1 + isect.barycentric.y * uv2;
+}
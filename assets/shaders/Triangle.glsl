@@ -0,0 +1,38 @@
+// Ray against a single triangle, closer than isect.t_hit. Shared by the BVH traversal and the visibility
+// buffer's first hit.
+bool IntersectTriangle(in Ray ray, vec3 v0, vec3 v1, vec3 v2, inout Intersection isect)
+{
+    vec3 A = v1 - v0;
+    vec3 B = v2 - v0;
+    vec3 pvec = cross(ray.direction, B);
+    float det = dot(A, pvec);
+
+    float invDeterminant = 1.0 / det;
+
+    vec3 tvec = ray.origin - v0;
+    float u = dot(tvec, pvec) * invDeterminant;
+    if (u < 0 || u  > 1) return false;
+
+    vec3 qvec = cross(tvec, A);
+    float v = dot(ray.direction, qvec) * invDeterminant;
+    if (v < 0 || u + v > 1) return false;
+
+    float t = dot(B, qvec) * invDeterminant;
+    if (t < isect.t_hit && t > 0)
+    {
+        isect.t_hit = t;
+        isect.barycentric = vec2(u, v);
+        return true;
+
+    }
+    return false;
+}
+
+// Positions of the corners of scene triangle i.
+void triangleVertices(in uint i, out vec3 v0, out vec3 v1, out vec3 v2)
+{
+	Tri tri = triangles[i];
+	v0 = vertices[tri.modelOffset + indices[tri.v_indices]].position;
+	v1 = vertices[tri.modelOffset + indices[tri.v_indices + 1]].position;
+	v2 = vertices[tri.modelOffset + indices[tri.v_indices + 2]].position;
+}
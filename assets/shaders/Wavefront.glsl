@@ -0,0 +1,83 @@
+// Shared by the wavefront kernels. Paths live in two queues of pathCapacity entries each, one read by the
+// current bounce and one the surviving paths are appended to. The queue counters double as the indirect
+// dispatch size of the next bounce.
+#include "Structs.glsl"
+
+#define WAVEFRONT_GROUP_SIZE 64
+
+struct PathState
+{
+	vec3 origin;
+	uint pixel;
+	vec3 direction;
+	uint seed;
+	vec3 throughput;
+	uint bounce;
+};
+
+struct HitRecord
+{
+	float t_hit;
+	uint objIdx; // ~0 for a miss
+	vec2 barycentric;
+};
+
+layout (binding = 0, rgba16f) uniform writeonly image2D resultImage;
+layout (binding = 1, rgba32f) uniform image2D accumulationImage;
+layout (binding = 2) readonly uniform UniformBufferObjectStruct { RayGenUBO Camera; };
+
+layout (std430, binding = 3) readonly buffer VertexBuffer { Vertex vertices[]; };
+layout (std430, binding = 4) readonly buffer IndexBuffer { uint indices[]; };
+layout (std430, binding = 5) readonly buffer TriBuffer { Tri triangles[]; };
+layout (std430, binding = 6) readonly buffer BVHNodeBuffer { BVHNode bvhNodes[]; };
+layout (std430, binding = 7) readonly buffer NormalBuffer { Normal normals[]; };
+layout (std430, binding = 8) readonly buffer MaterialBuffer { Material materials[]; };
+
+layout (std430, binding = 9) buffer PathBuffer { PathState paths[]; };
+layout (std430, binding = 10) buffer HitBuffer { HitRecord hits[]; };
+layout (std430, binding = 11) buffer RadianceBuffer { vec4 radiance[]; };
+layout (std430, binding = 12) buffer QueueBuffer
+{
+	uvec3 dispatchSize;
+	uint queueCount[2];
+};
+layout (std430, binding = 13) buffer TraceStatisticsBuffer
+{
+	// 64 bit totals as a low and a high word each
+	uint busyLaneSteps; uint busyLaneStepsHigh;
+	uint laneSteps; uint laneStepsHigh;
+	uint rayCount; uint rayCountHigh;
+	uint workCounter;
+};
+
+// Hits binned by material and ray direction, so the shade kernel runs lanes with the same BSDF together.
+// A counting sort: the hits of each bin are counted, the counts scanned into bin offsets and every hit
+// scattered to its bin, sortedHits then lists the queue slots in bin order.
+#define HIT_SORT_MATERIALS 127
+#define HIT_SORT_BINS 1024 // 8 direction octants for each material, misses go in the last bin
+layout (std430, binding = 14) buffer HitSortBuffer
+{
+	uint binCount[HIT_SORT_BINS];
+	uint binOffset[HIT_SORT_BINS];
+	uint sortedHits[];
+};
+
+uint currentPath(uint index) { return currentQueue * pathCapacity + index; }
+uint nextPath(uint index) { return (1 - currentQueue) * pathCapacity + index; }
+
+// Materials past the last bin share it. Camera rays all leave in much the same direction, only secondary
+// rays are split by octant.
+uint hitSortKey(in uint index)
+{
+	HitRecord hit = hits[index];
+	if(hit.objIdx == ~0u) return HIT_SORT_BINS - 1;
+
+	PathState path = paths[currentPath(index)];
+	uint material = min(triangles[hit.objIdx].materialIdx, HIT_SORT_MATERIALS - 1);
+	uint octant = 0;
+	if(path.bounce > 0)
+	{
+		octant = uint(path.direction.x < 0.0) | (uint(path.direction.y < 0.0) << 1) | (uint(path.direction.z < 0.0) << 2);
+	}
+	return material * 8 + octant;
+}
@@ -0,0 +1,9 @@
+#version 460
+
+layout (location = 0) flat in uint triangle;
+layout (location = 0) out uint visible;
+
+void main()
+{
+	visible = triangle;
+}
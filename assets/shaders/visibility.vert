@@ -0,0 +1,41 @@
+#version 460
+
+// Draws every scene triangle as seen by the megakernel's primary rays of the first sample of a dispatch, the
+// same pinhole and the same sub-pixel jitter as getPrimaryRay, into the visibility buffer (VisibilityPass).
+// No vertex input, vertex k of triangle i is pulled from the scene buffers at 3 * i + k.
+#include "Structs.glsl"
+#include "Random.glsl"
+
+layout (binding = 2) readonly uniform UniformBufferObjectStruct { RayGenUBO Camera; };
+layout (std430, binding = 3) readonly buffer VertexBuffer { Vertex vertices[]; };
+layout (std430, binding = 4) readonly buffer IndexBuffer { uint indices[]; };
+layout (std430, binding = 5) readonly buffer TriBuffer { Tri triangles[]; };
+
+layout (location = 0) flat out uint triangle;
+
+// Anything closer to the camera than this is clipped.
+const float NEAR = 1e-4;
+
+void main()
+{
+	uint i = gl_VertexIndex / 3;
+	Tri tri = triangles[i];
+	vec3 position = vertices[tri.modelOffset + indices[tri.v_indices + gl_VertexIndex % 3]].position;
+
+	uint pixelSeed = WangHash(sampleIndex(Camera.firstSample, 0));
+	vec2 pixelOffset = vec2(RandomFloat(pixelSeed), RandomFloat(pixelSeed));
+
+	// getPrimaryRay's direction is coord_z * focusDist + u * horizontal - v * vertical, with u and v in [-1, 1]
+	// over the image. Projected, a point lands at u and v divided by its depth along coord_z.
+	vec3 r = position - Camera.position.xyz;
+	float depth = dot(r, Camera.coord_z.xyz);
+	float u = Camera.focusDist * dot(r, Camera.horizontal.xyz) / dot(Camera.horizontal.xyz, Camera.horizontal.xyz);
+	float v = -Camera.focusDist * dot(r, Camera.vertical.xyz) / dot(Camera.vertical.xyz, Camera.vertical.xyz);
+
+	// The rasterizer samples pixel centres, shift the image so they fall where the jittered rays go.
+	vec2 shift = (2.0 * pixelOffset - 1.0) * vec2(Camera.invWidth, Camera.invHeight);
+
+	// Reversed depth, NEAR / depth, the closest triangle has the greatest.
+	gl_Position = vec4(u - shift.x * depth, v - shift.y * depth, NEAR, depth);
+	triangle = i + 1;
+}
@@ -10,7 +10,7 @@ project "ThroughThiccAndThinn"
    targetdir "bin/%{cfg.buildcfg}"
    staticruntime "off"
 
-   files { "src/**.h", "src/**.cpp" , "src/**.hpp", "assets/shaders/**.vert", "assets/shaders/**.frag", "assets/shaders/**.comp", "assets/shaders/**.spv","assets/shaders/**.glsl", "models/**.obj"}
+   files { "src/**.h", "src/**.cpp" , "src/**.hpp", "assets/shaders/**.vert", "assets/shaders/**.frag", "assets/shaders/**.comp", "assets/shaders/**.spv","assets/shaders/**.glsl", "models/**.obj", "assets/scenes/**.scene"}
 
    includedirs
    {
@@ -52,9 +52,11 @@ project "ThroughThiccAndThinn"
    filter 'files:**.comp'
       buildmessage 'Compiling %{file.relpath}'
       buildcommands {
-         'glslc "%{file.relpath}" -o "assets/shaders/%{file.basename}.comp.spv"'
+         'glslc --target-env=vulkan1.2 "%{file.relpath}" -o "assets/shaders/%{file.basename}.comp.spv"'
       }
       buildoutputs { "assets/shaders/%{file.basename}.comp.spv"}
+      -- recompile when an included file changes, not just the entry point
+      buildinputs { os.matchfiles("assets/shaders/*.glsl") }
 
    filter "system:windows"
       systemversion "latest"
@@ -6,13 +6,17 @@
 #include "Vulkan/DepthBuffer.hpp"
 #include "Vulkan/Device.hpp"
 #include "Vulkan/Fence.hpp"
+#include "Vulkan/GpuProfiler.hpp"
 #include "Vulkan/FrameBuffer.hpp"
 #include "Vulkan/Instance.hpp"
+#include "Vulkan/MemoryAllocator.hpp"
+#include "Vulkan/PipelineCache.hpp"
 #include "Vulkan/PipelineLayout.hpp"
 #include "Vulkan/RenderPass.hpp"
 #include "Vulkan/Semaphore.hpp"
 #include "Vulkan/Surface.hpp"
 #include "Vulkan/SwapChain.hpp"
+#include "Vulkan/TimelineSemaphore.hpp"
 #include "Vulkan/Window.hpp"
 #include "Vulkan/Image.hpp"
 #include "Vulkan/ImageView.hpp"
@@ -20,16 +24,20 @@
 #include "Vulkan/ImageMemoryBarrier.hpp"
 #include "Gwaphics/Pipelines/SimpleQuadPipeline.hpp"
 #include "Gwaphics/Pipelines/ComputeTracer.hpp"
+#include "Gwaphics/Pipelines/TracerDeviceFeatures.hpp"
+#include "Gwaphics/Pipelines/WorkgroupTuner.hpp"
 #include "ImGui/backends/imgui_impl_vulkan.h"
 
+#include <algorithm>
 #include <stdexcept>
 #include <array>
 #include <iostream>
 
 namespace Vulkan {
 
-Application::Application(const WindowConfig& windowConfig, const VkPresentModeKHR presentMode, const bool enableValidationLayers) :
-	presentMode_(presentMode)
+Application::Application(const WindowConfig& windowConfig, const VkPresentModeKHR presentMode, const bool enableValidationLayers, const std::string& scenePath) :
+	presentMode_(presentMode),
+	scenePath_(scenePath)
 {
 	const auto validationLayers = enableValidationLayers
 		? std::vector<const char*>{"VK_LAYER_KHRONOS_validation"}
@@ -42,16 +50,45 @@ Application::Application(const WindowConfig& windowConfig, const VkPresentModeKH
 	settings.ImageWidth = &imgWidth;
 	settings.ImageHeight = &imgHeight;
 	settings.Vignette = &vignette;
+	settings.Tracer = static_cast<int>(TracerMode::Megakernel);
+	settings.Variant = static_cast<int>(TracerPreset::Reference);
+	settings.SortHits = false;
+	settings.RayQuery = false;
+	settings.VisibilityBuffer = false;
+	settings.SubgroupTraversal = false;
+	settings.HalfShading = false;
+	settings.SamplesPerDispatch = 1;
+	settings.TiledDispatch = false;
+	settings.FrameBudget = 8.0f;
+	settings.LogGpuTimings = false;
+	settings.TuneWorkgroups = false;
+	settings.BenchmarkTraversal = false;
 }
 
 Application::~Application()
 {
 	Application::DeleteSwapChain();
 
+	workgroupTuner_.reset();
 	computeTracer_.reset();
+	computeProfiler_.reset();
+	if (pipelineCache_)
+	{
+		// Everything compiled this run is in there by now. Losing it only costs the next startup.
+		try
+		{
+			pipelineCache_->Save();
+		}
+		catch (const std::exception& exception)
+		{
+			std::cerr << "failed to save the pipeline cache: " << exception.what() << std::endl;
+		}
+	}
+	pipelineCache_.reset();
 	deleteComputeTargetImage();
 	commandPool_.reset();
-	computeFence_.reset();
+	graphicsTimeline_.reset();
+	computeTimeline_.reset();
 	computeCommandBuffers_.reset();
 	computeCommandPool_.reset();
 	device_.reset();
@@ -83,15 +120,18 @@ void Application::SetPhysicalDevice(VkPhysicalDevice physicalDevice)
 		throw(std::logic_error("physical device has already been set"));
 	}
 
+	TracerDeviceFeatures features(physicalDevice);
+
 	std::vector<const char*> requiredExtensions = 
 	{
 		// VK_KHR_swapchain
 		VK_KHR_SWAPCHAIN_EXTENSION_NAME
 	};
+	requiredExtensions.insert(requiredExtensions.end(), features.Extensions().begin(), features.Extensions().end());
 
-	VkPhysicalDeviceFeatures deviceFeatures = {};
-	
-	SetPhysicalDevice(physicalDevice, requiredExtensions, deviceFeatures, nullptr);
+	VkPhysicalDeviceFeatures deviceFeatures = features.Features();
+
+	SetPhysicalDevice(physicalDevice, requiredExtensions, deviceFeatures, features.Next());
 	OnDeviceSet();
 
 	// Create swap chain and command buffers.
@@ -123,13 +163,18 @@ void Application::SetPhysicalDevice(
 	void* nextDeviceFeatures)
 {
 	device_.reset(new class Device(physicalDevice, *surface_, requiredExtensions, deviceFeatures, nextDeviceFeatures));
+	pipelineCache_.reset(new PipelineCache(*device_, "pipeline_cache.bin"));
 	commandPool_.reset(new class CommandPool(*device_, device_->GraphicsFamilyIndex(), true));
 	computeCommandPool_.reset(new class CommandPool(*device_, device_->ComputeFamilyIndex(), true));
 	computeCommandBuffers_.reset(new CommandBuffers(*computeCommandPool_, 1));
-	computeFence_.reset(new Fence(*device_, true));
+	computeProfiler_.reset(new GpuProfiler(*device_, device_->ComputeFamilyIndex(), 1, VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT));
+	computeTimeline_.reset(new TimelineSemaphore(*device_, 0));
+	graphicsTimeline_.reset(new TimelineSemaphore(*device_, 0));
 	createComputeTargetImage();
 
-	computeTracer_.reset(new ComputeTracer(*device_, *computeCommandPool_, computeImageDescriptorInfo_, imgWidth, imgHeight));
+	computeTracer_.reset(new ComputeTracer(*device_, *computeCommandPool_, *pipelineCache_, computeImageDescriptorInfo_, imgWidth, imgHeight, scenePath_));
+	settings.SceneEditor = &computeTracer_->SceneEditor();
+	workgroupTuner_.reset(new WorkgroupTuner(*device_, "workgroup_tuning.txt"));
 
 }
 
@@ -140,7 +185,7 @@ void Application::buildComputeCommmandBuffer()
 
 void Application::createComputeTargetImage()
 {
-	computeImage_ = std::make_unique<Image>(*device_, VkExtent2D(imgWidth, imgHeight), VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_TILING_OPTIMAL,VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
+	computeImage_ = std::make_unique<Image>(*device_, VkExtent2D(imgWidth, imgHeight), VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
 	computeImageMemory_ = std::make_unique<DeviceMemory>(computeImage_->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
 	computeImage_->TransitionImageLayout(*commandPool_, VK_IMAGE_LAYOUT_GENERAL);
 	computeSampler_ = std::make_unique<Sampler>(*device_, SamplerConfig{});
@@ -149,11 +194,40 @@ void Application::createComputeTargetImage()
 	computeImageDescriptorInfo_.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 	computeImageDescriptorInfo_.imageView = computeImageView_->Handle();
 	computeImageDescriptorInfo_.sampler = computeSampler_->Handle();
+
+	// Left undefined, the compute queue lays them out when it copies the first trace in.
+	for (auto& displayImage : displayImages_)
+	{
+		displayImage = DisplayImage();
+		displayImage.image = std::make_unique<Image>(*device_, VkExtent2D(imgWidth, imgHeight), computeImage_->Format(), VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+		displayImage.memory = std::make_unique<DeviceMemory>(displayImage.image->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+		displayImage.view = std::make_unique<ImageView>(*device_, displayImage.image->Handle(), displayImage.image->Format(), VK_IMAGE_ASPECT_COLOR_BIT);
+	}
+}
+
+std::vector<VkDescriptorImageInfo> Application::displayImageDescriptors() const
+{
+	std::vector<VkDescriptorImageInfo> descriptors;
+	for (const auto& displayImage : displayImages_)
+	{
+		VkDescriptorImageInfo descriptor = {};
+		descriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		descriptor.imageView = displayImage.view->Handle();
+		descriptor.sampler = computeSampler_->Handle();
+		descriptors.push_back(descriptor);
+	}
+
+	return descriptors;
 }
 
 void Application::deleteComputeTargetImage()
 {
 	device_->WaitIdle();
+	displayed_ = nullptr;
+	for (auto& displayImage : displayImages_)
+	{
+		displayImage = DisplayImage();
+	}
 	computeSampler_.reset();
 	computeImageView_.reset();
 	computeImage_.reset();
@@ -193,8 +267,14 @@ void Application::CreateSwapChain()
 	}
 
 	commandBuffers_.reset(new CommandBuffers(*commandPool_, static_cast<uint32_t>(swapChainFramebuffers_.size())));
+	// a slot per frame in flight
+	graphicsProfiler_.reset(new GpuProfiler(*device_, device_->GraphicsFamilyIndex(), static_cast<uint32_t>(inFlightFences_.size()), VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT));
+	if (loggingGpuTimings_)
+	{
+		graphicsProfiler_->SetLog("gpu_graphics.csv");
+	}
 
-	userInterface_.reset(new UserInterface(CommandPool(), SwapChain(), DepthBuffer(), RenderPass()));
+	userInterface_.reset(new UserInterface(CommandPool(), SwapChain(), DepthBuffer(), RenderPass(), *pipelineCache_));
 }
 
 void Application::DeleteSwapChain()
@@ -203,6 +283,7 @@ void Application::DeleteSwapChain()
 	DeleteViewPort();
 	dsetsInit = false;
 	userInterface_.reset();
+	graphicsProfiler_.reset();
 	commandBuffers_.reset();
 	swapChainFramebuffers_.clear();
 	renderPass_.reset();
@@ -262,7 +343,7 @@ void Application::CreateViewport()
 	}
 	viewportInit = true;
 
-	quadPipeline_.reset(new SimpleQuadPipeline(SwapChain(), *viewportRenderPass_, quadUniformBuffers_, computeImageDescriptorInfo_));
+	quadPipeline_.reset(new SimpleQuadPipeline(SwapChain(), *viewportRenderPass_, *pipelineCache_, quadUniformBuffers_, displayImageDescriptors()));
 
 
 }
@@ -316,23 +397,12 @@ void Application::DrawFrame()
 		CreateViewport();
 	}
 
-	/*vkWaitForFences(device_->Handle(), 1, &computeFence_->Handle(), VK_TRUE, UINT64_MAX);
-	vkResetFences(device_->Handle(), 1, &computeFence_->Handle());*/
-	computeFence_->Wait(noTimeout);
-	computeFence_->Reset();
-	const auto computeCmdBuffer = computeCommandBuffers_->Begin(0);
-	ComputePathTrace(computeCmdBuffer);
-	computeCommandBuffers_->End(0);
-	if (viewportInit)
-		computeTracer_->updateCameraUBO();
-
-	VkSubmitInfo computeSubmitInfo = {};
-	computeSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	computeSubmitInfo.commandBufferCount = 1;
-	computeSubmitInfo.pCommandBuffers = &computeCmdBuffer;
-
-	Check(vkQueueSubmit(device_->ComputeQueue(), 1, &computeSubmitInfo, computeFence_->Handle()),
-		"submit compute command buffer");
+	// Never blocks on compute, a new trace only goes in once the last one has finished.
+	computeCompleted_ = computeTimeline_->Value();
+	if (computeCompleted_ == computeSubmitted_)
+	{
+		submitPathTrace();
+	}
 
 	const auto commandBuffer = commandBuffers_->Begin(imageIndex);
 	Render(commandBuffer, imageIndex);
@@ -343,17 +413,28 @@ void Application::DrawFrame()
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+	// The wait for the sampled trace has been met already, it orders the frame after it on the GPU.
 	VkCommandBuffer commandBuffers[]{ commandBuffer };
-	VkSemaphore waitSemaphores[] = { imageAvailableSemaphore };
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	VkSemaphore signalSemaphores[] = { renderFinishedSemaphore };
-
-	submitInfo.waitSemaphoreCount = 1;
+	VkSemaphore waitSemaphores[] = { imageAvailableSemaphore, computeTimeline_->Handle() };
+	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT };
+	const uint64_t waitValues[] = { 0, displayed_ != nullptr ? displayed_->trace : 0 };
+	VkSemaphore signalSemaphores[] = { renderFinishedSemaphore, graphicsTimeline_->Handle() };
+	const uint64_t signalValues[] = { 0, ++graphicsSubmitted_ };
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = 2;
+	timelineInfo.pWaitSemaphoreValues = waitValues;
+	timelineInfo.signalSemaphoreValueCount = 2;
+	timelineInfo.pSignalSemaphoreValues = signalValues;
+
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.waitSemaphoreCount = 2;
 	submitInfo.pWaitSemaphores = waitSemaphores;
 	submitInfo.pWaitDstStageMask = waitStages;
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = commandBuffers;
-	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.signalSemaphoreCount = 2;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
 	inFlightFence.Reset();
@@ -361,11 +442,16 @@ void Application::DrawFrame()
 	Check(vkQueueSubmit(device_->GraphicsQueue(), 1, &submitInfo, inFlightFence.Handle()),
 		"submit draw command buffer");
 
+	if (displayed_ != nullptr)
+	{
+		displayed_->lastRead = graphicsSubmitted_;
+	}
+
 	VkSwapchainKHR swapChains[] = { swapChain_->Handle() };
 	VkPresentInfoKHR presentInfo = {};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = signalSemaphores;
+	presentInfo.pWaitSemaphores = &renderFinishedSemaphore;
 	presentInfo.swapchainCount = 1;
 	presentInfo.pSwapchains = swapChains;
 	presentInfo.pImageIndices = &imageIndex;
@@ -387,33 +473,155 @@ void Application::DrawFrame()
 	{
 		deleteComputeTargetImage();
 		createComputeTargetImage();
-		quadPipeline_->updateQuadTextureDescriptor(quadUniformBuffers_, computeImageDescriptorInfo_);
+		quadPipeline_->updateQuadTextureDescriptor(quadUniformBuffers_, displayImageDescriptors());
 		computeTracer_->resizeComputeTarget(imgWidth, imgHeight, computeImageDescriptorInfo_);
 		prevImgWidth = imgWidth;
 		prevImgHeight = imgHeight;
 	}
+	if (settings.TuneWorkgroups)
+	{
+		// Benchmarks on the compute queue, after the trace in flight. The next trace picks up the winner.
+		settings.TuneWorkgroups = false;
+		device_->WaitIdle();
+		workgroupTuner_->Tune(*computeTracer_, static_cast<uint32_t>(imgWidth), static_cast<uint32_t>(imgHeight));
+	}
+	if (settings.BenchmarkTraversal)
+	{
+		// The current variant with each traversal, the same way. Primary rays alone (a single bounce) are
+		// coherent, the bounces after them are not, so the two are timed apart.
+		settings.BenchmarkTraversal = false;
+		device_->WaitIdle();
+		traversalTimes_.clear();
+		const auto benchmark = [&](const char* name, TracerVariant variant)
+		{
+			variant.visibilityBuffer = false;
+			const double paths = computeTracer_->benchmarkVariant(variant, static_cast<uint32_t>(imgWidth), static_cast<uint32_t>(imgHeight));
+			variant.maxBounces = 1;
+			const double primary = computeTracer_->benchmarkVariant(variant, static_cast<uint32_t>(imgWidth), static_cast<uint32_t>(imgHeight));
+			traversalTimes_.push_back({ name, primary, std::max(paths - primary, 0.0) });
+			std::cout << "Megakernel traversal, " << name << ": " << primary << " ms primary, " << traversalTimes_.back().bounces << " ms bounces" << std::endl;
+		};
+
+		TracerVariant variant = computeTracer_->Variant();
+		variant.rayQuery = false;
+		variant.subgroupTraversal = false;
+		benchmark("Software BVH", variant);
+		if (computeTracer_->SubgroupTraversalSupported())
+		{
+			variant.subgroupTraversal = true;
+			benchmark("Subgroup BVH", variant);
+			variant.subgroupTraversal = false;
+		}
+		if (computeTracer_->RayQuerySupported())
+		{
+			variant.rayQuery = true;
+			benchmark("Ray query", variant);
+		}
+	}
 	currentFrame_ = (currentFrame_ + 1) % inFlightFences_.size();
 }
 
-void Application::ComputePathTrace(VkCommandBuffer commandBuffer)
+void Application::submitPathTrace()
 {
-	if (viewportInit)
-	{
-		if (device_->GraphicsFamilyIndex() != device_->ComputeFamilyIndex())
-		{
-			ImageMemoryBarrier::Insert(commandBuffer, computeImage_->Handle(), { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL);
-		}
-		computeTracer_->bindPipeline(commandBuffer);
+	// The display image the last trace did not write, frames may still be sampling it up to its lastRead.
+	DisplayImage& target = displayImages_[computeSubmitted_ % displayImages_.size()];
 
-		VkDescriptorSet descriptorSets[] = { computeTracer_->ComputeTextureDescriptorSet() };
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computeTracer_->PipelineLayout().Handle(), 0, 1, descriptorSets, 0, nullptr);
+	computeTracer_->updateScene();
+	const auto commandBuffer = computeCommandBuffers_->Begin(0);
+	ComputePathTrace(commandBuffer, target);
+	computeCommandBuffers_->End(0);
 
-		vkCmdDispatch(commandBuffer, (uint32_t)(std::ceil(imgWidth / 16.f)), (uint32_t)(std::ceil(imgHeight / 16.f)), 1);
-		if (device_->GraphicsFamilyIndex() != device_->ComputeFamilyIndex())
-		{
-			ImageMemoryBarrier::Insert(commandBuffer, computeImage_->Handle(), { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }, VK_ACCESS_SHADER_WRITE_BIT, 0, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL);
-		}
+	// Only the copy into the display image waits for the frames, the trace itself starts right away. The first
+	// trace also waits for the scene upload on the transfer queue.
+	const auto upload = computeTracer_->UploadWait();
+	VkSemaphore waitSemaphores[] = { graphicsTimeline_->Handle(), upload.first };
+	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+	const uint64_t waitValues[] = { target.lastRead, upload.second };
+	const uint32_t waitCount = upload.first != nullptr ? 2 : 1;
+	VkSemaphore signalSemaphores[] = { computeTimeline_->Handle() };
+	const uint64_t signalValues[] = { ++computeSubmitted_ };
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = waitCount;
+	timelineInfo.pWaitSemaphoreValues = waitValues;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = signalValues;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.waitSemaphoreCount = waitCount;
+	submitInfo.pWaitSemaphores = waitSemaphores;
+	submitInfo.pWaitDstStageMask = waitStages;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = signalSemaphores;
+
+	Check(vkQueueSubmit(device_->ComputeQueue(), 1, &submitInfo, nullptr),
+		"submit compute command buffer");
+
+	target.trace = computeSubmitted_;
+	target.acquired = false;
+}
+
+void Application::ComputePathTrace(VkCommandBuffer commandBuffer, const DisplayImage& target)
+{
+	computeProfiler_->BeginFrame(commandBuffer, 0);
+
+	computeProfiler_->BeginRegion(commandBuffer, "Scene upload");
+	computeTracer_->recordSceneUpdates(commandBuffer);
+	computeProfiler_->EndRegion(commandBuffer);
+	if (viewportInit)
+	{
+		computeProfiler_->BeginRegion(commandBuffer, "Path trace");
+		computeTracer_->setMode(static_cast<TracerMode>(settings.Tracer));
+		TracerVariant variant = PresetVariant(static_cast<TracerPreset>(settings.Variant));
+		workgroupTuner_->Apply(variant);
+		// only the wavefront shade kernel reads it, elsewhere it would just compile another variant
+		variant.sortHits = settings.SortHits && settings.Tracer == static_cast<int>(TracerMode::Wavefront);
+		variant.rayQuery = settings.RayQuery && settings.Tracer == static_cast<int>(TracerMode::Megakernel) && computeTracer_->RayQuerySupported();
+		variant.visibilityBuffer = settings.VisibilityBuffer && settings.Tracer == static_cast<int>(TracerMode::Megakernel) && computeTracer_->VisibilitySupported();
+		variant.subgroupTraversal = settings.SubgroupTraversal && !variant.rayQuery && settings.Tracer == static_cast<int>(TracerMode::Megakernel) && computeTracer_->SubgroupTraversalSupported();
+		variant.halfShading = settings.HalfShading && settings.Tracer == static_cast<int>(TracerMode::Megakernel) && computeTracer_->HalfShadingSupported();
+		// A variant not used before compiles in the background, the trace keeps the current one meanwhile.
+		computeTracer_->setVariant(variant, true);
+		computeTracer_->setSamplesPerDispatch(static_cast<uint32_t>(settings.SamplesPerDispatch));
+		computeTracer_->setTiling(settings.TiledDispatch, settings.FrameBudget);
+		computeTracer_->recordTrace(commandBuffer, static_cast<uint32_t>(imgWidth), static_cast<uint32_t>(imgHeight));
+		computeProfiler_->EndRegion(commandBuffer);
 	}
+
+	// Copy the result into the display image and release it to the graphics queue. The compute queue takes the
+	// image over without an ownership transfer back, its old contents are not needed.
+	computeProfiler_->BeginRegion(commandBuffer, "Display copy");
+	const VkImageSubresourceRange colorRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	const uint32_t computeFamily = device_->ComputeFamilyIndex();
+	const uint32_t graphicsFamily = device_->GraphicsFamilyIndex();
+
+	ImageMemoryBarrier::Insert(commandBuffer, computeImage_->Handle(), colorRange,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+		VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, computeFamily, computeFamily);
+	ImageMemoryBarrier::Insert(commandBuffer, target.image->Handle(), colorRange,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, computeFamily, computeFamily);
+
+	VkImageCopy region = {};
+	region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.dstSubresource = region.srcSubresource;
+	region.extent = { computeImage_->Extent().width, computeImage_->Extent().height, 1 };
+	vkCmdCopyImage(commandBuffer, computeImage_->Handle(), VK_IMAGE_LAYOUT_GENERAL, target.image->Handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	ImageMemoryBarrier::Insert(commandBuffer, target.image->Handle(), colorRange,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, computeFamily, graphicsFamily);
+
+	// the next trace writes the result only after the copy has read it
+	ImageMemoryBarrier::Insert(commandBuffer, computeImage_->Handle(), colorRange,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, computeFamily, computeFamily);
+	computeProfiler_->EndRegion(commandBuffer);
 }
 
 void Application::Render(VkCommandBuffer commandBuffer, const uint32_t imageIndex)
@@ -429,7 +637,39 @@ void Application::Render(VkCommandBuffer commandBuffer, const uint32_t imageInde
 	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 
 	frameStats.initView = viewportInit;
+	const auto& scene = computeTracer_->Snapshot();
+	frameStats.bvhFinal = scene.bvhQuality == BVHQuality::Final;
+	frameStats.bvhNodes = static_cast<uint32_t>(scene.bvhNodes->size());
+	frameStats.bvhBuildTime = scene.bvhBuildTime;
+	const auto& trace = computeTracer_->Statistics();
+	frameStats.simdUtilisation = trace.simdUtilisation;
+	frameStats.traceTime = trace.gpuTime;
+	frameStats.tiles = trace.tiles;
+	frameStats.tileCount = trace.tileCount;
+	frameStats.samplesPerFrame = trace.samples;
+	frameStats.rays = trace.rays;
+	frameStats.workers = Utilities::JobSystem::Get().Statistics();
+	frameStats.memoryHeaps = device_->MemoryAllocator().Statistics();
+	frameStats.workgroups = workgroupTuner_->Candidates();
+	frameStats.workgroup = workgroupTuner_->Best() != nullptr ? workgroupTuner_->Best()->name : nullptr;
+	frameStats.rayQuerySupported = computeTracer_->RayQuerySupported();
+	frameStats.visibilitySupported = computeTracer_->VisibilitySupported();
+	frameStats.subgroupTraversalSupported = computeTracer_->SubgroupTraversalSupported();
+	frameStats.halfShadingSupported = computeTracer_->HalfShadingSupported();
+	frameStats.traversalTimes = traversalTimes_;
+
+	if (settings.LogGpuTimings != loggingGpuTimings_)
+	{
+		loggingGpuTimings_ = settings.LogGpuTimings;
+		computeProfiler_->SetLog(loggingGpuTimings_ ? "gpu_compute.csv" : "");
+		graphicsProfiler_->SetLog(loggingGpuTimings_ ? "gpu_graphics.csv" : "");
+	}
 
+	graphicsProfiler_->BeginFrame(commandBuffer, static_cast<uint32_t>(currentFrame_));
+	frameStats.gpuPasses = computeProfiler_->Regions();
+	frameStats.gpuPasses.insert(frameStats.gpuPasses.end(), graphicsProfiler_->Regions().begin(), graphicsProfiler_->Regions().end());
+
+	displayed_ = nullptr;
 	if (viewportInit)
 	{
 		renderPassInfo.renderPass = viewportRenderPass_->Handle();
@@ -437,15 +677,27 @@ void Application::Render(VkCommandBuffer commandBuffer, const uint32_t imageInde
 		renderPassInfo.pClearValues = clearValues.data();
 		renderPassInfo.renderArea.extent = viewportExtent_;
 
-		if (device_->GraphicsFamilyIndex() != device_->ComputeFamilyIndex())
+		// The newest finished trace, acquired from the compute queue family by the first frame sampling it.
+		for (auto& displayImage : displayImages_)
 		{
-			ImageMemoryBarrier::Insert(commandBuffer, computeImage_->Handle(), { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }, 0, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL);
+			if (displayImage.trace != 0 && displayImage.trace <= computeCompleted_ && (displayed_ == nullptr || displayImage.trace > displayed_->trace))
+			{
+				displayed_ = &displayImage;
+			}
 		}
-		else
+
+		if (displayed_ != nullptr && !displayed_->acquired && device_->GraphicsFamilyIndex() != device_->ComputeFamilyIndex())
 		{
-			ImageMemoryBarrier::Insert(commandBuffer, computeImage_->Handle(), { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL);
+			ImageMemoryBarrier::Insert(commandBuffer, displayed_->image->Handle(), { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 },
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, device_->ComputeFamilyIndex(), device_->GraphicsFamilyIndex());
+		}
+		if (displayed_ != nullptr)
+		{
+			displayed_->acquired = true;
 		}
 
+		graphicsProfiler_->BeginRegion(commandBuffer, "Quad pass");
 		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 		VkViewport viewport{};
 		viewport.x = 0.0f;
@@ -457,17 +709,15 @@ void Application::Render(VkCommandBuffer commandBuffer, const uint32_t imageInde
 		VkRect2D scissor{ {0, 0}, viewportExtent_ };
 		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+		if (displayed_ != nullptr)
 		{
 			quadPipeline_->bindPipeline(commandBuffer);
-			VkDescriptorSet descriptorSet[] = { quadPipeline_->DescriptorSet(imageIndex)};
+			VkDescriptorSet descriptorSet[] = { quadPipeline_->DescriptorSet(imageIndex, static_cast<uint32_t>(displayed_ - displayImages_.data())) };
 			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, quadPipeline_->PipelineLayout().Handle(), 0, 1, descriptorSet, 0, nullptr);
 			quadPipeline_->renderQuad(commandBuffer);
 		}
 		vkCmdEndRenderPass(commandBuffer);
-		if (device_->GraphicsFamilyIndex() != device_->ComputeFamilyIndex())
-		{
-			ImageMemoryBarrier::Insert(commandBuffer, computeImage_->Handle(), { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }, VK_ACCESS_SHADER_WRITE_BIT, 0, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL);
-		}
+		graphicsProfiler_->EndRegion(commandBuffer);
 		frameStats.viewImage = &viewportDsets_[imageIndex];
 	}
 
@@ -480,11 +730,13 @@ void Application::Render(VkCommandBuffer commandBuffer, const uint32_t imageInde
 	renderPassInfo.pClearValues = clearValues.data();
 	renderPassInfo.renderArea.extent = swapChain_->Extent();
 	
+	graphicsProfiler_->BeginRegion(commandBuffer, "ImGui pass");
 	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 	{
 		userInterface_->Render(commandBuffer);
 	}
 	vkCmdEndRenderPass(commandBuffer);
+	graphicsProfiler_->EndRegion(commandBuffer);
 }
 
 void Application::UpdateUniformBuffer(const uint32_t imageIndex)
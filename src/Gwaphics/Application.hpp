@@ -5,6 +5,8 @@
 #include "Pipelines/UniformBuffer.hpp"
 
 #include "UserInterface.hpp"
+#include <array>
+#include <string>
 #include <vector>
 #include <memory>
 #include <chrono>
@@ -18,13 +20,23 @@ namespace Assets
 
 namespace Vulkan 
 {
+	struct DisplayImage
+	{
+		std::unique_ptr<class Image> image;
+		std::unique_ptr<class DeviceMemory> memory;
+		std::unique_ptr<class ImageView> view;
+		uint64_t trace{}; // compute timeline value of the trace copied into it, 0 while it holds none
+		uint64_t lastRead{}; // graphics timeline value of the last frame sampling it
+		bool acquired{}; // the graphics queue family has taken ownership of the current trace
+	};
+
 	class Application
 	{
 	public:
 
 		VULKAN_NON_COPIABLE(Application)
 
-		Application(const WindowConfig& windowConfig, VkPresentModeKHR presentMode, bool enableValidationLayers);
+		Application(const WindowConfig& windowConfig, VkPresentModeKHR presentMode, bool enableValidationLayers, const std::string& scenePath);
 		virtual ~Application();
 
 		const std::vector<VkExtensionProperties>& Extensions() const;
@@ -61,7 +73,7 @@ namespace Vulkan
 		void CreateViewport();
 		void DeleteViewPort();
 		void DrawFrame();
-		void ComputePathTrace(VkCommandBuffer commandBuffer);
+		void ComputePathTrace(VkCommandBuffer commandBuffer, const DisplayImage& target);
 		void Render(VkCommandBuffer commandBuffer, uint32_t imageIndex);
 
 		void OnKey(int key, int scancode, int action, int mods) { }
@@ -74,17 +86,21 @@ namespace Vulkan
 
 		void createComputeTargetImage();
 		void deleteComputeTargetImage();
+		void submitPathTrace();
+		std::vector<VkDescriptorImageInfo> displayImageDescriptors() const;
 		void recordComputeCommands();
 		void UpdateUniformBuffer(uint32_t imageIndex);
 		void RecreateSwapChain();
 
 		const VkPresentModeKHR presentMode_;
+		const std::string scenePath_;
 		
 		std::unique_ptr<class Window> window_;
 		std::unique_ptr<class Instance> instance_;
 		std::unique_ptr<class DebugUtilsMessenger> debugUtilsMessenger_;
 		std::unique_ptr<class Surface> surface_;
 		std::unique_ptr<class Device> device_;
+		std::unique_ptr<class PipelineCache> pipelineCache_;
 		std::unique_ptr<class SwapChain> swapChain_;
 		//std::vector<Assets::UniformBuffer> uniformBuffers_;
 		std::unique_ptr<class DepthBuffer> depthBuffer_;
@@ -125,9 +141,26 @@ namespace Vulkan
 		VkDescriptorImageInfo computeImageDescriptorInfo_;
 
 		std::unique_ptr<class ComputeTracer> computeTracer_;
+		std::unique_ptr<class WorkgroupTuner> workgroupTuner_;
+		std::vector<Statistics::TraversalTime> traversalTimes_;
 		std::unique_ptr<class CommandPool> computeCommandPool_;
 		std::unique_ptr<class CommandBuffers> computeCommandBuffers_;
-		std::unique_ptr<class Fence> computeFence_;
+
+		// The compute queue runs decoupled from the frame loop: a new trace is submitted whenever the last one has
+		// finished, and copies its result into the display image the frames are not sampling. The timelines count
+		// finished traces and frames, the CPU only polls them.
+		std::unique_ptr<class TimelineSemaphore> computeTimeline_;
+		std::unique_ptr<class TimelineSemaphore> graphicsTimeline_;
+		uint64_t computeSubmitted_{};
+		uint64_t graphicsSubmitted_{};
+		std::array<DisplayImage, 2> displayImages_;
+		uint64_t computeCompleted_{};
+		DisplayImage* displayed_{}; // sampled by the frame being recorded
+
+		// GPU time per region of the trace and frame submissions, written to CSV files while logging is on.
+		std::unique_ptr<class GpuProfiler> computeProfiler_;
+		std::unique_ptr<class GpuProfiler> graphicsProfiler_;
+		bool loggingGpuTimings_{};
 
 		Statistics frameStats;
 		UserSettings settings;
@@ -0,0 +1,313 @@
+#include "HeadlessRenderer.hpp"
+#include "Vulkan/Buffer.hpp"
+#include "Vulkan/CommandBuffers.hpp"
+#include "Vulkan/CommandPool.hpp"
+#include "Vulkan/DebugUtilsMessenger.hpp"
+#include "Vulkan/Device.hpp"
+#include "Vulkan/DeviceMemory.hpp"
+#include "Vulkan/Fence.hpp"
+#include "Vulkan/Image.hpp"
+#include "Vulkan/ImageMemoryBarrier.hpp"
+#include "Vulkan/ImageView.hpp"
+#include "Vulkan/Instance.hpp"
+#include "Vulkan/PipelineCache.hpp"
+#include "Vulkan/SingleTimeCommands.hpp"
+#include "Gwaphics/Pipelines/TracerDeviceFeatures.hpp"
+#include "Gwaphics/Pipelines/WorkgroupTuner.hpp"
+#include "Gwaphics/Utilities/ImageDifference.hpp"
+#include "Gwaphics/Utilities/ImageWriter.hpp"
+
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+namespace Vulkan
+{
+HeadlessRenderer::HeadlessRenderer(const bool enableValidationLayers, const std::string& scenePath)
+{
+	const auto validationLayers = enableValidationLayers
+		? std::vector<const char*>{"VK_LAYER_KHRONOS_validation"}
+		: std::vector<const char*>();
+
+	instance_.reset(new Instance(validationLayers, VK_API_VERSION_1_2));
+	debugUtilsMessenger_.reset(enableValidationLayers ? new DebugUtilsMessenger(*instance_, VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT) : nullptr);
+
+	const auto physicalDevice = ChoosePhysicalDevice(instance_->PhysicalDevices());
+	TracerDeviceFeatures features(physicalDevice);
+	device_.reset(new class Device(physicalDevice, *instance_, features.Extensions(), features.Features(), features.Next()));
+
+	pipelineCache_.reset(new PipelineCache(*device_, "pipeline_cache.bin"));
+	commandPool_.reset(new CommandPool(*device_, device_->ComputeFamilyIndex(), true));
+	commandBuffers_.reset(new CommandBuffers(*commandPool_, 1));
+	fence_.reset(new Fence(*device_, false));
+
+	const HeadlessSettings defaults;
+	createTarget(defaults.width, defaults.height);
+	computeTracer_.reset(new class ComputeTracer(*device_, *commandPool_, *pipelineCache_, targetImageDescriptorInfo_, defaults.width, defaults.height, scenePath));
+	workgroupTuner_.reset(new WorkgroupTuner(*device_, "workgroup_tuning.txt"));
+	sceneCamera_ = computeTracer_->SceneEditor().View().camera;
+
+	waitForFinalBVH();
+}
+
+HeadlessRenderer::~HeadlessRenderer()
+{
+	if (device_)
+	{
+		device_->WaitIdle();
+	}
+
+	workgroupTuner_.reset();
+	computeTracer_.reset();
+	if (pipelineCache_)
+	{
+		try
+		{
+			pipelineCache_->Save();
+		}
+		catch (const std::exception& exception)
+		{
+			std::cerr << "failed to save the pipeline cache: " << exception.what() << std::endl;
+		}
+	}
+
+	targetImageView_.reset();
+	targetImage_.reset();
+	targetImageMemory_.reset();
+	fence_.reset();
+	commandBuffers_.reset();
+	commandPool_.reset();
+	pipelineCache_.reset();
+	device_.reset();
+	debugUtilsMessenger_.reset();
+	instance_.reset();
+}
+
+uint32_t HeadlessRenderer::Render(const HeadlessSettings& settings)
+{
+	if (!Utilities::ImageWriter::IsSupported(settings.output))
+	{
+		throw std::runtime_error("unsupported output format '" + settings.output + "', expected .png, .hdr or .exr");
+	}
+
+	uint32_t samples = 0;
+	double seconds = 0.0;
+	Utilities::ImageWriter::Write(settings.output, settings.width, settings.height, trace(settings, samples, seconds));
+
+	std::cout << "Rendered " << settings.output << ": " << settings.width << "x" << settings.height << ", "
+		<< samples << " spp in " << seconds << " s" << std::endl;
+
+	return samples;
+}
+
+void HeadlessRenderer::CompareHalfShading(const HeadlessSettings& settings)
+{
+	if (!Utilities::ImageWriter::IsSupported(settings.output))
+	{
+		throw std::runtime_error("unsupported output format '" + settings.output + "', expected .png, .hdr or .exr");
+	}
+	if (!computeTracer_->HalfShadingSupported() || settings.mode != TracerMode::Megakernel)
+	{
+		throw std::runtime_error("half float shading needs the megakernel and a device with shaderFloat16");
+	}
+	if (settings.samples == 0)
+	{
+		throw std::runtime_error("the comparison needs a sample count");
+	}
+
+	// Sample counts only, both renders have to trace the same number of samples.
+	HeadlessSettings single = settings;
+	single.timeBudget = 0.0;
+	HeadlessSettings half = single;
+	single.halfShading = false;
+	half.halfShading = true;
+
+	std::vector<float> singleImage, halfImage;
+	for (const uint32_t samples : { std::max(settings.samples / 4, 1u), settings.samples })
+	{
+		single.samples = samples;
+		half.samples = samples;
+
+		uint32_t traced = 0;
+		double singleSeconds = 0.0, halfSeconds = 0.0;
+		singleImage = trace(single, traced, singleSeconds);
+		halfImage = trace(half, traced, halfSeconds);
+
+		const auto difference = Utilities::ImageDifference::Of(singleImage, halfImage);
+		std::cout << "Half float shading at " << traced << " spp: relative RMSE " << difference.relativeRmse
+			<< ", relative bias " << difference.relativeBias << ", max difference " << difference.maxDifference
+			<< " (" << singleSeconds << " s fp32, " << halfSeconds << " s fp16)" << std::endl;
+	}
+
+	Utilities::ImageWriter::Write(settings.output, settings.width, settings.height, halfImage);
+	Utilities::ImageWriter::Write(settings.output + ".diff.exr", settings.width, settings.height, Utilities::ImageDifference::Image(singleImage, halfImage));
+}
+
+std::vector<float> HeadlessRenderer::trace(const HeadlessSettings& settings, uint32_t& samples, double& seconds)
+{
+	const auto extent = targetImage_->Extent();
+	if (extent.width != settings.width || extent.height != settings.height)
+	{
+		device_->WaitIdle();
+		createTarget(settings.width, settings.height);
+		computeTracer_->resizeComputeTarget(settings.width, settings.height, targetImageDescriptorInfo_);
+	}
+
+	computeTracer_->setCamera(settings.camera ? *settings.camera : sceneCamera_);
+	computeTracer_->setMode(settings.mode);
+	TracerVariant variant = PresetVariant(settings.preset);
+	workgroupTuner_->Apply(variant);
+	variant.rayQuery = settings.rayQuery && settings.mode == TracerMode::Megakernel && computeTracer_->RayQuerySupported();
+	variant.visibilityBuffer = settings.visibilityBuffer && settings.mode == TracerMode::Megakernel && computeTracer_->VisibilitySupported();
+	variant.subgroupTraversal = settings.subgroupTraversal && !variant.rayQuery && settings.mode == TracerMode::Megakernel && computeTracer_->SubgroupTraversalSupported();
+	variant.halfShading = settings.halfShading && settings.mode == TracerMode::Megakernel && computeTracer_->HalfShadingSupported();
+	computeTracer_->setVariant(variant);
+
+	const uint32_t samplesPerDispatch = settings.samples != 0
+		? std::max(1u, std::min(settings.samplesPerDispatch, settings.samples))
+		: std::max(1u, settings.samplesPerDispatch);
+	computeTracer_->setSamplesPerDispatch(samplesPerDispatch);
+	// nothing to keep interactive, whole frames are the fewest submits
+	computeTracer_->setTiling(false, 0.0f);
+	computeTracer_->resetAccumulation();
+
+	// Back to back on the compute queue, no swap chain to wait on. Each dispatch is waited for so a time
+	// budget overshoots by at most one of them.
+	const auto start = std::chrono::steady_clock::now();
+	samples = 0;
+	seconds = 0.0;
+	do
+	{
+		computeTracer_->updateScene();
+		const auto commandBuffer = commandBuffers_->Begin(0);
+		computeTracer_->recordSceneUpdates(commandBuffer);
+		computeTracer_->recordTrace(commandBuffer, settings.width, settings.height);
+		commandBuffers_->End(0);
+
+		submit(commandBuffer);
+		samples += samplesPerDispatch;
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+	while ((settings.samples == 0 || samples < settings.samples) && (settings.timeBudget <= 0.0 || seconds < settings.timeBudget)
+		&& (settings.samples != 0 || settings.timeBudget > 0.0));
+
+	return readTarget();
+}
+
+void HeadlessRenderer::createTarget(const uint32_t width, const uint32_t height)
+{
+	targetImageView_.reset();
+	targetImage_.reset();
+	targetImageMemory_.reset();
+
+	targetImage_ = std::make_unique<Image>(*device_, VkExtent2D{ width, height }, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+	targetImageMemory_ = std::make_unique<DeviceMemory>(targetImage_->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+	targetImage_->TransitionImageLayout(*commandPool_, VK_IMAGE_LAYOUT_GENERAL);
+	targetImageView_ = std::make_unique<ImageView>(*device_, targetImage_->Handle(), targetImage_->Format(), VK_IMAGE_ASPECT_COLOR_BIT);
+	targetImageDescriptorInfo_ = {};
+	targetImageDescriptorInfo_.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+	targetImageDescriptorInfo_.imageView = targetImageView_->Handle();
+}
+
+void HeadlessRenderer::submit(VkCommandBuffer commandBuffer)
+{
+	// The first commands wait for the scene upload on the transfer queue.
+	const auto upload = computeTracer_->UploadWait();
+	VkSemaphore waitSemaphores[] = { upload.first };
+	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+	const uint64_t waitValues[] = { upload.second };
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = 1;
+	timelineInfo.pWaitSemaphoreValues = waitValues;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	if (upload.first != nullptr)
+	{
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.pWaitSemaphores = waitSemaphores;
+		submitInfo.pWaitDstStageMask = waitStages;
+	}
+
+	Check(vkQueueSubmit(device_->ComputeQueue(), 1, &submitInfo, fence_->Handle()),
+		"submit compute command buffer");
+
+	fence_->Wait(UINT64_MAX);
+	fence_->Reset();
+}
+
+void HeadlessRenderer::waitForFinalBVH()
+{
+	// The editor publishes a preview BVH first and the SAH one once it is built, an offline render only
+	// wants to trace the latter.
+	while (true)
+	{
+		const bool changed = computeTracer_->updateScene();
+		if (changed)
+		{
+			const auto commandBuffer = commandBuffers_->Begin(0);
+			computeTracer_->recordSceneUpdates(commandBuffer);
+			commandBuffers_->End(0);
+			submit(commandBuffer);
+		}
+
+		if (computeTracer_->Snapshot().bvhQuality == BVHQuality::Final)
+		{
+			break;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+std::vector<float> HeadlessRenderer::readTarget()
+{
+	const auto extent = targetImage_->Extent();
+	const size_t texels = static_cast<size_t>(extent.width) * extent.height;
+	const size_t size = texels * 4 * sizeof(uint16_t);
+
+	Buffer staging(*device_, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	DeviceMemory stagingMemory = staging.AllocateMemory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	SingleTimeCommands::Submit(*commandPool_, [&](VkCommandBuffer commandBuffer)
+	{
+		VkImageSubresourceRange subresourceRange = {};
+		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		subresourceRange.levelCount = 1;
+		subresourceRange.layerCount = 1;
+
+		ImageMemoryBarrier::Insert(commandBuffer, targetImage_->Handle(), subresourceRange,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+			VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+			device_->ComputeFamilyIndex(), device_->ComputeFamilyIndex());
+
+		VkBufferImageCopy region = {};
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent = { extent.width, extent.height, 1 };
+
+		vkCmdCopyImageToBuffer(commandBuffer, targetImage_->Handle(), VK_IMAGE_LAYOUT_GENERAL, staging.Handle(), 1, &region);
+	});
+
+	std::vector<uint16_t> halves(texels * 4);
+	const auto data = stagingMemory.Map(0, size);
+	std::memcpy(halves.data(), data, size);
+	stagingMemory.Unmap();
+
+	std::vector<float> rgba(halves.size());
+	std::transform(halves.begin(), halves.end(), rgba.begin(), [](const uint16_t half) { return glm::unpackHalf1x16(half); });
+
+	return rgba;
+}
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Vulkan/Vulkan.hpp"
+#include "Pipelines/ComputeTracer.hpp"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Vulkan
+{
+	class CommandBuffers;
+	class CommandPool;
+	class DebugUtilsMessenger;
+	class Device;
+	class DeviceMemory;
+	class Fence;
+	class Image;
+	class ImageView;
+	class Instance;
+	class PipelineCache;
+	class WorkgroupTuner;
+
+	struct HeadlessSettings
+	{
+		std::string output; // .png, .hdr or .exr
+		uint32_t width = 1280;
+		uint32_t height = 720;
+		// The render stops at whichever limit comes first, 0 for no limit. At least one dispatch is traced.
+		uint32_t samples = 256; // per pixel, rounded up to whole dispatches
+		double timeBudget = 0.0; // seconds of tracing
+		uint32_t samplesPerDispatch = 16;
+		TracerMode mode = TracerMode::Megakernel;
+		TracerPreset preset = TracerPreset::Reference;
+		bool rayQuery = false; // megakernel only, ignored without device support
+		bool visibilityBuffer = false; // megakernel only, ignored without device support
+		bool subgroupTraversal = false; // megakernel only, ignored with ray queries or without device support
+		bool halfShading = false; // megakernel only, ignored without device support
+		std::optional<CameraDescription> camera; // the scene's camera if not set
+	};
+
+	// Offline rendering without a window: only an instance and a device, no surface, swap chain or UI. Traces
+	// the scene back to back on the compute queue and writes the result to an image file. The device, pipelines
+	// and scene stay resident between renders, a render only changes the camera, resolution and variant.
+	class HeadlessRenderer final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(HeadlessRenderer)
+
+		HeadlessRenderer(bool enableValidationLayers, const std::string& scenePath);
+		~HeadlessRenderer();
+
+		// Renders from scratch and writes the image, returns the samples per pixel traced.
+		uint32_t Render(const HeadlessSettings& settings);
+		// Renders the settings with 32 bit and with half float BSDF colour terms, from the same random sequences,
+		// and prints how far apart the two are after a quarter and after all of the samples. Without a bias the
+		// difference is noise from paths that took other lobes, and shrinks with the samples. Writes the half
+		// float render, and the absolute difference beside it as <output>.diff.exr.
+		void CompareHalfShading(const HeadlessSettings& settings);
+
+		const class Device& Device() const { return *device_; }
+		const CameraDescription& SceneCamera() const { return sceneCamera_; }
+		class ComputeTracer& ComputeTracer() { return *computeTracer_; }
+
+	private:
+
+		void createTarget(uint32_t width, uint32_t height);
+		void submit(VkCommandBuffer commandBuffer);
+		void waitForFinalBVH();
+		// Traces the settings from scratch and reads the image back.
+		std::vector<float> trace(const HeadlessSettings& settings, uint32_t& samples, double& seconds);
+		std::vector<float> readTarget();
+
+		std::unique_ptr<Instance> instance_;
+		std::unique_ptr<DebugUtilsMessenger> debugUtilsMessenger_;
+		std::unique_ptr<class Device> device_;
+		std::unique_ptr<PipelineCache> pipelineCache_;
+		std::unique_ptr<CommandPool> commandPool_;
+		std::unique_ptr<CommandBuffers> commandBuffers_;
+		std::unique_ptr<Fence> fence_;
+
+		// the tracer's result image, rgba16f like the windowed one
+		std::unique_ptr<Image> targetImage_;
+		std::unique_ptr<DeviceMemory> targetImageMemory_;
+		std::unique_ptr<ImageView> targetImageView_;
+		VkDescriptorImageInfo targetImageDescriptorInfo_{};
+
+		std::unique_ptr<class ComputeTracer> computeTracer_;
+		std::unique_ptr<WorkgroupTuner> workgroupTuner_;
+		CameraDescription sceneCamera_;
+	};
+
+}
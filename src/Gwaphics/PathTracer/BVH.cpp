@@ -0,0 +1,360 @@
+#include "BVH.hpp"
+#include "../Utilities/JobSystem.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+
+namespace Vulkan
+{
+	namespace
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+
+		const int BINS = 8;
+		const unsigned int LBVH_LEAF_SIZE = 4;
+		// Nodes with fewer triangles are built serially, below this a job costs more than it saves.
+		const unsigned int PARALLEL_BUILD_THRESHOLD = 4096;
+
+		struct Bin { AABB bounds; int triCount = 0; };
+
+		// Spreads the lower 10 bits of v so that there are two zero bits between each of them.
+		uint32_t ExpandBits(uint32_t v)
+		{
+			v = (v * 0x00010001u) & 0xFF0000FFu;
+			v = (v * 0x00000101u) & 0x0F00F00Fu;
+			v = (v * 0x00000011u) & 0xC30C30C3u;
+			v = (v * 0x00000005u) & 0x49249249u;
+			return v;
+		}
+
+		uint32_t MortonCode(const glm::vec3& p)
+		{
+			const glm::vec3 q = glm::clamp(p * 1024.f, glm::vec3(0.f), glm::vec3(1023.f));
+			return (ExpandBits(static_cast<uint32_t>(q.x)) << 2) | (ExpandBits(static_cast<uint32_t>(q.y)) << 1) | ExpandBits(static_cast<uint32_t>(q.z));
+		}
+
+		class Builder
+		{
+		public:
+			Builder(const std::vector<TriangleBVHData>& triboundsinfo, std::vector<BVHNode>& bvhNode, std::vector<unsigned int>& triIdx) :
+				triboundsinfo(triboundsinfo), bvhNode(bvhNode), triIdx(triIdx)
+			{
+			}
+
+			void UpdateNodeBounds(unsigned int nodeIdx);
+			void Subdivide(unsigned int nodeIdx, int depth);
+			void BuildMorton(unsigned int nodeIdx);
+
+			std::atomic<unsigned int> nodesUsed = 2;
+			std::atomic<int> maxDepth = 0;
+
+		private:
+			float FindBestSplitPlane(BVHNode& node, int& axis, float& splitPos);
+			float FindBestSplitOnAxis(const BVHNode& node, int a, float& splitPos) const;
+			void UpdateDepth(int depth);
+			template <class Recurse>
+			void RecurseChildren(unsigned int leftChildIdx, const Recurse& recurse);
+			float CalculateNodeCost(BVHNode& node);
+			void SubdivideMorton(unsigned int nodeIdx, int depth);
+			unsigned int FindMortonSplit(unsigned int first, unsigned int last) const;
+			void CreateChildren(unsigned int nodeIdx, unsigned int leftCount);
+
+			const std::vector<TriangleBVHData>& triboundsinfo;
+			std::vector<BVHNode>& bvhNode;
+			std::vector<unsigned int>& triIdx;
+			std::vector<uint32_t> mortonCodes;
+		};
+
+		void Builder::UpdateNodeBounds(unsigned int nodeIdx)
+		{
+			BVHNode& node = bvhNode[nodeIdx];
+			AABB nodeBound;
+			for (unsigned int first = node.leftFirst, i = 0; i < node.triCount; i++)
+			{
+				unsigned int leafTriIdx = triIdx[first + i];
+				const TriangleBVHData& leafTri = triboundsinfo[leafTriIdx];
+				AABB triBound = leafTri.triBound;
+				nodeBound.grow(triBound);
+			}
+			node.minx = nodeBound.bmin.x;
+			node.miny = nodeBound.bmin.y;
+			node.minz = nodeBound.bmin.z;
+			node.maxx = nodeBound.bmax.x;
+			node.maxy = nodeBound.bmax.y;
+			node.maxz = nodeBound.bmax.z;
+		}
+
+		float Builder::FindBestSplitOnAxis(const BVHNode& node, int a, float& splitPos) const
+		{
+			float bestCost = std::numeric_limits<float>::infinity();
+			float boundsMin = std::numeric_limits<float>::infinity(), boundsMax = -std::numeric_limits<float>::infinity();
+			for (unsigned int i = 0; i < node.triCount; i++)
+			{
+				const TriangleBVHData& tri = triboundsinfo[triIdx[node.leftFirst + i]];
+				glm::vec3 cent = tri.centroid;
+				boundsMin = std::min(boundsMin, cent[a]);
+				boundsMax = std::max(boundsMax, cent[a]);
+			}
+			if (boundsMin == boundsMax) return bestCost;
+			// populate the bins
+			Bin bin[BINS];
+			float scale = BINS / (boundsMax - boundsMin);
+			for (unsigned int i = 0; i < node.triCount; i++)
+			{
+				const TriangleBVHData& tri = triboundsinfo[triIdx[node.leftFirst + i]];
+				glm::vec3 cent = tri.centroid;
+				int binIdx = std::min(BINS - 1, (int)((cent[a] - boundsMin) * scale));
+				AABB triBound = tri.triBound;
+				bin[binIdx].triCount++;
+				bin[binIdx].bounds.grow(triBound);
+			}
+			// gather data for the 7 planes between the 8 bins
+			float leftArea[BINS - 1], rightArea[BINS - 1];
+			int leftCount[BINS - 1], rightCount[BINS - 1];
+			AABB leftBox, rightBox;
+			int leftSum = 0, rightSum = 0;
+			for (int i = 0; i < BINS - 1; i++)
+			{
+				leftSum += bin[i].triCount;
+				leftCount[i] = leftSum;
+				leftBox.grow(bin[i].bounds);
+				leftArea[i] = leftBox.area();
+				rightSum += bin[BINS - 1 - i].triCount;
+				rightCount[BINS - 2 - i] = rightSum;
+				rightBox.grow(bin[BINS - 1 - i].bounds);
+				rightArea[BINS - 2 - i] = rightBox.area();
+			}
+			// calculate SAH cost for the 7 planes
+			scale = (boundsMax - boundsMin) / BINS;
+			for (int i = 0; i < BINS - 1; i++)
+			{
+				float planeCost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+				if (planeCost < bestCost)
+					splitPos = boundsMin + scale * (i + 1), bestCost = planeCost;
+			}
+			return bestCost;
+		}
+
+		float Builder::FindBestSplitPlane(BVHNode& node, int& axis, float& splitPos)
+		{
+			float axisCost[3], axisSplit[3];
+			const auto evaluate = [&](const size_t first, const size_t last)
+			{
+				for (size_t a = first; a < last; a++)
+					axisCost[a] = FindBestSplitOnAxis(node, static_cast<int>(a), axisSplit[a]);
+			};
+
+			// the top levels see most of the triangles and would otherwise run on a single thread
+			if (node.triCount >= PARALLEL_BUILD_THRESHOLD)
+				Utilities::JobSystem::Get().ParallelFor(0, 3, 1, evaluate);
+			else
+				evaluate(0, 3);
+
+			float bestCost = std::numeric_limits<float>::infinity();
+			for (int a = 0; a < 3; a++)
+			{
+				if (axisCost[a] < bestCost)
+					axis = a, splitPos = axisSplit[a], bestCost = axisCost[a];
+			}
+			return bestCost;
+		}
+
+		float Builder::CalculateNodeCost(BVHNode& node)
+		{
+			float ex = node.maxx - node.minx; // extent of the node
+			float ey = node.maxy - node.miny;
+			float ez = node.maxz - node.minz;
+			float surfaceArea = ex * ey + ey * ez + ez * ex;
+			return node.triCount * surfaceArea;
+		}
+
+		void Builder::CreateChildren(unsigned int nodeIdx, unsigned int leftCount)
+		{
+			BVHNode& node = bvhNode[nodeIdx];
+			int leftChildIdx = nodesUsed.fetch_add(2, std::memory_order_relaxed);
+			int rightChildIdx = leftChildIdx + 1;
+			bvhNode[leftChildIdx].leftFirst = node.leftFirst;
+			bvhNode[leftChildIdx].triCount = leftCount;
+			bvhNode[rightChildIdx].leftFirst = node.leftFirst + leftCount;
+			bvhNode[rightChildIdx].triCount = node.triCount - leftCount;
+			node.leftFirst = leftChildIdx;
+			node.triCount = 0;
+			UpdateNodeBounds(leftChildIdx);
+			UpdateNodeBounds(rightChildIdx);
+		}
+
+		void Builder::UpdateDepth(int depth)
+		{
+			int current = maxDepth.load(std::memory_order_relaxed);
+			while (depth > current && !maxDepth.compare_exchange_weak(current, depth, std::memory_order_relaxed))
+			{
+			}
+		}
+
+		// Builds the left subtree as a job while this thread takes the right one, as long as both are big enough to be worth it.
+		template <class Recurse>
+		void Builder::RecurseChildren(unsigned int leftChildIdx, const Recurse& recurse)
+		{
+			const unsigned int smallerCount = std::min(bvhNode[leftChildIdx].triCount, bvhNode[leftChildIdx + 1].triCount);
+			if (smallerCount < PARALLEL_BUILD_THRESHOLD)
+			{
+				recurse(leftChildIdx);
+				recurse(leftChildIdx + 1);
+				return;
+			}
+
+			auto& jobs = Utilities::JobSystem::Get();
+			Utilities::JobCounter counter;
+			jobs.Run([&recurse, leftChildIdx]() { recurse(leftChildIdx); }, counter);
+			recurse(leftChildIdx + 1);
+			jobs.Wait(counter);
+		}
+
+		void Builder::Subdivide(unsigned int nodeIdx, int depth)
+		{
+			// terminate recursion
+			BVHNode& node = bvhNode[nodeIdx];
+			// determine split axis using SAH
+			int axis;
+			float splitPos;
+			float splitCost = FindBestSplitPlane(node, axis, splitPos);
+			float nosplitCost = CalculateNodeCost(node);
+			if (splitCost >= nosplitCost) return;
+			UpdateDepth(depth);
+			// in-place partition
+			int i = node.leftFirst;
+			int j = i + node.triCount - 1;
+			while (i <= j)
+			{
+				const TriangleBVHData& tri = triboundsinfo[triIdx[i]];
+				glm::vec3 cent = tri.centroid;
+
+				if (cent[axis] < splitPos)
+					i++;
+				else
+					std::swap(triIdx[i], triIdx[j--]);
+			}
+			// abort split if one of the sides is empty
+			unsigned int leftCount = i - node.leftFirst;
+			if (leftCount == 0 || leftCount == node.triCount) return;
+			// create child nodes
+			CreateChildren(nodeIdx, leftCount);
+			// recurse
+			RecurseChildren(node.leftFirst, [this, depth](unsigned int childIdx) { Subdivide(childIdx, depth + 1); });
+		}
+
+		void Builder::BuildMorton(unsigned int nodeIdx)
+		{
+			const BVHNode& root = bvhNode[nodeIdx];
+			AABB centroidBounds;
+			for (unsigned int i = 0; i < root.triCount; i++)
+			{
+				centroidBounds.grow(triboundsinfo[triIdx[root.leftFirst + i]].centroid);
+			}
+			const glm::vec3 extent = glm::max(centroidBounds.bmax - centroidBounds.bmin, glm::vec3(1e-12f));
+
+			// sort the triangles along the Morton curve through their centroids
+			std::vector<std::pair<uint32_t, unsigned int>> keys(root.triCount);
+			Utilities::JobSystem::Get().ParallelFor(0, root.triCount, PARALLEL_BUILD_THRESHOLD, [&](const size_t first, const size_t last)
+			{
+				for (size_t i = first; i < last; i++)
+				{
+					const unsigned int tri = triIdx[root.leftFirst + i];
+					keys[i] = { MortonCode((triboundsinfo[tri].centroid - centroidBounds.bmin) / extent), tri };
+				}
+			});
+			std::sort(keys.begin(), keys.end());
+
+			mortonCodes.resize(triIdx.size());
+			for (unsigned int i = 0; i < root.triCount; i++)
+			{
+				mortonCodes[root.leftFirst + i] = keys[i].first;
+				triIdx[root.leftFirst + i] = keys[i].second;
+			}
+
+			SubdivideMorton(nodeIdx, 0);
+		}
+
+		// Returns the last index of the left half: the position where the highest differing bit of the codes in [first, last] flips.
+		unsigned int Builder::FindMortonSplit(unsigned int first, unsigned int last) const
+		{
+			const uint32_t firstCode = mortonCodes[first];
+			const uint32_t lastCode = mortonCodes[last];
+			if (firstCode == lastCode)
+			{
+				return (first + last) >> 1;
+			}
+
+			const int commonPrefix = std::countl_zero(firstCode ^ lastCode);
+			unsigned int split = first;
+			unsigned int step = last - first;
+			do
+			{
+				step = (step + 1) >> 1;
+				const unsigned int newSplit = split + step;
+				if (newSplit < last && std::countl_zero(firstCode ^ mortonCodes[newSplit]) > commonPrefix)
+				{
+					split = newSplit;
+				}
+			} while (step > 1);
+
+			return split;
+		}
+
+		void Builder::SubdivideMorton(unsigned int nodeIdx, int depth)
+		{
+			BVHNode& node = bvhNode[nodeIdx];
+			if (node.triCount <= LBVH_LEAF_SIZE) return;
+			UpdateDepth(depth);
+
+			const unsigned int first = node.leftFirst;
+			const unsigned int split = FindMortonSplit(first, first + node.triCount - 1);
+			CreateChildren(nodeIdx, split - first + 1);
+
+			RecurseChildren(node.leftFirst, [this, depth](unsigned int childIdx) { SubdivideMorton(childIdx, depth + 1); });
+		}
+	}
+
+	BVH BVH::Build(const std::vector<Tri>& triangles, const std::vector<TriangleBVHData>& triboundsinfo, const BVHQuality quality)
+	{
+		BVH bvh;
+		bvh.quality = quality;
+
+		unsigned int N = static_cast<unsigned int>(triangles.size());
+		std::vector<unsigned int> triIdx(N);
+		std::iota(triIdx.begin(), triIdx.end(), 0u);
+
+		// create the BVH node pool and assign all triangles to the root node
+		bvh.nodes.resize(std::max(N * 2, 2u));
+		BVHNode& root = bvh.nodes[0];
+		root.leftFirst = 0, root.triCount = N;
+
+		Builder builder(triboundsinfo, bvh.nodes, triIdx);
+		builder.UpdateNodeBounds(0);
+
+		// subdivide recursively
+		auto t1 = Clock::now();
+		if (quality == BVHQuality::Preview)
+			builder.BuildMorton(0);
+		else
+			builder.Subdivide(0, 0);
+		auto t2 = Clock::now();
+
+		const unsigned int nodesUsed = builder.nodesUsed;
+		bvh.nodes.resize(nodesUsed);
+		bvh.depth = builder.maxDepth;
+		bvh.buildTime = std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count() * 1000;
+
+		bvh.triangles.reserve(N);
+		for (unsigned int i = 0; i < N; i++)
+		{
+			bvh.triangles.push_back(triangles[triIdx[i]]);
+		}
+
+		printf("%s BVH (%u nodes, depth %i) constructed in %.8fms.\n", quality == BVHQuality::Preview ? "LBVH" : "SAH", nodesUsed, bvh.depth, bvh.buildTime);
+		return bvh;
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <vector>
+#include "Model.hpp"
+
+namespace Vulkan
+{
+	struct BVHNode
+	{
+		float minx, miny, minz;
+		uint32_t leftFirst;
+		float maxx, maxy, maxz;
+		uint32_t triCount;
+	};
+
+	enum class BVHQuality
+	{
+		Preview, // Morton ordered LBVH, cheap enough to build before the first frame.
+		Final    // Binned SAH, slower to build but much faster to trace.
+	};
+
+	class BVH final
+	{
+	public:
+		static BVH Build(const std::vector<Tri>& triangles, const std::vector<TriangleBVHData>& triboundsinfo, BVHQuality quality);
+
+		std::vector<BVHNode> nodes;
+		std::vector<Tri> triangles; // triangles in leaf order, as referenced by the nodes
+		BVHQuality quality = BVHQuality::Preview;
+		int depth = 0;
+		double buildTime = 0.0; // ms
+	};
+}
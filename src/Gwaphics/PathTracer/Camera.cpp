@@ -1,5 +1,6 @@
 #include "Camera.hpp"
 #include "../Vulkan/Buffer.hpp"
+#include <cstring>
 #include <iostream>
 namespace Vulkan
 {
@@ -8,13 +9,18 @@ namespace Vulkan
 		forwardDir(forward),
 		position(pos)
 	{
-		const auto bufferSize = sizeof(RayGenUBO);
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(device.PhysicalDevice(), &properties);
+		const VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+		slotStride_ = (sizeof(RayGenUBO) + alignment - 1) / alignment * alignment;
+		const auto bufferSize = Slots * slotStride_;
 
 		buffer_.reset(new Vulkan::Buffer(device, bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT));
 		memory_.reset(new Vulkan::DeviceMemory(buffer_->AllocateMemory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)));
+		data_ = static_cast<uint8_t*>(memory_->Map(0, bufferSize));
 		
 		uniformBufferInfo.buffer = buffer_->Handle();
-		uniformBufferInfo.range = VK_WHOLE_SIZE;
+		uniformBufferInfo.range = sizeof(RayGenUBO);
 		OnResize(imgWidth, imgHeight);
 		//std::cout << "camera made it" << std::endl;
 	}
@@ -38,7 +44,15 @@ namespace Vulkan
 		RecalculateView();
 	}
 
-	void Camera::updateCameraUBO()
+	void Camera::setView(const glm::vec3& pos, const glm::vec3& forward, const Settings& lens)
+	{
+		position = pos;
+		forwardDir = forward;
+		settings = lens;
+		RecalculateView();
+	}
+
+	void Camera::updateCameraUBO(const uint32_t samples)
 	{
 		if (needsUpdate)
 		{
@@ -49,6 +63,7 @@ namespace Vulkan
 
 			cameraUBO.horizontal = glm::vec4(horizontal, 0.f);
 			cameraUBO.vertical = glm::vec4(vertical, 0.f);
+			cameraUBO.environment = glm::vec4(environment, 0.f);
 
 			cameraUBO.invWidth = invWidth;
 			cameraUBO.invHeight = invHeight;
@@ -56,23 +71,19 @@ namespace Vulkan
 			cameraUBO.focusDist = settings.focus_dist;
 			cameraUBO.aperture = aperture;
 			
-			cameraUBO.frameIndex = 1;
+			cameraUBO.firstSample = 1;
 			//cameraUBO.accumulate = settings.accumulate;
 			//cameraUBO.reset = settings.reset;
-
-			const auto data = memory_->Map(0, sizeof(RayGenUBO));
-			std::memcpy(data, &cameraUBO, sizeof(cameraUBO));
-			memory_->Unmap();
 			needsUpdate = false;
-			return;
 		}
 		else
 		{
-			cameraUBO.frameIndex += 1;
-			const auto data = memory_->Map(0, sizeof(RayGenUBO));
-			std::memcpy(data, &cameraUBO, sizeof(cameraUBO));
-			memory_->Unmap();
+			cameraUBO.firstSample += dispatchSamples_;
 		}
+		dispatchSamples_ = samples;
+
+		slot_ = (slot_ + 1) % Slots;
+		std::memcpy(data_ + slot_ * slotStride_, &cameraUBO, sizeof(cameraUBO));
 	}
 
 	void Camera::RecalculateView()
@@ -21,11 +21,12 @@ namespace Vulkan
 		glm::vec4 coord_z;
 		glm::vec4 horizontal;
 		glm::vec4 vertical;
+		glm::vec4 environment; // radiance of rays that leave the scene
 		float invWidth;
 		float invHeight;
 		float focusDist;
 		float aperture;
-		uint32_t frameIndex;
+		uint32_t firstSample; // of the dispatch, counted from 1 since accumulation restarted
 		//uint32_t accumulate;
 		//uint32_t reset;
 	};
@@ -47,13 +48,26 @@ namespace Vulkan
 		~Camera();
 
 		void OnResize(uint32_t width, uint32_t height);
+		void setView(const glm::vec3& pos, const glm::vec3& forward, const Settings& lens);
 		void moveCamera();
 		void rotateCamera();
 		void getSettings();
-		void updateCameraUBO();
+		// Writes the next slot of the constant ring for a dispatch of the given samples per pixel, bind the buffer
+		// at Offset() after it. The sample count may change between dispatches without restarting accumulation.
+		void updateCameraUBO(uint32_t samples);
+		void setEnvironment(const glm::vec3& color) { environment = color; needsUpdate = true; }
+		void resetAccumulation() { needsUpdate = true; }
+		bool accumulationResetPending() const { return needsUpdate; }
+		// A single RayGenUBO, for a VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC binding.
 		const VkDescriptorBufferInfo& getCameraUBOInfo() const { return uniformBufferInfo; }
+		// Dynamic offset of the slot last written.
+		uint32_t Offset() const { return static_cast<uint32_t>(slot_ * slotStride_); }
 		const Vulkan::Buffer& Buffer() const { return *buffer_; }
 
+		// Slots of the constant ring. More than there are traces in flight, so a trace never reads a slot that is
+		// being written.
+		static constexpr uint32_t Slots = 3;
+
 	private:
 		void RecalculateView();
 
@@ -69,15 +83,20 @@ namespace Vulkan
 
 		float aspect{ 0.f };
 		float aperture{ 1.f };
+		glm::vec3 environment{ 0.8f };
 		glm::vec2 m_LastMousePosition{ 0.0f, 0.0f };
 
 		uint32_t m_ViewportWidth = 0, m_ViewportHeight = 0;
 		float invWidth, invHeight;
 		RayGenUBO cameraUBO;
+		uint32_t dispatchSamples_{}; // of the dispatch cameraUBO was last written for
 		bool needsUpdate = true;
 
 		VkDescriptorBufferInfo uniformBufferInfo = {};
 		std::unique_ptr<Vulkan::Buffer> buffer_;
 		std::unique_ptr<Vulkan::DeviceMemory> memory_;
+		uint8_t* data_{}; // persistently mapped
+		VkDeviceSize slotStride_{};
+		uint32_t slot_{};
 	};
 }
\ No newline at end of file
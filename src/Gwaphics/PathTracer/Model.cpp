@@ -1,4 +1,5 @@
 #include "Model.hpp"
+#include "../Utilities/JobSystem.hpp"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
@@ -6,7 +7,8 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/hash.hpp>
 #include <unordered_map>
-#include <iostream>
+#include <algorithm>
+#include <stdexcept>
 
 namespace std
 {
@@ -21,18 +23,8 @@ namespace std
 }
 namespace Vulkan
 {
-    Model::Model(
-        const std::string& filepath, 
-        const Transform& transform, 
-        const uint32_t materialIdx, 
-        std::vector<glm::vec4>& vertices, 
-        std::vector<glm::vec4>& normals, 
-        std::vector<uint32_t>& indices, 
-        std::vector<Tri>& triangles, 
-        std::vector<TriangleBVHData>& triboundsinfo)
+    Mesh Mesh::Load(const std::string& filepath)
     {
-        size_t offset = vertices.size();
-        size_t offsetind = indices.size();
         tinyobj::attrib_t attrib;
         std::vector<tinyobj::shape_t> shapes;
         std::vector<tinyobj::material_t> materials;
@@ -40,11 +32,11 @@ namespace Vulkan
 
         if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str()))
         {
-            std::cout << "pain" << std::endl;
-            throw std::runtime_error(warn + err);
+            throw std::runtime_error("failed to load '" + filepath + "': " + warn + err);
         }
+
+        Mesh mesh;
         std::unordered_map<Vertex, uint32_t> uniqueVertices;
-        glm::mat4 inverseTranspose = glm::transpose(transform.worldToObj);
         for (const auto& shape : shapes)
         {
             for (const auto& index : shape.mesh.indices)
@@ -73,30 +65,59 @@ namespace Vulkan
                         attrib.texcoords[2 * index.texcoord_index + 1],
                     };
                 }
-                if (uniqueVertices.count(vertex) == 0) {
-                    uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size() - offset);
-                    glm::vec4 position(glm::vec3(transform.objToWorld * glm::vec4(vertex.position, 1.f)), vertex.uv.x);
-                    vertices.push_back(position);
-                    glm::vec4 normal(glm::normalize(glm::vec3(inverseTranspose * glm::vec4(vertex.normal, 0.f))), vertex.uv.y);
-                    normals.push_back(normal);
+                const auto [it, inserted] = uniqueVertices.try_emplace(vertex, static_cast<uint32_t>(mesh.vertices.size()));
+                if (inserted) {
+                    mesh.vertices.push_back(vertex);
                 }
-                indices.push_back(uniqueVertices[vertex]);
+                mesh.indices.push_back(it->second);
             }
         }
+        return mesh;
+    }
 
-        for (size_t i = offsetind; i < indices.size(); i += 3)
+    Model::Model(
+        const Mesh& mesh, 
+        const Transform& transform, 
+        const uint32_t materialIdx, 
+        const GeometryOffsets& offsets,
+        std::vector<glm::vec4>& vertices, 
+        std::vector<glm::vec4>& normals, 
+        std::vector<uint32_t>& indices, 
+        std::vector<Tri>& triangles, 
+        std::vector<TriangleBVHData>& triboundsinfo)
+    {
+        auto& jobs = Utilities::JobSystem::Get();
+        const size_t offset = offsets.vertex;
+        const glm::mat4 inverseTranspose = glm::transpose(transform.worldToObj);
+
+        jobs.ParallelFor(0, mesh.vertices.size(), 4096, [&](const size_t first, const size_t last)
+        {
+            for (size_t i = first; i < last; i++)
+            {
+                const Vertex& vertex = mesh.vertices[i];
+                vertices[offset + i] = glm::vec4(glm::vec3(transform.objToWorld * glm::vec4(vertex.position, 1.f)), vertex.uv.x);
+                normals[offset + i] = glm::vec4(glm::normalize(glm::vec3(inverseTranspose * glm::vec4(vertex.normal, 0.f))), vertex.uv.y);
+            }
+        });
+
+        std::copy(mesh.indices.begin(), mesh.indices.end(), indices.begin() + offsets.index);
+
+        jobs.ParallelFor(0, mesh.indices.size() / 3, 4096, [&](const size_t first, const size_t last)
         {
-            glm::vec3 v0 = vertices[offset + indices[i]], v1 = vertices[offset + indices[i+1]], v2 = vertices[offset + indices[i+2]];
-            
-            TriangleBVHData data;
-            data.centroid = (v0 + v1 + v2) / 3.f;
-            data.triBound.grow(v0);
-            data.triBound.grow(v1);
-            data.triBound.grow(v2);
-            triboundsinfo.push_back(data);
+            for (size_t t = first; t < last; t++)
+            {
+                const size_t i = offsets.index + 3 * t;
+                glm::vec3 v0 = vertices[offset + indices[i]], v1 = vertices[offset + indices[i+1]], v2 = vertices[offset + indices[i+2]];
 
-            Tri tri(static_cast<uint32_t>(offset), static_cast<uint32_t>(i), materialIdx, true);
-            triangles.push_back(tri);
-        }
+                TriangleBVHData& data = triboundsinfo[offsets.triangle + t];
+                data = TriangleBVHData{};
+                data.centroid = (v0 + v1 + v2) / 3.f;
+                data.triBound.grow(v0);
+                data.triBound.grow(v1);
+                data.triBound.grow(v2);
+
+                triangles[offsets.triangle + t] = Tri(static_cast<uint32_t>(offset), static_cast<uint32_t>(i), materialIdx, true);
+            }
+        });
     }
 }
\ No newline at end of file
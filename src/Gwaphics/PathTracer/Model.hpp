@@ -35,8 +35,18 @@ namespace Vulkan
 		(hashCombine(seed, rest), ...);
 	};
 
+	struct Material
+	{
+		glm::vec4 albedo; // w: emission strength
+		float roughness;
+		float metalness;
+		float transmission;
+		float ior;
+	};
+
 	struct alignas(16) Tri
 	{
+		Tri() = default;
 		Tri(uint32_t offset, uint32_t firstIndex, uint32_t materialIndex, uint32_t smooth)
 			: modelOffset(offset), v_indices(firstIndex), materialIdx(materialIndex), shadeSmooth(smooth)
 		{};
@@ -60,12 +70,32 @@ namespace Vulkan
 			return position == other.position && normal == other.normal && uv == other.uv;
 		}
 	};
+	// Deduplicated object space geometry of an OBJ file. Loading is self contained, so several meshes can be parsed at once.
+	struct Mesh
+	{
+		static Mesh Load(const std::string& filepath);
+
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	// Where an instance starts in the scene buffers.
+	struct GeometryOffsets
+	{
+		size_t vertex;
+		size_t index;
+		size_t triangle;
+	};
+
+	// Transforms a mesh into world space and packs it at the given offsets of the already sized scene buffers,
+	// so instances can be packed concurrently.
 	struct Model
 	{
 		Model(
-			const std::string& filepath, 
+			const Mesh& mesh, 
 			const Transform& transform, 
 			const uint32_t materialIdx, 
+			const GeometryOffsets& offsets,
 			std::vector<glm::vec4>& vertices,
 			std::vector<glm::vec4>& normals,
 			std::vector<uint32_t>& indices,
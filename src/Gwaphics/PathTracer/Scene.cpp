@@ -1,203 +1,158 @@
 #include "Scene.hpp"
-#include <chrono>
+#include "../Utilities/JobSystem.hpp"
+#include <exception>
 #include <iostream>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtx/string_cast.hpp>
 
 namespace Vulkan
 {
-	typedef std::chrono::high_resolution_clock Clock;
-	Scene::Scene()
+	glm::mat4 SceneInstance::Transform() const
 	{
-		AddMaterial({ 0.7, 0.34, 0.21 }, 1.f);
-		//addModel("assets/bunny.obj", glm::mat4(2.f), 0);
-		AddMaterial({ 0.156863f, 0.803922f, 0.172549f }, 0.f);
-		AddMaterial({ 0.803922f, 0.152941f, 0.152941f }, 0.f);
-		AddMaterial({ 0.803922f, 0.803922f, 0.803922f }, 0.f);
-		AddMaterial({ 0.81, 0.35, 0.07 }, 0.f);
-		addModel("assets/models/Cornell/Left.obj", glm::mat4(1.f), 1);
-		addModel("assets/models/Cornell/Right.obj", glm::mat4(1.f), 2);
-		glm::mat4 transform(4.f);
-		transform = glm::translate(transform, { 0, -0.8, 0 });
-		addModel("assets/models/bunny.obj", transform, 4);
-		addModel("assets/models/Cornell/Bottom.obj", glm::mat4(1.f), 3);
-		addModel("assets/models/Cornell/Back.obj", glm::mat4(1.f), 3);
-
-		for (unsigned int i = 0; i < triangles.size(); i++)
-		{
-			triIdx.push_back(i);
-		}
-		BuildBVH();
-
-		std::vector<Tri> sortedTris;
-		sortedTris.reserve(triangles.size());
-		for (auto i = 0; i < triIdx.size(); i++)
-		{
-			sortedTris.push_back(triangles[triIdx[i]]);
-		}
-		triangles = sortedTris;
+		glm::mat4 edit = glm::translate(glm::mat4(1.f), translation);
+		edit = glm::rotate(edit, glm::radians(rotation.y), { 0.f, 1.f, 0.f });
+		edit = glm::rotate(edit, glm::radians(rotation.x), { 1.f, 0.f, 0.f });
+		edit = glm::rotate(edit, glm::radians(rotation.z), { 0.f, 0.f, 1.f });
+		edit = glm::scale(edit, glm::vec3(scale));
+		return edit * baseTransform;
 	}
 
-	void Scene::AddMaterial(const glm::vec3 albedo, const float& radiance)
+	Scene::Scene(const std::string& filepath)
 	{
-		Material mat;
-		mat.albedo = glm::vec4(albedo, radiance);
-		materials.push_back(mat);
-	}
+		const SceneDescription description = SceneDescription::Load(filepath);
+		materials = description.materials;
+		materialNames = description.materialNames;
+		camera = description.camera;
+		environment = description.environment;
+		for (const auto& mesh : description.meshes)
+		{
+			meshNames.push_back(mesh.name);
+		}
+		LoadGeometry(description);
 
-	void Scene::addModel(const std::string& filepath, Transform transform, uint32_t material)
-	{
-		Model(filepath, transform, material, vertices, normals, indices, triangles, triboundsinfo);
+		sourceTriangles = triangles;
+		SetBVH(BuildBVH(BVHQuality::Preview));
 	}
 
-	static int BVHDepth = 0;
-	void Scene::BuildBVH()
+	void Scene::LoadGeometry(const SceneDescription& description)
 	{
-		unsigned int N = static_cast<unsigned int>(triangles.size());
-		// create the BVH node pool
-		//bvhNode = (BVHNode*)_aligned_malloc(sizeof(BVHNode) * N * 2, 64);
-		bvhNode.resize(N * 2);
-		// populate triangle index array
-		//for (unsigned int i = 0; i < N; i++) triIdx[i] = i;
-		// assign all triangles to root node
-		BVHNode& root = bvhNode[rootNodeIdx];
-		root.leftFirst = 0, root.triCount = N;
-		UpdateNodeBounds(rootNodeIdx);
-		// subdivide recursively
-		auto t1 = Clock::now();
-		Subdivide(rootNodeIdx, 0);
-		auto t2 = Clock::now();
-		std::chrono::duration<double> time_span = std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1);
-		printf("BVH (%i nodes) constructed in %.8fms.\n", nodesUsed, time_span.count() * 1000);
-		std::cout << "BVH Depth: " << BVHDepth << std::endl;
-	}
+		auto& jobs = Utilities::JobSystem::Get();
 
-	void Scene::UpdateNodeBounds(unsigned int nodeIdx)
-	{
-		BVHNode& node = bvhNode[nodeIdx];
-		AABB nodeBound;
-		for (unsigned int first = node.leftFirst, i = 0; i < node.triCount; i++)
+		// every mesh is parsed once, however many instances it has, and not at all if it has none
+		meshes.resize(description.meshes.size());
+		std::vector<std::exception_ptr> errors(description.meshes.size());
+		std::vector<bool> used(description.meshes.size());
+		for (const auto& instance : description.instances)
 		{
-			unsigned int leafTriIdx = triIdx[first + i];
-			TriangleBVHData& leafTri = triboundsinfo[leafTriIdx];
-			nodeBound.grow(leafTri.triBound);
+			used[instance.mesh] = true;
 		}
-		node.minx = nodeBound.bmin.x;
-		node.miny = nodeBound.bmin.y;
-		node.minz = nodeBound.bmin.z;
-		//node.aabbMin = nodeBound.bmin;
-		node.maxx = nodeBound.bmax.x;
-		node.maxy = nodeBound.bmax.y;
-		node.maxz = nodeBound.bmax.z;
-		//node.aabbMax = nodeBound.bmax;
-	}
 
-	static const int BINS = 8;
-	float Scene::FindBestSplitPlane(BVHNode& node, int& axis, float& splitPos)
-	{
-		float bestCost = std::numeric_limits<float>::infinity();
-		for (int a = 0; a < 3; a++)
+		Utilities::JobCounter counter;
+		for (size_t i = 0; i != description.meshes.size(); ++i)
 		{
-			float boundsMin = std::numeric_limits<float>::infinity(), boundsMax = -std::numeric_limits<float>::infinity();
-			for (unsigned int i = 0; i < node.triCount; i++)
+			if (!used[i])
 			{
-				TriangleBVHData& tri = triboundsinfo[triIdx[node.leftFirst + i]];
-				glm::vec3 cent = tri.centroid;
-				boundsMin = std::min(boundsMin, cent[a]);
-				boundsMax = std::max(boundsMax, cent[a]);
+				continue;
 			}
-			if (boundsMin == boundsMax) continue;
-			// populate the bins
-			Bin bin[BINS];
-			float scale = BINS / (boundsMax - boundsMin);
-			for (unsigned int i = 0; i < node.triCount; i++)
+
+			jobs.Run([this, &description, &errors, i]()
 			{
-				TriangleBVHData& tri = triboundsinfo[triIdx[node.leftFirst + i]];
-				glm::vec3 cent = tri.centroid;
-				int binIdx = std::min(BINS - 1, (int)((cent[a] - boundsMin) * scale));
-				bin[binIdx].triCount++;
-				bin[binIdx].bounds.grow(tri.triBound);
-			}
-			// gather data for the 7 planes between the 8 bins
-			float leftArea[BINS - 1], rightArea[BINS - 1];
-			int leftCount[BINS - 1], rightCount[BINS - 1];
-			AABB leftBox, rightBox;
-			int leftSum = 0, rightSum = 0;
-			for (int i = 0; i < BINS - 1; i++)
+				try
+				{
+					meshes[i] = Mesh::Load(description.meshes[i].filepath);
+				}
+				catch (...)
+				{
+					errors[i] = std::current_exception();
+				}
+			}, counter);
+		}
+		jobs.Wait(counter);
+
+		for (const auto& error : errors)
+		{
+			if (error)
 			{
-				leftSum += bin[i].triCount;
-				leftCount[i] = leftSum;
-				leftBox.grow(bin[i].bounds);
-				leftArea[i] = leftBox.area();
-				rightSum += bin[BINS - 1 - i].triCount;
-				rightCount[BINS - 2 - i] = rightSum;
-				rightBox.grow(bin[BINS - 1 - i].bounds);
-				rightArea[BINS - 2 - i] = rightBox.area();
+				std::rethrow_exception(error);
 			}
-			// calculate SAH cost for the 7 planes
-			scale = (boundsMax - boundsMin) / BINS;
-			for (int i = 0; i < BINS - 1; i++)
+		}
+
+		// lay the instances out back to back in file order and size the buffers once
+		instances.resize(description.instances.size());
+		GeometryOffsets total{};
+		for (size_t i = 0; i != instances.size(); ++i)
+		{
+			const InstanceDescription& instance = description.instances[i];
+			const Mesh& mesh = meshes[instance.mesh];
+			instances[i].mesh = instance.mesh;
+			instances[i].material = instance.material;
+			instances[i].baseTransform = instance.transform;
+			instances[i].offsets = total;
+			total.vertex += mesh.vertices.size();
+			total.index += mesh.indices.size();
+			total.triangle += mesh.indices.size() / 3;
+		}
+
+		vertices.resize(total.vertex);
+		normals.resize(total.vertex);
+		indices.resize(total.index);
+		triangles.resize(total.triangle);
+		triboundsinfo.resize(total.triangle);
+
+		jobs.ParallelFor(0, instances.size(), 1, [&](const size_t first, const size_t last)
+		{
+			for (size_t i = first; i < last; i++)
 			{
-				float planeCost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
-				if (planeCost < bestCost)
-					axis = a, splitPos = boundsMin + scale * (i + 1), bestCost = planeCost;
+				const SceneInstance& instance = instances[i];
+				Model(meshes[instance.mesh], Transform(instance.Transform()), instance.material, instance.offsets, vertices, normals, indices, triangles, triboundsinfo);
 			}
-		}
-		return bestCost;
+		});
 	}
 
-	float Scene::CalculateNodeCost(BVHNode& node)
+	void Scene::PackInstance(const uint32_t index)
 	{
-		float ex = node.maxx - node.minx; // extent of the node
-		float ey = node.maxy - node.miny;
-		float ez = node.maxz - node.minz;
-		float surfaceArea = ex * ey + ey * ez + ez * ex;
-		return node.triCount * surfaceArea;
+		// The triangles array is in BVH order, the load-ordered copy is the one the offsets refer to.
+		const SceneInstance& instance = instances[index];
+		const Mesh& mesh = meshes[instance.mesh];
+		Model(mesh, Transform(instance.Transform()), instance.material, instance.offsets, vertices, normals, indices, sourceTriangles, triboundsinfo);
+		dirty.vertices.Mark(instance.offsets.vertex, instance.offsets.vertex + mesh.vertices.size());
 	}
 
-	void Scene::Subdivide(unsigned int nodeIdx, int depth)
+	void Scene::UpdateMaterial(const uint32_t index)
 	{
-		// terminate recursion
-		BVHNode& node = bvhNode[nodeIdx];
-		// determine split axis using SAHw
-		int axis;
-		float splitPos;
-		float splitCost = FindBestSplitPlane(node, axis, splitPos);
-		float nosplitCost = CalculateNodeCost(node);
-		if (splitCost >= nosplitCost) return;
-		if (depth > BVHDepth) BVHDepth = depth;
-		// in-place partition
-		int i = node.leftFirst;
-		int j = i + node.triCount - 1;
-		while (i <= j)
-		{
-			TriangleBVHData& tri = triboundsinfo[triIdx[i]];
-			glm::vec3 cent = tri.centroid;
+		dirty.materials.Mark(index, index + 1);
+	}
 
-			if (cent[axis] < splitPos)
-				i++;
-			else
-				std::swap(triIdx[i], triIdx[j--]);
+	void Scene::UpdateInstances(const std::vector<uint32_t>& indices)
+	{
+		for (const uint32_t index : indices)
+		{
+			PackInstance(index);
 		}
-		// abort split if one of the sides is empty
-		int leftCount = i - node.leftFirst;
-		if (leftCount == 0 || leftCount == node.triCount) return;
-		// create child nodes
-		int leftChildIdx = nodesUsed++;
-		int rightChildIdx = nodesUsed++;
-		bvhNode[leftChildIdx].leftFirst = node.leftFirst;
-		bvhNode[leftChildIdx].triCount = leftCount;
-		bvhNode[rightChildIdx].leftFirst = i;
-		bvhNode[rightChildIdx].triCount = node.triCount - leftCount;
-		node.leftFirst = leftChildIdx;
-		node.triCount = 0;
-		UpdateNodeBounds(leftChildIdx);
-		UpdateNodeBounds(rightChildIdx);
-		// recurse
-		Subdivide(leftChildIdx, depth + 1);
-		Subdivide(rightChildIdx, depth + 1);
+		SetBVH(BuildBVH(BVHQuality::Preview));
+		++geometryVersion;
 	}
 
+	BVH Scene::BuildBVH(BVHQuality quality) const
+	{
+		return BVH::Build(sourceTriangles, triboundsinfo, quality);
+	}
 
+	std::future<BVH> Scene::BuildBVHAsync(BVHQuality quality) const
+	{
+		return std::async(std::launch::async, [triangles = sourceTriangles, bounds = triboundsinfo, quality]()
+		{
+			return BVH::Build(triangles, bounds, quality);
+		});
+	}
+
+	void Scene::SetBVH(BVH&& bvh)
+	{
+		bvhNode = std::move(bvh.nodes);
+		triangles = std::move(bvh.triangles);
+		bvhQuality = bvh.quality;
+		bvhBuildTime = bvh.buildTime;
+		dirty.triangles.Mark(0, triangles.size());
+		dirty.nodes.Mark(0, bvhNode.size());
+	}
 }
\ No newline at end of file
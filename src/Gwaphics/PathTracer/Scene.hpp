@@ -1,40 +1,100 @@
 #pragma once
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <future>
 #include <string>
 #include <vector>
+#include "BVH.hpp"
 #include "Model.hpp"
+#include "SceneDescription.hpp"
 
 namespace Vulkan
 {
-	struct Material
+	// Elements of a scene array changed since their last upload, kept as sorted disjoint [begin, end) spans so two
+	// edits far apart upload only their own elements and not everything in between.
+	struct DirtyRange
 	{
-		glm::vec4 albedo;
+		struct Span
+		{
+			size_t begin;
+			size_t end;
+		};
+		std::vector<Span> spans;
+
+		void Mark(size_t begin, size_t end)
+		{
+			if (begin >= end)
+			{
+				return;
+			}
+
+			// Spans overlapping or touching the new one are folded into it.
+			auto first = std::lower_bound(spans.begin(), spans.end(), begin, [](const Span& span, size_t value) { return span.end < value; });
+			auto last = first;
+			for (; last != spans.end() && last->begin <= end; ++last)
+			{
+				begin = std::min(begin, last->begin);
+				end = std::max(end, last->end);
+			}
+			spans.insert(spans.erase(first, last), { begin, end });
+		}
+		bool Empty() const { return spans.empty(); }
+		void Clear() { spans.clear(); }
+		void Merge(const DirtyRange& other) { for (const Span& span : other.spans) Mark(span.begin, span.end); }
 	};
-	
-	class Scene 
+
+	// What changed in the GPU visible arrays, vertices and normals share a range.
+	struct SceneDelta
 	{
-	private:
-		struct BVHNode
+		DirtyRange vertices;
+		DirtyRange materials;
+		DirtyRange triangles;
+		DirtyRange nodes;
+
+		bool Empty() const { return vertices.Empty() && materials.Empty() && triangles.Empty() && nodes.Empty(); }
+		// Material and geometry changes invalidate what has been accumulated so far, a new tree over the same geometry does not.
+		bool ResetsAccumulation() const { return !vertices.Empty() || !materials.Empty(); }
+
+		void Merge(const SceneDelta& other)
 		{
-			float minx, miny, minz;
-			uint32_t leftFirst;
-			float maxx, maxy, maxz;
-			uint32_t triCount;
-		};
+			vertices.Merge(other.vertices);
+			materials.Merge(other.materials);
+			triangles.Merge(other.triangles);
+			nodes.Merge(other.nodes);
+		}
+	};
 
-		struct Bin { AABB bounds; int triCount = 0; };
+	struct SceneInstance
+	{
+		glm::mat4 Transform() const;
+
+		uint32_t mesh;
+		uint32_t material;
+		glm::mat4 baseTransform; // as given in the scene file
+		// editable, applied on top of the base transform
+		glm::vec3 translation{ 0.f };
+		glm::vec3 rotation{ 0.f }; // degrees
+		float scale = 1.f;
+		GeometryOffsets offsets;
+	};
+
+	class Scene 
+	{
 	public:
-		Scene();
+		explicit Scene(const std::string& filepath);
 
-		void AddMaterial(const glm::vec3 albedo, const float& radiance);
-		void addModel(const std::string& filepath, Transform transform, uint32_t material);
-	private:
-		void BuildBVH();
-		void Subdivide(unsigned int nodeIdx, int depth);
-		void UpdateNodeBounds(unsigned int nodeIdx);
-		float FindBestSplitPlane(BVHNode& node, int& axis, float& splitPos);
-		float CalculateNodeCost(BVHNode& node);
+		BVH BuildBVH(BVHQuality quality) const;
+		// Builds on a background thread from a copy of the current geometry, so edits can carry on meanwhile.
+		std::future<BVH> BuildBVHAsync(BVHQuality quality) const;
+		void SetBVH(BVH&& bvh);
+
+		// Call after changing materials[index], marks it for upload.
+		void UpdateMaterial(uint32_t index);
+		// Call after changing the transforms of the given instances. Repacks their vertices and
+		// swaps in a preview BVH, the final tree has to be rebuilt for the new geometryVersion.
+		void UpdateInstances(const std::vector<uint32_t>& indices);
 	public:
 		std::vector<glm::vec4> vertices;
 		std::vector<glm::vec4> normals;
@@ -44,9 +104,27 @@ namespace Vulkan
 		std::vector<Material> materials;
 		//std::vector<Texture*> textures;
 		std::vector<TriangleBVHData> triboundsinfo;
+		BVHQuality bvhQuality = BVHQuality::Preview;
+		double bvhBuildTime = 0.0;
+		CameraDescription camera;
+		glm::vec3 environment{ 0.8f };
+
+		std::vector<std::string> materialNames;
+		std::vector<std::string> meshNames;
+		std::vector<SceneInstance> instances;
+		uint64_t geometryVersion = 0;
+
+		// changes since this was last cleared
+		SceneDelta dirty;
 	private:
-		std::vector<unsigned int> triIdx;
-		unsigned int rootNodeIdx = 0, nodesUsed = 2;
+		void LoadGeometry(const SceneDescription& description);
+
+		void PackInstance(uint32_t index);
+
+		// object space meshes, kept around to re-transform edited instances
+		std::vector<Mesh> meshes;
+		// triangles in load order, the input of every BVH build
+		std::vector<Tri> sourceTriangles;
 	};
 
 }
\ No newline at end of file
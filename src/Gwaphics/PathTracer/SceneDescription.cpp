@@ -0,0 +1,260 @@
+#include "SceneDescription.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace Vulkan
+{
+	namespace
+	{
+		enum class Block { None, Camera, Material, Instance };
+
+		class Parser
+		{
+		public:
+			Parser(const std::string& filepath) : filepath(filepath) {}
+
+			SceneDescription Parse();
+
+		private:
+			void ParseLine(const std::string& keyword, std::istringstream& args);
+			void ParseCamera(const std::string& keyword, std::istringstream& args);
+			void ParseMaterial(const std::string& keyword, std::istringstream& args);
+			void ParseInstance(const std::string& keyword, std::istringstream& args);
+
+			float ReadFloat(std::istringstream& args);
+			glm::vec3 ReadVec3(std::istringstream& args);
+			std::string ReadName(std::istringstream& args);
+			uint32_t Find(const std::vector<std::string>& names, const std::string& name, const char* kind);
+			[[noreturn]] void Fail(const std::string& message) const;
+
+			const std::string& filepath;
+			unsigned lineNumber = 0;
+			Block block = Block::None;
+			SceneDescription scene;
+		};
+
+		SceneDescription Parser::Parse()
+		{
+			std::ifstream file(filepath);
+			if (!file)
+			{
+				throw std::runtime_error("failed to open scene file '" + filepath + "'");
+			}
+
+			std::string line;
+			while (std::getline(file, line))
+			{
+				++lineNumber;
+				line = line.substr(0, line.find('#'));
+
+				std::istringstream args(line);
+				std::string keyword;
+				if (!(args >> keyword))
+				{
+					continue;
+				}
+
+				ParseLine(keyword, args);
+
+				std::string trailing;
+				if (args >> trailing)
+				{
+					Fail("unexpected '" + trailing + "' after '" + keyword + "'");
+				}
+			}
+
+			const std::filesystem::path directory = std::filesystem::path(filepath).parent_path();
+			for (auto& mesh : scene.meshes)
+			{
+				mesh.filepath = (directory / mesh.filepath).lexically_normal().string();
+			}
+
+			return std::move(scene);
+		}
+
+		void Parser::ParseLine(const std::string& keyword, std::istringstream& args)
+		{
+			if (keyword == "environment")
+			{
+				scene.environment = ReadVec3(args);
+				block = Block::None;
+			}
+			else if (keyword == "camera")
+			{
+				block = Block::Camera;
+			}
+			else if (keyword == "material")
+			{
+				const std::string name = ReadName(args);
+				if (std::find(scene.materialNames.begin(), scene.materialNames.end(), name) != scene.materialNames.end())
+				{
+					Fail("duplicate material '" + name + "'");
+				}
+
+				// Diffuse white unless told otherwise.
+				Material material{};
+				material.albedo = glm::vec4(1.f, 1.f, 1.f, 0.f);
+				material.roughness = 1.f;
+				material.ior = 1.5f;
+
+				scene.materialNames.push_back(name);
+				scene.materials.push_back(material);
+				block = Block::Material;
+			}
+			else if (keyword == "mesh")
+			{
+				MeshDescription mesh;
+				mesh.name = ReadName(args);
+				mesh.filepath = ReadName(args);
+				if (std::any_of(scene.meshes.begin(), scene.meshes.end(), [&](const MeshDescription& other) { return other.name == mesh.name; }))
+				{
+					Fail("duplicate mesh '" + mesh.name + "'");
+				}
+
+				scene.meshes.push_back(std::move(mesh));
+				block = Block::None;
+			}
+			else if (keyword == "instance")
+			{
+				std::vector<std::string> meshNames;
+				for (const auto& mesh : scene.meshes)
+				{
+					meshNames.push_back(mesh.name);
+				}
+
+				InstanceDescription instance;
+				instance.mesh = Find(meshNames, ReadName(args), "mesh");
+				instance.material = Find(scene.materialNames, ReadName(args), "material");
+
+				scene.instances.push_back(instance);
+				block = Block::Instance;
+			}
+			else
+			{
+				switch (block)
+				{
+				case Block::Camera: ParseCamera(keyword, args); break;
+				case Block::Material: ParseMaterial(keyword, args); break;
+				case Block::Instance: ParseInstance(keyword, args); break;
+				default: Fail("unknown keyword '" + keyword + "'");
+				}
+			}
+		}
+
+		void Parser::ParseCamera(const std::string& keyword, std::istringstream& args)
+		{
+			CameraDescription& camera = scene.camera;
+
+			if (keyword == "position") camera.position = ReadVec3(args);
+			else if (keyword == "forward") camera.forward = ReadVec3(args);
+			else if (keyword == "fstop") camera.fStop = ReadFloat(args);
+			else if (keyword == "focus_distance") camera.focusDist = ReadFloat(args);
+			else if (keyword == "focal_length") camera.focalLength = ReadFloat(args);
+			else if (keyword == "sensor_width") camera.sensorWidth = ReadFloat(args);
+			else Fail("unknown camera property '" + keyword + "'");
+		}
+
+		void Parser::ParseMaterial(const std::string& keyword, std::istringstream& args)
+		{
+			Material& material = scene.materials.back();
+
+			if (keyword == "albedo") material.albedo = glm::vec4(ReadVec3(args), material.albedo.w);
+			else if (keyword == "emission") material.albedo.w = ReadFloat(args);
+			else if (keyword == "roughness") material.roughness = ReadFloat(args);
+			else if (keyword == "metalness") material.metalness = ReadFloat(args);
+			else if (keyword == "transmission") material.transmission = ReadFloat(args);
+			else if (keyword == "ior") material.ior = ReadFloat(args);
+			else Fail("unknown material property '" + keyword + "'");
+		}
+
+		void Parser::ParseInstance(const std::string& keyword, std::istringstream& args)
+		{
+			glm::mat4 op(1.f);
+
+			if (keyword == "translate")
+			{
+				op = glm::translate(op, ReadVec3(args));
+			}
+			else if (keyword == "rotate")
+			{
+				const float degrees = ReadFloat(args);
+				op = glm::rotate(op, glm::radians(degrees), ReadVec3(args));
+			}
+			else if (keyword == "scale")
+			{
+				// one uniform factor or all three, anything after those fails as trailing input
+				const float x = ReadFloat(args);
+				if ((args >> std::ws).eof())
+				{
+					op = glm::scale(op, glm::vec3(x));
+				}
+				else
+				{
+					const float y = ReadFloat(args);
+					const float z = ReadFloat(args);
+					op = glm::scale(op, glm::vec3(x, y, z));
+				}
+			}
+			else
+			{
+				Fail("unknown instance property '" + keyword + "'");
+			}
+
+			glm::mat4& transform = scene.instances.back().transform;
+			transform = op * transform;
+		}
+
+		float Parser::ReadFloat(std::istringstream& args)
+		{
+			float value;
+			if (!(args >> value))
+			{
+				Fail("expected a number");
+			}
+			return value;
+		}
+
+		glm::vec3 Parser::ReadVec3(std::istringstream& args)
+		{
+			const float x = ReadFloat(args);
+			const float y = ReadFloat(args);
+			const float z = ReadFloat(args);
+			return { x, y, z };
+		}
+
+		std::string Parser::ReadName(std::istringstream& args)
+		{
+			std::string name;
+			if (!(args >> name))
+			{
+				Fail("expected a name");
+			}
+			return name;
+		}
+
+		uint32_t Parser::Find(const std::vector<std::string>& names, const std::string& name, const char* kind)
+		{
+			const auto it = std::find(names.begin(), names.end(), name);
+			if (it == names.end())
+			{
+				Fail(std::string("unknown ") + kind + " '" + name + "'");
+			}
+			return static_cast<uint32_t>(it - names.begin());
+		}
+
+		void Parser::Fail(const std::string& message) const
+		{
+			throw std::runtime_error(filepath + ":" + std::to_string(lineNumber) + ": " + message);
+		}
+	}
+
+	SceneDescription SceneDescription::Load(const std::string& filepath)
+	{
+		return Parser(filepath).Parse();
+	}
+}
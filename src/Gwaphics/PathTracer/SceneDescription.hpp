@@ -0,0 +1,53 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include "Model.hpp"
+
+namespace Vulkan
+{
+	struct CameraDescription
+	{
+		glm::vec3 position{ 0.f, 0.f, 23.f };
+		glm::vec3 forward{ 0.f, 0.f, -1.f };
+		float fStop{ 32.f };
+		float focusDist{ 1.f };
+		float focalLength{ 50.f };
+		float sensorWidth{ 36.f };
+	};
+
+	struct MeshDescription
+	{
+		std::string name;
+		std::string filepath;
+	};
+
+	struct InstanceDescription
+	{
+		uint32_t mesh;
+		uint32_t material;
+		glm::mat4 transform{ 1.f };
+	};
+
+	// Contents of a .scene file. The format is line based like OBJ/MTL, '#' starts a comment:
+	//
+	//   environment <r> <g> <b>
+	//   camera                              followed by: position, forward, fstop, focus_distance, focal_length, sensor_width
+	//   material <name>                     followed by: albedo <r> <g> <b>, emission, roughness, metalness, transmission, ior
+	//   mesh <name> <path to .obj>          relative to the scene file
+	//   instance <mesh> <material>          followed by: translate <x> <y> <z>, rotate <degrees> <x> <y> <z>, scale <s> | <x> <y> <z>
+	//
+	// Instance transforms are applied to the mesh in the order they are listed.
+	struct SceneDescription
+	{
+		static SceneDescription Load(const std::string& filepath);
+
+		glm::vec3 environment{ 0.8f };
+		CameraDescription camera;
+		std::vector<std::string> materialNames;
+		std::vector<Material> materials;
+		std::vector<MeshDescription> meshes;
+		std::vector<InstanceDescription> instances;
+	};
+}
@@ -0,0 +1,215 @@
+#include "SceneEditor.hpp"
+#include <algorithm>
+#include <chrono>
+
+namespace Vulkan
+{
+	namespace
+	{
+		template <class T>
+		void Share(std::shared_ptr<const std::vector<T>>& shared, const std::vector<T>& content, const DirtyRange& dirty)
+		{
+			if (shared == nullptr || !dirty.Empty())
+			{
+				shared = std::make_shared<const std::vector<T>>(content);
+			}
+		}
+	}
+
+	SceneEditor::SceneEditor(const std::string& filepath) :
+		scene_(filepath)
+	{
+		view_.camera = scene_.camera;
+		view_.environment = scene_.environment;
+		view_.materials = scene_.materials;
+		view_.instances = scene_.instances;
+		view_.materialNames = scene_.materialNames;
+		view_.meshNames = scene_.meshNames;
+
+		Publish();
+		UpdateFinalBVH();
+
+		thread_ = std::thread([this]() { Run(); });
+	}
+
+	SceneEditor::~SceneEditor()
+	{
+		{
+			std::lock_guard<std::mutex> lock(editMutex_);
+			quit_ = true;
+		}
+
+		editReady_.notify_one();
+		thread_.join();
+
+		delete published_.exchange(nullptr);
+		Reclaim();
+	}
+
+	SceneSnapshot* SceneEditor::Acquire()
+	{
+		return published_.exchange(nullptr, std::memory_order_acq_rel);
+	}
+
+	void SceneEditor::Acknowledge(const uint64_t version)
+	{
+		acknowledged_.store(version, std::memory_order_release);
+	}
+
+	void SceneEditor::Retire(SceneSnapshot* const snapshot)
+	{
+		snapshot->next = retired_.load(std::memory_order_relaxed);
+		while (!retired_.compare_exchange_weak(snapshot->next, snapshot, std::memory_order_release, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	void SceneEditor::UpdateMaterial(const uint32_t index)
+	{
+		{
+			std::lock_guard<std::mutex> lock(editMutex_);
+			edits_.push_back({ Edit::Type::Material, index, view_.materials[index], {} });
+		}
+
+		editReady_.notify_one();
+	}
+
+	void SceneEditor::UpdateInstance(const uint32_t index)
+	{
+		{
+			std::lock_guard<std::mutex> lock(editMutex_);
+			edits_.push_back({ Edit::Type::Instance, index, {}, view_.instances[index] });
+		}
+
+		editReady_.notify_one();
+	}
+
+	void SceneEditor::Run()
+	{
+		for (;;)
+		{
+			std::vector<Edit> edits;
+			{
+				// Wake up now and then to collect the background BVH build and free retired snapshots.
+				std::unique_lock<std::mutex> lock(editMutex_);
+				const auto timeout = pendingBVH_.valid() ? std::chrono::milliseconds(5) : std::chrono::milliseconds(100);
+				editReady_.wait_for(lock, timeout, [this]() { return quit_ || !edits_.empty(); });
+
+				if (quit_)
+				{
+					return;
+				}
+
+				edits.swap(edits_);
+			}
+
+			Apply(edits);
+			UpdateFinalBVH();
+
+			if (!scene_.dirty.Empty())
+			{
+				Publish();
+			}
+
+			Reclaim();
+		}
+	}
+
+	void SceneEditor::Apply(const std::vector<Edit>& edits)
+	{
+		// A dragged slider queues an edit per frame, all of them are applied before a single BVH rebuild.
+		std::vector<uint32_t> movedInstances;
+
+		for (const Edit& edit : edits)
+		{
+			switch (edit.type)
+			{
+			case Edit::Type::Material:
+				scene_.materials[edit.index] = edit.material;
+				scene_.UpdateMaterial(edit.index);
+				break;
+
+			case Edit::Type::Instance:
+				scene_.instances[edit.index] = edit.instance;
+				if (std::find(movedInstances.begin(), movedInstances.end(), edit.index) == movedInstances.end())
+				{
+					movedInstances.push_back(edit.index);
+				}
+				break;
+			}
+		}
+
+		if (!movedInstances.empty())
+		{
+			scene_.UpdateInstances(movedInstances);
+		}
+	}
+
+	void SceneEditor::UpdateFinalBVH()
+	{
+		if (pendingBVH_.valid())
+		{
+			if (pendingBVH_.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				return;
+			}
+
+			// Trees built from geometry that has since been edited are dropped.
+			BVH bvh = pendingBVH_.get();
+			if (pendingBVHVersion_ == scene_.geometryVersion)
+			{
+				scene_.SetBVH(std::move(bvh));
+				return;
+			}
+		}
+
+		// At most one build in flight, while an instance is being dragged around this only picks up every so often.
+		if (scene_.bvhQuality != BVHQuality::Final)
+		{
+			pendingBVH_ = scene_.BuildBVHAsync(BVHQuality::Final);
+			pendingBVHVersion_ = scene_.geometryVersion;
+		}
+	}
+
+	void SceneEditor::Publish()
+	{
+		const SceneDelta& dirty = scene_.dirty;
+		Share(shared_.vertices, scene_.vertices, dirty.vertices);
+		Share(shared_.normals, scene_.normals, dirty.vertices);
+		Share(shared_.indices, scene_.indices, DirtyRange());
+		Share(shared_.triangles, scene_.triangles, dirty.triangles);
+		Share(shared_.bvhNodes, scene_.bvhNode, dirty.nodes);
+		Share(shared_.materials, scene_.materials, dirty.materials);
+
+		// The renderer may skip versions, so each snapshot carries every change it has not acknowledged yet.
+		history_.emplace_back(++version_, dirty);
+		scene_.dirty = SceneDelta();
+
+		const uint64_t acknowledged = acknowledged_.load(std::memory_order_acquire);
+		history_.erase(std::remove_if(history_.begin(), history_.end(), [acknowledged](const auto& entry) { return entry.first <= acknowledged; }), history_.end());
+
+		auto* snapshot = new SceneSnapshot(shared_);
+		snapshot->version = version_;
+		snapshot->bvhQuality = scene_.bvhQuality;
+		snapshot->bvhBuildTime = scene_.bvhBuildTime;
+		snapshot->delta = SceneDelta();
+		for (const auto& entry : history_)
+		{
+			snapshot->delta.Merge(entry.second);
+		}
+
+		// A snapshot still sitting here was never seen by the renderer, its changes are part of the new one.
+		delete published_.exchange(snapshot, std::memory_order_acq_rel);
+	}
+
+	void SceneEditor::Reclaim()
+	{
+		SceneSnapshot* snapshot = retired_.exchange(nullptr, std::memory_order_acquire);
+		while (snapshot != nullptr)
+		{
+			SceneSnapshot* const next = snapshot->next;
+			delete snapshot;
+			snapshot = next;
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Scene.hpp"
+
+namespace Vulkan
+{
+	// Immutable version of the GPU visible scene data. Arrays that did not change are shared with the previous version.
+	struct SceneSnapshot
+	{
+		uint64_t version;
+		std::shared_ptr<const std::vector<glm::vec4>> vertices;
+		std::shared_ptr<const std::vector<glm::vec4>> normals;
+		std::shared_ptr<const std::vector<uint32_t>> indices;
+		std::shared_ptr<const std::vector<Tri>> triangles;
+		std::shared_ptr<const std::vector<BVHNode>> bvhNodes;
+		std::shared_ptr<const std::vector<Material>> materials;
+		BVHQuality bvhQuality;
+		double bvhBuildTime;
+		// everything changed since the last version the renderer acknowledged when this one was published
+		SceneDelta delta;
+
+		SceneSnapshot* next = nullptr; // link in the list of retired snapshots
+	};
+
+	// The editable side of the scene as the UI sees it, owned by the UI thread.
+	struct SceneView
+	{
+		CameraDescription camera;
+		glm::vec3 environment;
+		std::vector<Material> materials;
+		std::vector<SceneInstance> instances;
+		std::vector<std::string> materialNames;
+		std::vector<std::string> meshNames;
+	};
+
+	// Owns the scene on its own thread. The UI queues edits, the editor applies them and publishes a new snapshot,
+	// and the renderer picks the newest one up at a frame boundary. The render side (Acquire, Acknowledge, Retire)
+	// never blocks: snapshots travel through an atomic pointer and go back through a lock-free list to be freed here.
+	class SceneEditor final
+	{
+	public:
+
+		SceneEditor(const SceneEditor&) = delete;
+		SceneEditor(SceneEditor&&) = delete;
+		SceneEditor& operator = (const SceneEditor&) = delete;
+		SceneEditor& operator = (SceneEditor&&) = delete;
+
+		// Loads the scene on the calling thread, the first snapshot is ready to acquire on return.
+		explicit SceneEditor(const std::string& filepath);
+		~SceneEditor();
+
+		// Render thread. Acquire hands over the newest snapshot (or nullptr if there is none since the last call),
+		// it belongs to the caller until it is passed to Retire.
+		SceneSnapshot* Acquire();
+		void Acknowledge(uint64_t version);
+		void Retire(SceneSnapshot* snapshot);
+
+		// UI thread. Change the view, then tell the editor what changed.
+		SceneView& View() { return view_; }
+		void UpdateMaterial(uint32_t index);
+		void UpdateInstance(uint32_t index);
+
+	private:
+
+		struct Edit
+		{
+			enum class Type { Material, Instance } type;
+			uint32_t index;
+			Material material;
+			SceneInstance instance;
+		};
+
+		void Run();
+		void Apply(const std::vector<Edit>& edits);
+		void UpdateFinalBVH();
+		void Publish();
+		void Reclaim();
+
+		SceneView view_;
+
+		// editor thread only
+		class Scene scene_;
+		SceneSnapshot shared_{}; // the arrays of the last published version
+		std::vector<std::pair<uint64_t, SceneDelta>> history_;
+		uint64_t version_{};
+		std::future<BVH> pendingBVH_;
+		uint64_t pendingBVHVersion_{};
+
+		std::mutex editMutex_;
+		std::condition_variable editReady_;
+		std::vector<Edit> edits_;
+		bool quit_{};
+
+		std::atomic<SceneSnapshot*> published_{};
+		std::atomic<SceneSnapshot*> retired_{};
+		std::atomic<uint64_t> acknowledged_{};
+
+		std::thread thread_;
+	};
+}
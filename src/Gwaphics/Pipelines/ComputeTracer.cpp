@@ -1,4 +1,7 @@
 #include "ComputeTracer.hpp"
+#include "SceneAccelerationStructure.hpp"
+#include "TracerDeviceFeatures.hpp"
+#include "VisibilityPass.hpp"
 
 
 #include "../Vulkan/ShaderModule.hpp"
@@ -6,63 +9,363 @@
 #include "../Vulkan/Image.hpp"
 #include "../Vulkan/ImageView.hpp"
 #include "../Vulkan/Sampler.hpp"
-#include "../Vulkan/BufferUtil.hpp"
+#include "../Vulkan/Enumerate.hpp"
+#include "../Vulkan/SingleTimeCommands.hpp"
+#include "../Vulkan/TimelineSemaphore.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <iterator>
 #include <memory>
+#include <stdexcept>
+#include <tuple>
 #include "vulkan/vulkan.hpp"
 
 namespace Vulkan
 {
-	ComputeTracer::ComputeTracer(const Vulkan::Device& device, Vulkan::CommandPool& commandPool, VkDescriptorImageInfo& imageInfo, uint32_t imgWidth, uint32_t imgHeight)
+	namespace
+	{
+		// Stages each dirty span of the content. The data is copied into the staging arena, so the host copy can
+		// change right after.
+		template <class T>
+		void StageUpdate(UploadBatcher& uploads, const Buffer& buffer, const std::vector<T>& content, const DirtyRange& range)
+		{
+			for (const DirtyRange::Span& span : range.spans)
+			{
+				const size_t end = std::min(span.end, content.size());
+				if (span.begin < end)
+				{
+					uploads.Upload(buffer, span.begin * sizeof(T), content.data() + span.begin, (end - span.begin) * sizeof(T));
+				}
+			}
+		}
+
+		// Layouts shared with Wavefront.glsl.
+		const uint32_t WavefrontGroupSize = 64;
+
+		struct PathState
+		{
+			glm::vec3 origin;
+			uint32_t pixel;
+			glm::vec3 direction;
+			uint32_t seed;
+			glm::vec3 throughput;
+			uint32_t bounce;
+		};
+
+		struct HitRecord
+		{
+			float tHit;
+			uint32_t objIdx;
+			glm::vec2 barycentric;
+		};
+
+		struct QueueCounters
+		{
+			VkDispatchIndirectCommand dispatchSize;
+			uint32_t queueCount[2];
+		};
+
+		// HitSortBuffer holds a count and an offset per bin, then a slot per path.
+		const uint32_t HitSortBins = 1024;
+
+		// Enough persistent lanes to fill a large GPU, the work counter balances them.
+		const uint32_t PersistentGroupSize = 64;
+		const uint32_t PersistentGroupCount = 2048;
+
+		// The 64 bit totals are a low and a high word each in the shaders.
+		struct TraceCounters
+		{
+			uint64_t busyLaneSteps;
+			uint64_t laneSteps;
+			uint64_t rayCount;
+			uint32_t workCounter;
+		};
+
+		// Edge of the square tiles traced in tiled mode, the last row and column are clipped to the image.
+		const uint32_t TileSize = 256;
+
+		// Makes the writes of the previous command visible to the next kernel, the dispatch size it wrote,
+		// or a buffer update that overwrites what it wrote.
+		void ComputeBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess)
+		{
+			VkMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = srcAccess;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+			const VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+			vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		}
+
+		template <class T>
+		void CreateStorageBuffer(const Device& device, const char* const name, const size_t count, const VkBufferUsageFlags usage, std::unique_ptr<Buffer>& buffer, std::unique_ptr<DeviceMemory>& memory)
+		{
+			buffer.reset(new Buffer(device, sizeof(T) * count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | usage));
+			memory.reset(new DeviceMemory(buffer->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
+
+			device.DebugUtils().SetObjectName(buffer->Handle(), (name + std::string(" Buffer")).c_str());
+			device.DebugUtils().SetObjectName(memory->Handle(), (name + std::string(" Memory")).c_str());
+		}
+
+		// Specialization constants of Structs.glsl, in constant_id order.
+		struct SpecializationData
+		{
+			uint32_t groupWidth;
+			uint32_t groupHeight;
+			uint32_t maxBounces;
+			uint32_t rouletteStart;
+			VkBool32 diffuseOnly;
+			float minAlpha;
+			float sampleClamp;
+			VkBool32 mortonOrder;
+			VkBool32 sortHits;
+			VkBool32 visibilityBuffer;
+		};
+
+		auto VariantKey(const TracerVariant& variant)
+		{
+			return std::tie(variant.maxBounces, variant.rouletteStart, variant.groupWidth, variant.groupHeight, variant.diffuseOnly, variant.minAlpha, variant.sampleClamp, variant.mortonOrder, variant.sortHits, variant.rayQuery, variant.visibilityBuffer, variant.subgroupTraversal, variant.halfShading);
+		}
+
+		// Pixels traced by one megakernel workgroup.
+		VkExtent2D WorkgroupPixels(const TracerVariant& variant)
+		{
+			if (!variant.mortonOrder)
+			{
+				return { variant.groupWidth, variant.groupHeight };
+			}
+
+			uint32_t blockSize = 1;
+			while (blockSize * blockSize < variant.groupWidth)
+			{
+				blockSize *= 2;
+			}
+			return { blockSize, blockSize };
+		}
+
+		void DispatchMegakernel(VkCommandBuffer commandBuffer, VkPipeline pipeline, const TracerVariant& variant, const VkExtent2D& extent)
+		{
+			const VkExtent2D groupPixels = WorkgroupPixels(variant);
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+			vkCmdDispatch(commandBuffer, (extent.width + groupPixels.width - 1) / groupPixels.width, (extent.height + groupPixels.height - 1) / groupPixels.height, 1);
+		}
+
+		bool SubgroupTraversalSupported(const Device& device)
+		{
+			VkPhysicalDeviceSubgroupProperties subgroupProperties = {};
+			subgroupProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+			VkPhysicalDeviceProperties2 properties = {};
+			properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			properties.pNext = &subgroupProperties;
+			vkGetPhysicalDeviceProperties2(device.PhysicalDevice(), &properties);
+
+			const VkSubgroupFeatureFlags operations = VK_SUBGROUP_FEATURE_BALLOT_BIT | VK_SUBGROUP_FEATURE_VOTE_BIT;
+			return (subgroupProperties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) != 0 &&
+				(subgroupProperties.supportedOperations & operations) == operations;
+		}
+
+		// SHARED_STACK_SIZE in SceneTraversal.glsl, node indices per lane
+		const uint32_t SharedStackSize = 12;
+
+		bool PowerOf4(const uint32_t value)
+		{
+			return value != 0 && (value & (value - 1)) == 0 && (value & 0x55555555u) != 0;
+		}
+
+		void CheckVariant(const Device& device, const TracerVariant& variant)
+		{
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(device.PhysicalDevice(), &properties);
+			if (variant.maxBounces == 0 || variant.groupWidth * variant.groupHeight > properties.limits.maxComputeWorkGroupInvocations ||
+				(variant.mortonOrder && (variant.groupHeight != 1 || !PowerOf4(variant.groupWidth))) ||
+				(variant.rayQuery && !device.IsEnabled(VK_KHR_RAY_QUERY_EXTENSION_NAME)) ||
+				(variant.visibilityBuffer && !VisibilityPass::Supported(device)) ||
+				(variant.subgroupTraversal && (variant.rayQuery || !SubgroupTraversalSupported(device) ||
+					variant.groupWidth * variant.groupHeight * SharedStackSize * sizeof(uint32_t) > properties.limits.maxComputeSharedMemorySize)) ||
+				(variant.halfShading && !TracerDeviceFeatures::SupportsFloat16(device.PhysicalDevice())))
+			{
+				throw std::runtime_error("invalid tracer variant");
+			}
+		}
+
+		Camera CameraFrom(const CameraDescription& camera, uint32_t imgWidth, uint32_t imgHeight, const Device& device)
+		{
+			return Camera(camera.fStop, camera.focusDist, camera.focalLength, camera.sensorWidth, camera.position, camera.forward, imgWidth, imgHeight, device);
+		}
+	}
+
+	bool TracerVariant::operator==(const TracerVariant& other) const
+	{
+		return VariantKey(*this) == VariantKey(other);
+	}
+
+	bool TracerVariant::operator<(const TracerVariant& other) const
+	{
+		return VariantKey(*this) < VariantKey(other);
+	}
+
+	TracerVariant PresetVariant(const TracerPreset preset)
+	{
+		TracerVariant variant;
+		switch (preset)
+		{
+		case TracerPreset::Reference:
+			break;
+
+		case TracerPreset::Preview:
+			variant.maxBounces = 4;
+			variant.rouletteStart = 2;
+			break;
+
+		case TracerPreset::DiffuseOnly:
+			variant.diffuseOnly = true;
+			variant.maxBounces = 8;
+			break;
+		}
+
+		return variant;
+	}
+
+	ComputeTracer::ComputeTracer(const Vulkan::Device& device, Vulkan::CommandPool& commandPool, const Vulkan::PipelineCache& pipelineCache, VkDescriptorImageInfo& imageInfo, uint32_t imgWidth, uint32_t imgHeight, const std::string& scenePath)
 	:device_(device), 
 	commandPool_(commandPool),
-	camera_(imgWidth, imgHeight, device)
+	pipelineCache_(pipelineCache),
+	sceneEditor_(scenePath),
+	camera_(CameraFrom(sceneEditor_.View().camera, imgWidth, imgHeight, device))
 	{
+		camera_.setEnvironment(sceneEditor_.View().environment);
 		//const auto& device = swapChain.Device();
 
+		snapshot_ = sceneEditor_.Acquire();
+		sceneEditor_.Acknowledge(snapshot_->version);
+		const SceneSnapshot& scene = *snapshot_;
+
 		createAccumulatorImage(imgWidth, imgHeight);
-		BufferUtil::CreateDeviceBuffer(commandPool, "Vertices", VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, scene.vertices, vertexBuffer_, vertexBufferMemory_);
+		uploads_.reset(new UploadBatcher(commandPool));
+
+		// Edits are uploaded into the existing buffers. The node buffer is sized for the largest tree the
+		// triangles can produce, so rebuilt trees fit as well.
+		std::vector<BVHNode> bvhNodes = *scene.bvhNodes;
+		bvhNodes.resize(std::max<size_t>(2 * scene.triangles->size(), bvhNodes.size()));
+
+		// With ray queries the acceleration structure is built straight from the vertex buffer.
+		const bool rayQuery = device.IsEnabled(VK_KHR_RAY_QUERY_EXTENSION_NAME);
+		const VkBufferUsageFlags geometryUsage = rayQuery
+			? VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+			: 0;
+
+		uploads_->CreateDeviceBuffer("Vertices", VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | geometryUsage, *scene.vertices, vertexBuffer_, vertexBufferMemory_);
 		VkDescriptorBufferInfo vertexBufferInfo = {};
 		vertexBufferInfo.buffer = vertexBuffer_->Handle();
 		vertexBufferInfo.range = VK_WHOLE_SIZE;
 
-		BufferUtil::CreateDeviceBuffer(commandPool, "Normals", VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, scene.normals, normalBuffer_, normalBufferMemory_);
+		uploads_->CreateDeviceBuffer("Normals", VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, *scene.normals, normalBuffer_, normalBufferMemory_);
 		VkDescriptorBufferInfo normalBufferInfo = {};
 		normalBufferInfo.buffer = normalBuffer_->Handle();
 		normalBufferInfo.range = VK_WHOLE_SIZE;
 
-		BufferUtil::CreateDeviceBuffer(commandPool, "Indices", VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, scene.indices, indexBuffer_, indexBufferMemory_);
+		uploads_->CreateDeviceBuffer("Indices", VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, *scene.indices, indexBuffer_, indexBufferMemory_);
 		VkDescriptorBufferInfo indexBufferInfo = {};
 		indexBufferInfo.buffer = indexBuffer_->Handle();
 		indexBufferInfo.range = VK_WHOLE_SIZE;
 
-		BufferUtil::CreateDeviceBuffer(commandPool, "Triangles", VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, scene.triangles, triangleBuffer_, triangleBufferMemory_);
+		uploads_->CreateDeviceBuffer("Triangles", VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, *scene.triangles, triangleBuffer_, triangleBufferMemory_);
 		VkDescriptorBufferInfo triangleBufferInfo = {};
 		triangleBufferInfo.buffer = triangleBuffer_->Handle();
 		triangleBufferInfo.range = VK_WHOLE_SIZE;
 
-		BufferUtil::CreateDeviceBuffer(commandPool, "BVHNode", VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, scene.bvhNode, bvhNodeBuffer_, bvhNodeBufferMemory_);
+		uploads_->CreateDeviceBuffer("BVHNode", VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, bvhNodes, bvhNodeBuffer_, bvhNodeBufferMemory_);
 		VkDescriptorBufferInfo bvhNodeBufferInfo = {};
 		bvhNodeBufferInfo.buffer = bvhNodeBuffer_->Handle();
 		bvhNodeBufferInfo.range = VK_WHOLE_SIZE;
 
-		BufferUtil::CreateDeviceBuffer(commandPool, "Materials", VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, scene.materials, materialBuffer_, materialBufferMemory_);
+		uploads_->CreateDeviceBuffer("Materials", VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, *scene.materials, materialBuffer_, materialBufferMemory_);
 		VkDescriptorBufferInfo materialBufferInfo = {};
 		materialBufferInfo.buffer = materialBuffer_->Handle();
 		materialBufferInfo.range = VK_WHOLE_SIZE;
 
-		const std::vector<DescriptorBinding> descriptorBindings =
+		// The acceleration structure's inputs join the batch, the first trace builds it.
+		if (rayQuery)
+		{
+			sceneStructure_.reset(new SceneAccelerationStructure(device, *uploads_, *vertexBuffer_, scene));
+		}
+
+		// One copy per buffer out of a single staging arena. A dedicated transfer queue does them in the background
+		// while the pipelines are created and the first trace waits for them on the GPU, otherwise there is one wait
+		// for all of them.
+		if (AsyncUploader::Supported(device))
+		{
+			asyncUploads_.reset(new AsyncUploader(device));
+			sceneUpload_ = asyncUploads_->Submit(*uploads_);
+			stagingUpload_ = sceneUpload_;
+		}
+		else
+		{
+			const auto uploadStart = std::chrono::steady_clock::now();
+			uploads_->Submit();
+			const std::chrono::duration<double, std::milli> uploadTime = std::chrono::steady_clock::now() - uploadStart;
+			std::cout << "Scene buffers uploaded in " << uploadTime.count() << " ms" << std::endl;
+		}
+
+		if (VisibilityPass::Supported(device))
+		{
+			visibilityPass_.reset(new VisibilityPass(commandPool, pipelineCache, camera_.getCameraUBOInfo(), *vertexBuffer_, *indexBuffer_, *triangleBuffer_, sizeof(TraceConstants), imgWidth, imgHeight));
+		}
+
+		std::vector<DescriptorBinding> descriptorBindings =
 		{
 			{0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
 			{1, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
-			{2, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+			{2, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT},
 			{3, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
 			{4, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
 			{5, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
 			{6, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
 			{7, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
 			{8, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+			// wavefront queues, left unbound until that mode is first used
+			{9, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+			{10, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+			{11, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+			{12, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+			{13, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+			// wavefront hit sort, bound along with the queues
+			{14, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT},
+			// left unbound when the queue cannot rasterize
+			{16, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT},
 		};
+		if (sceneStructure_)
+		{
+			descriptorBindings.push_back({15, 1, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, VK_SHADER_STAGE_COMPUTE_BIT});
+			descriptorBindings.push_back({17, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT});
+		}
+
+		// Every subgroup adds to the counters, they stay in device memory and are copied out after each trace.
+		traceCounterBuffer_.reset(new Buffer(device, sizeof(TraceCounters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT));
+		traceCounterBufferMemory_.reset(new DeviceMemory(traceCounterBuffer_->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
+		traceReadbackBuffer_.reset(new Buffer(device, sizeof(TraceCounters), VK_BUFFER_USAGE_TRANSFER_DST_BIT));
+		traceReadbackBufferMemory_.reset(new DeviceMemory(traceReadbackBuffer_->AllocateMemory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)));
+		traceCounters_ = traceReadbackBufferMemory_->Map(0, sizeof(TraceCounters));
+		std::memset(traceCounters_, 0, sizeof(TraceCounters));
+
+		// Start and end of each frame's trace, only if the compute queue can write timestamps.
+		const auto queueFamilies = GetEnumerateVector(device.PhysicalDevice(), vkGetPhysicalDeviceQueueFamilyProperties);
+		if (queueFamilies[device.ComputeFamilyIndex()].timestampValidBits != 0)
+		{
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(device.PhysicalDevice(), &properties);
+			timestampPeriod_ = properties.limits.timestampPeriod;
+			timestampQueries_.reset(new QueryPool(device, VK_QUERY_TYPE_TIMESTAMP, 2));
+		}
+		VkDescriptorBufferInfo traceCounterBufferInfo = {};
+		traceCounterBufferInfo.buffer = traceCounterBuffer_->Handle();
+		traceCounterBufferInfo.range = VK_WHOLE_SIZE;
 
 		descriptorSetManager_.reset(new DescriptorSetManager(device, descriptorBindings,1));
 		auto& descriptorSets = descriptorSetManager_->DescriptorSets();
@@ -76,36 +379,168 @@ namespace Vulkan
 		descriptorWrites.push_back(descriptorSets.Bind(0, 6, bvhNodeBufferInfo));
 		descriptorWrites.push_back(descriptorSets.Bind(0, 7, normalBufferInfo));
 		descriptorWrites.push_back(descriptorSets.Bind(0, 8, materialBufferInfo));
+		descriptorWrites.push_back(descriptorSets.Bind(0, 13, traceCounterBufferInfo));
+		if (visibilityPass_)
+		{
+			descriptorWrites.push_back(descriptorSets.Bind(0, 16, visibilityPass_->ImageInfo()));
+		}
+
+		const VkAccelerationStructureKHR topLevel = sceneStructure_ ? sceneStructure_->TopLevel() : nullptr;
+		VkWriteDescriptorSetAccelerationStructureKHR structureInfo = {};
+		structureInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR;
+		structureInfo.accelerationStructureCount = 1;
+		structureInfo.pAccelerationStructures = &topLevel;
+		VkDescriptorBufferInfo triangleMapBufferInfo = {};
+		triangleMapBufferInfo.buffer = sceneStructure_ ? sceneStructure_->TriangleMap().Handle() : nullptr;
+		triangleMapBufferInfo.range = VK_WHOLE_SIZE;
+		if (sceneStructure_)
+		{
+			descriptorWrites.push_back(descriptorSets.Bind(0, 15, structureInfo));
+			descriptorWrites.push_back(descriptorSets.Bind(0, 17, triangleMapBufferInfo));
+		}
 
 		descriptorSets.UpdateDescriptors(0, descriptorWrites);
 
 		std::vector<VkDescriptorSetLayout> pipelineLayouts;
 		pipelineLayouts.push_back(descriptorSetManager_->DescriptorSetLayout().Handle());
 
-		pipelineLayout_.reset(new class PipelineLayout(device, pipelineLayouts));
+		VkPushConstantRange pushConstantRange = {};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(TraceConstants);
 
-		const ShaderModule computeShader(device, "assets/shaders/tracer.comp.spv");
+		pipelineLayout_.reset(new class PipelineLayout(device, pipelineLayouts, { pushConstantRange }));
 
-		VkPipelineShaderStageCreateInfo shaderStage = computeShader.CreateShaderStage(VK_SHADER_STAGE_COMPUTE_BIT);
-
-		VkComputePipelineCreateInfo computeCreateInfo = {};
-		computeCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-		computeCreateInfo.layout = pipelineLayout_->Handle();
-		computeCreateInfo.stage = shaderStage;
-
-		vkCreateComputePipelines(device.Handle(), nullptr, 1, &computeCreateInfo, nullptr, &pipeline_);
+		// Most of the startup time without a warm pipeline cache, the megakernels are big.
+		const auto pipelineStart = std::chrono::steady_clock::now();
+		pipelines_ = &variantPipelines(variant_);
+		generatePipeline_ = createPipeline("assets/shaders/wavefront_generate.comp.spv");
+		extendPipeline_ = createPipeline("assets/shaders/wavefront_extend.comp.spv");
+		advancePipeline_ = createPipeline("assets/shaders/wavefront_advance.comp.spv");
+		sortCountPipeline_ = createPipeline("assets/shaders/wavefront_sort_count.comp.spv");
+		sortScanPipeline_ = createPipeline("assets/shaders/wavefront_sort_scan.comp.spv");
+		sortScatterPipeline_ = createPipeline("assets/shaders/wavefront_sort_scatter.comp.spv");
+		accumulatePipeline_ = createPipeline("assets/shaders/wavefront_accumulate.comp.spv");
+		const std::chrono::duration<double, std::milli> pipelineTime = std::chrono::steady_clock::now() - pipelineStart;
+		std::cout << "Compute pipelines created in " << pipelineTime.count() << " ms (" << (pipelineCache.Warm() ? "warm" : "cold") << " pipeline cache)" << std::endl;
 	}
 
 	ComputeTracer::~ComputeTracer()
 	{
-		if (pipeline_ != nullptr)
+		// Hand every snapshot back before the editor goes away, it frees them.
+		for (const auto& retired : retiredSnapshots_)
+		{
+			sceneEditor_.Retire(retired.first);
+		}
+		sceneEditor_.Retire(snapshot_);
+
+		traceReadbackBufferMemory_->Unmap();
+
+		// Compiles still running use the pipeline layout, their pipelines are destroyed with the rest.
+		for (auto& compiling : compiling_)
+		{
+			try
+			{
+				variants_.emplace(compiling.first, compiling.second.get());
+			}
+			catch (const std::exception& exception)
+			{
+				std::cerr << "failed to compile a tracer variant: " << exception.what() << std::endl;
+			}
+		}
+		compiling_.clear();
+		pendingVariant_.reset();
+
+		for (auto& variant : variants_)
+		{
+			for (VkPipeline pipeline : { variant.second.megakernel, variant.second.persistent, variant.second.shade })
+			{
+				vkDestroyPipeline(device_.Handle(), pipeline, nullptr);
+			}
+		}
+		variants_.clear();
+		pipelines_ = nullptr;
+
+		for (VkPipeline* pipeline : { &generatePipeline_, &extendPipeline_, &advancePipeline_, &sortCountPipeline_, &sortScanPipeline_, &sortScatterPipeline_, &accumulatePipeline_ })
 		{
-			vkDestroyPipeline(device_.Handle(), pipeline_, nullptr);
-			pipeline_ = nullptr;
+			if (*pipeline != nullptr)
+			{
+				vkDestroyPipeline(device_.Handle(), *pipeline, nullptr);
+				*pipeline = nullptr;
+			}
 		}
 
 		pipelineLayout_.reset();
 		descriptorSetManager_.reset();
+		visibilityPass_.reset();
+		sceneStructure_.reset();
+		asyncUploads_.reset();
+		uploads_.reset();
+	}
+
+	bool ComputeTracer::VisibilitySupported() const
+	{
+		return visibilityPass_ != nullptr;
+	}
+
+	bool ComputeTracer::SubgroupTraversalSupported() const
+	{
+		return Vulkan::SubgroupTraversalSupported(device_);
+	}
+
+	bool ComputeTracer::HalfShadingSupported() const
+	{
+		return TracerDeviceFeatures::SupportsFloat16(device_.PhysicalDevice());
+	}
+
+	std::pair<VkSemaphore, uint64_t> ComputeTracer::UploadWait() const
+	{
+		return uploadWait_ != 0
+			? std::make_pair(asyncUploads_->Semaphore().Handle(), uploadWait_)
+			: std::make_pair(VkSemaphore(nullptr), uint64_t(0));
+	}
+
+	void ComputeTracer::waitForStaging()
+	{
+		if (stagingUpload_ == 0 || asyncUploads_->Done(stagingUpload_))
+		{
+			stagingUpload_ = 0;
+			return;
+		}
+
+		// Usually long done by the first edit, the scene upload copies out of the staging arena until then.
+		const auto waitStart = std::chrono::steady_clock::now();
+		asyncUploads_->Wait(stagingUpload_);
+		const std::chrono::duration<double, std::milli> waitTime = std::chrono::steady_clock::now() - waitStart;
+		std::cout << "Scene buffers uploaded on the transfer queue, waited " << waitTime.count() << " ms for them" << std::endl;
+		stagingUpload_ = 0;
+	}
+
+	void ComputeTracer::acquireSceneBuffers(VkCommandBuffer commandBuffer)
+	{
+		uploadWait_ = 0;
+		if (sceneUpload_ != 0)
+		{
+			asyncUploads_->RecordAcquire(commandBuffer, sceneUpload_);
+			uploadWait_ = sceneUpload_;
+			sceneUpload_ = 0;
+		}
+
+		if (sceneStructure_ && !sceneStructureBuilt_)
+		{
+			sceneStructure_->RecordBuild(commandBuffer);
+			sceneStructureBuilt_ = true;
+		}
+	}
+
+	void ComputeTracer::setCamera(const CameraDescription& camera)
+	{
+		Camera::Settings lens;
+		lens.f_stop = camera.fStop;
+		lens.focus_dist = camera.focusDist;
+		lens.focal_length = camera.focalLength;
+		lens.sensor_width = camera.sensorWidth;
+		camera_.setView(camera.position, camera.forward, lens);
 	}
 
 	void ComputeTracer::resizeComputeTarget(uint32_t imgWidth, uint32_t imgHeight, VkDescriptorImageInfo& imageDescriptor)
@@ -119,10 +554,567 @@ namespace Vulkan
 		std::vector<VkWriteDescriptorSet> descriptorWrites;
 		descriptorWrites.push_back(descriptorSets.Bind(0, 0, imageDescriptor));
 		descriptorWrites.push_back(descriptorSets.Bind(0, 1, accumulatorImageDescriptorInfo_));
+		if (visibilityPass_)
+		{
+			visibilityPass_->Resize(imgWidth, imgHeight);
+			descriptorWrites.push_back(descriptorSets.Bind(0, 16, visibilityPass_->ImageInfo()));
+		}
 
 		descriptorSets.UpdateDescriptors(0, descriptorWrites);
 	}
 
+	// TraceConstants in Structs.glsl
+	struct ComputeTracer::TraceConstants
+	{
+		uint32_t samplesPerDispatch;
+		uint32_t currentSample;
+		uint32_t pathCapacity;
+		uint32_t currentQueue;
+		uint32_t tileOffset[2];
+		uint32_t tileExtent[2];
+		uint32_t clearAccumulation;
+	};
+
+	void ComputeTracer::setSamplesPerDispatch(uint32_t samples)
+	{
+		// Sample indices carry on from the last dispatch whatever its count, so accumulation, and a benchmark
+		// recording, keeps going with the new dispatch size.
+		samplesPerDispatch_ = std::max(samples, 1u);
+	}
+
+	void ComputeTracer::setTiling(const bool tiled, const float frameBudget)
+	{
+		frameBudget_ = frameBudget;
+		if (tiled != tiled_)
+		{
+			// Tiles not revisited since the last reset would keep stale samples, start over.
+			tiled_ = tiled;
+			tileTime_ = 0.0;
+			camera_.resetAccumulation();
+		}
+	}
+
+	void ComputeTracer::setVariant(const TracerVariant& variant, const bool background)
+	{
+		if (variant == variant_)
+		{
+			pendingVariant_.reset();
+			return;
+		}
+		if (pendingVariant_ && *pendingVariant_ == variant)
+		{
+			return;
+		}
+
+		CheckVariant(device_, variant);
+		if (background && variants_.find(variant) == variants_.end())
+		{
+			if (compiling_.find(variant) == compiling_.end())
+			{
+				compiling_.emplace(variant, std::async(std::launch::async, [this, variant]() { return compileVariant(variant); }));
+			}
+			pendingVariant_ = variant;
+			return;
+		}
+
+		pendingVariant_.reset();
+		useVariant(variant);
+	}
+
+	void ComputeTracer::useVariant(const TracerVariant& variant)
+	{
+		pipelines_ = &variantPipelines(variant);
+
+		// Sorting the hits only reorders the shading of the same samples, what has been accumulated stays valid.
+		TracerVariant sorted = variant_;
+		sorted.sortHits = variant.sortHits;
+		if (!(sorted == variant))
+		{
+			camera_.resetAccumulation();
+		}
+		variant_ = variant;
+	}
+
+	double ComputeTracer::benchmarkVariant(const TracerVariant& variant, const uint32_t imgWidth, const uint32_t imgHeight)
+	{
+		if (!timestampQueries_)
+		{
+			return 0.0;
+		}
+
+		CheckVariant(device_, variant);
+		const VkPipeline pipeline = variantPipelines(variant).megakernel;
+		const VkExtent2D extent = { imgWidth, imgHeight };
+
+		// An untimed dispatch first warms up caches and clocks. Every dispatch overwrites the image.
+		const uint32_t runs = 4;
+		QueryPool queries(device_, VK_QUERY_TYPE_TIMESTAMP, 2 * runs);
+
+		TraceConstants constants = {};
+		constants.samplesPerDispatch = samplesPerDispatch_;
+		constants.tileExtent[0] = imgWidth;
+		constants.tileExtent[1] = imgHeight;
+		constants.clearAccumulation = 1;
+
+		// Submitted without waiting for semaphores, an upload still running is waited for here.
+		waitForStaging();
+		SingleTimeCommands::Submit(commandPool_, [&](VkCommandBuffer commandBuffer)
+		{
+			acquireSceneBuffers(commandBuffer);
+			queries.Reset(commandBuffer);
+			if (variant.visibilityBuffer)
+			{
+				visibilityPass_->Record(commandBuffer, static_cast<uint32_t>(snapshot_->triangles->size()), &constants, camera_.Offset());
+			}
+
+			VkDescriptorSet descriptorSets[] = { ComputeTextureDescriptorSet() };
+			const uint32_t cameraOffset = camera_.Offset();
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout_->Handle(), 0, 1, descriptorSets, 1, &cameraOffset);
+			vkCmdPushConstants(commandBuffer, pipelineLayout_->Handle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+			DispatchMegakernel(commandBuffer, pipeline, variant, extent);
+
+			// Written once the previous commands are past the compute stage, a run is timed from the end of the last.
+			for (uint32_t run = 0; run != runs; ++run)
+			{
+				ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+				vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, queries.Handle(), 2 * run);
+				DispatchMegakernel(commandBuffer, pipeline, variant, extent);
+				vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, queries.Handle(), 2 * run + 1);
+			}
+		});
+
+		camera_.resetAccumulation();
+
+		std::vector<uint64_t> timestamps;
+		if (!queries.GetResults(0, 2 * runs, timestamps))
+		{
+			return 0.0;
+		}
+
+		uint64_t fastest = UINT64_MAX;
+		for (uint32_t run = 0; run != runs; ++run)
+		{
+			fastest = std::min(fastest, timestamps[2 * run + 1] - timestamps[2 * run]);
+		}
+
+		return static_cast<double>(fastest) * timestampPeriod_ * 1e-6;
+	}
+
+	const ComputeTracer::VariantPipelines& ComputeTracer::variantPipelines(const TracerVariant& variant)
+	{
+		const auto cached = variants_.find(variant);
+		if (cached != variants_.end())
+		{
+			return cached->second;
+		}
+
+		const auto compiling = compiling_.find(variant);
+		if (compiling == compiling_.end())
+		{
+			return variants_.emplace(variant, compileVariant(variant)).first->second;
+		}
+
+		std::future<VariantPipelines> pipelines = std::move(compiling->second);
+		compiling_.erase(compiling);
+		return variants_.emplace(variant, pipelines.get()).first->second;
+	}
+
+	ComputeTracer::VariantPipelines ComputeTracer::compileVariant(const TracerVariant& variant) const
+	{
+		const SpecializationData data = { variant.groupWidth, variant.groupHeight, variant.maxBounces, variant.rouletteStart, variant.diffuseOnly ? VK_TRUE : VK_FALSE, variant.minAlpha, variant.sampleClamp, variant.mortonOrder ? VK_TRUE : VK_FALSE, variant.sortHits ? VK_TRUE : VK_FALSE, variant.visibilityBuffer ? VK_TRUE : VK_FALSE };
+		const VkSpecializationMapEntry entries[] =
+		{
+			{0, offsetof(SpecializationData, groupWidth), sizeof(uint32_t)},
+			{1, offsetof(SpecializationData, groupHeight), sizeof(uint32_t)},
+			{2, offsetof(SpecializationData, maxBounces), sizeof(uint32_t)},
+			{3, offsetof(SpecializationData, rouletteStart), sizeof(uint32_t)},
+			{4, offsetof(SpecializationData, diffuseOnly), sizeof(VkBool32)},
+			{5, offsetof(SpecializationData, minAlpha), sizeof(float)},
+			{6, offsetof(SpecializationData, sampleClamp), sizeof(float)},
+			{7, offsetof(SpecializationData, mortonOrder), sizeof(VkBool32)},
+			{8, offsetof(SpecializationData, sortHits), sizeof(VkBool32)},
+			{9, offsetof(SpecializationData, visibilityBuffer), sizeof(VkBool32)},
+		};
+
+		VkSpecializationInfo specialization = {};
+		specialization.mapEntryCount = static_cast<uint32_t>(std::size(entries));
+		specialization.pMapEntries = entries;
+		specialization.dataSize = sizeof(data);
+		specialization.pData = &data;
+
+		VariantPipelines pipelines;
+		// The traversals and half shading are separate entry points, the base kernels need no optional capabilities.
+		const std::string megakernel = std::string("assets/shaders/tracer") + (variant.rayQuery ? "_rayquery" : "") + (variant.subgroupTraversal ? "_subgroup" : "") + (variant.halfShading ? "_fp16" : "") + ".comp.spv";
+		pipelines.megakernel = createPipeline(megakernel, &specialization);
+		pipelines.persistent = createPipeline("assets/shaders/tracer_persistent.comp.spv", &specialization);
+		pipelines.shade = createPipeline("assets/shaders/wavefront_shade.comp.spv", &specialization);
+		return pipelines;
+	}
+
+	void ComputeTracer::collectVariants()
+	{
+		for (auto compiling = compiling_.begin(); compiling != compiling_.end();)
+		{
+			if (compiling->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				++compiling;
+				continue;
+			}
+
+			const TracerVariant variant = compiling->first;
+			std::future<VariantPipelines> pipelines = std::move(compiling->second);
+			compiling = compiling_.erase(compiling);
+			variants_.emplace(variant, pipelines.get());
+		}
+
+		if (pendingVariant_ && variants_.find(*pendingVariant_) != variants_.end())
+		{
+			const TracerVariant variant = *pendingVariant_;
+			pendingVariant_.reset();
+			useVariant(variant);
+		}
+	}
+
+	void ComputeTracer::recordTrace(VkCommandBuffer commandBuffer, uint32_t imgWidth, uint32_t imgHeight)
+	{
+		readStatistics();
+		// Ahead of the accumulation reset below, a variant switched to now restarts it.
+		collectVariants();
+
+		// Untiled, the whole image is a single tile.
+		const uint32_t tileSize = tiled_ ? TileSize : std::max(imgWidth, imgHeight);
+		const uint32_t tilesX = (imgWidth + tileSize - 1) / tileSize;
+		const uint32_t tilesY = (imgHeight + tileSize - 1) / tileSize;
+		const uint32_t tileCount = tilesX * tilesY;
+		if (camera_.accumulationResetPending())
+		{
+			tileCursor_ = 0;
+			tilesSinceReset_ = 0;
+		}
+		tileCursor_ %= tileCount;
+
+		// After the scene updates, whose edits restart accumulation in this trace's constants already.
+		camera_.updateCameraUBO(samplesPerDispatch_);
+		const uint32_t cameraOffset = camera_.Offset();
+
+		const uint32_t tiles = tiled_ ? tilesWithinBudget(tileCount) : 1;
+
+		// Wavefront state is sized for one tile, tiles reuse it one after the other.
+		const uint32_t pathCapacity = std::min(tileSize, imgWidth) * std::min(tileSize, imgHeight);
+		if (mode_ == TracerMode::Wavefront && pathCapacity != wavefrontCapacity_)
+		{
+			createWavefrontBuffers(pathCapacity);
+		}
+
+		if (timestampQueries_)
+		{
+			timestampQueries_->Reset(commandBuffer);
+			vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueries_->Handle(), 0);
+		}
+
+		vkCmdFillBuffer(commandBuffer, traceCounterBuffer_->Handle(), 0, VK_WHOLE_SIZE, 0);
+		ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+		// One draw of the whole image serves all of this frame's tiles, they share the first sample's jitter.
+		if (mode_ == TracerMode::Megakernel && variant_.visibilityBuffer)
+		{
+			TraceConstants constants = {};
+			constants.samplesPerDispatch = samplesPerDispatch_;
+			visibilityPass_->Record(commandBuffer, static_cast<uint32_t>(snapshot_->triangles->size()), &constants, cameraOffset);
+		}
+
+		VkDescriptorSet descriptorSets[] = { ComputeTextureDescriptorSet() };
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout_->Handle(), 0, 1, descriptorSets, 1, &cameraOffset);
+
+		// Tiles are visited round robin across frames. Each keeps its own sample count in the accumulation
+		// alpha, and is cleared on its first visit after a reset.
+		uint64_t samples = 0;
+		for (uint32_t i = 0; i != tiles; ++i)
+		{
+			VkRect2D tile = {};
+			tile.offset.x = static_cast<int32_t>(tileCursor_ % tilesX * tileSize);
+			tile.offset.y = static_cast<int32_t>(tileCursor_ / tilesX * tileSize);
+			tile.extent.width = std::min(tileSize, imgWidth - static_cast<uint32_t>(tile.offset.x));
+			tile.extent.height = std::min(tileSize, imgHeight - static_cast<uint32_t>(tile.offset.y));
+
+			recordTile(commandBuffer, tile, tilesSinceReset_ < tileCount);
+			samples += uint64_t(tile.extent.width) * tile.extent.height * samplesPerDispatch_;
+
+			tileCursor_ = (tileCursor_ + 1) % tileCount;
+			tilesSinceReset_ = std::min(tilesSinceReset_ + 1, tileCount);
+		}
+
+		if (timestampQueries_)
+		{
+			vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueries_->Handle(), 1);
+		}
+
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		VkBufferCopy readback = {};
+		readback.size = sizeof(TraceCounters);
+		vkCmdCopyBuffer(commandBuffer, traceCounterBuffer_->Handle(), traceReadbackBuffer_->Handle(), 1, &readback);
+
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		recordedTiles_ = tiles;
+		recordedSamples_ = samples;
+		statistics_.tileCount = tileCount;
+	}
+
+	void ComputeTracer::readStatistics()
+	{
+		// The last dispatch has finished (traces are only recorded once the previous one has), read its counters before clearing them.
+		const auto& counters = *static_cast<const TraceCounters*>(traceCounters_);
+		statistics_.simdUtilisation = counters.laneSteps != 0 ? static_cast<float>(static_cast<double>(counters.busyLaneSteps) / static_cast<double>(counters.laneSteps)) : 0.0f;
+		statistics_.rays = counters.rayCount;
+		statistics_.tiles = recordedTiles_;
+		statistics_.samples = recordedSamples_;
+
+		std::vector<uint64_t> timestamps;
+		if (timestampQueries_ && recordedTiles_ != 0 && timestampQueries_->GetResults(0, 2, timestamps))
+		{
+			statistics_.gpuTime = static_cast<double>(timestamps[1] - timestamps[0]) * timestampPeriod_ * 1e-6;
+
+			// smoothed, the cost of single tiles varies a lot with what is in them
+			const double tileTime = statistics_.gpuTime / recordedTiles_;
+			tileTime_ = tileTime_ == 0.0 ? tileTime : 0.8 * tileTime_ + 0.2 * tileTime;
+		}
+	}
+
+	uint32_t ComputeTracer::tilesWithinBudget(const uint32_t tileCount) const
+	{
+		// Without timestamps there is nothing to budget with, and before the first measurement a single tile is safe.
+		if (!timestampQueries_)
+		{
+			return tileCount;
+		}
+		if (tileTime_ <= 0.0)
+		{
+			return 1;
+		}
+
+		return std::clamp(static_cast<uint32_t>(frameBudget_ / tileTime_), 1u, tileCount);
+	}
+
+	void ComputeTracer::recordTile(VkCommandBuffer commandBuffer, const VkRect2D& tile, const bool clear)
+	{
+		TraceConstants constants = {};
+		constants.samplesPerDispatch = samplesPerDispatch_;
+		constants.tileOffset[0] = static_cast<uint32_t>(tile.offset.x);
+		constants.tileOffset[1] = static_cast<uint32_t>(tile.offset.y);
+		constants.tileExtent[0] = tile.extent.width;
+		constants.tileExtent[1] = tile.extent.height;
+		constants.clearAccumulation = clear ? 1 : 0;
+
+		switch (mode_)
+		{
+		case TracerMode::Megakernel:
+			vkCmdPushConstants(commandBuffer, pipelineLayout_->Handle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+			DispatchMegakernel(commandBuffer, pipelines_->megakernel, variant_, tile.extent);
+			break;
+
+		case TracerMode::PersistentThreads:
+			// every tile hands out its pixels from zero
+			ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+			vkCmdFillBuffer(commandBuffer, traceCounterBuffer_->Handle(), offsetof(TraceCounters, workCounter), sizeof(uint32_t), 0);
+			ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+			vkCmdPushConstants(commandBuffer, pipelineLayout_->Handle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines_->persistent);
+			vkCmdDispatch(commandBuffer, std::min(PersistentGroupCount, (tile.extent.width * tile.extent.height + PersistentGroupSize - 1) / PersistentGroupSize), 1, 1);
+			break;
+
+		case TracerMode::Wavefront:
+			recordWavefront(commandBuffer, constants);
+			break;
+		}
+	}
+
+	void ComputeTracer::recordWavefront(VkCommandBuffer commandBuffer, TraceConstants& constants)
+	{
+		const uint32_t width = constants.tileExtent[0];
+		const uint32_t height = constants.tileExtent[1];
+		const uint32_t pathCount = width * height;
+		constants.pathCapacity = wavefrontCapacity_;
+
+		// Samples are traced one after the other, each adding to the radiance buffer.
+		for (uint32_t sample = 0; sample != samplesPerDispatch_; ++sample)
+		{
+			// Queue 0 starts out with a path per pixel, queue 1 empty.
+			const QueueCounters counters = { { (pathCount + WavefrontGroupSize - 1) / WavefrontGroupSize, 1, 1 }, { pathCount, 0 } };
+			vkCmdUpdateBuffer(commandBuffer, queueBuffer_->Handle(), 0, sizeof(counters), &counters);
+			ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+			constants.currentSample = sample;
+			constants.currentQueue = 0;
+			vkCmdPushConstants(commandBuffer, pipelineLayout_->Handle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, generatePipeline_);
+			vkCmdDispatch(commandBuffer, (width + 15) / 16, (height + 15) / 16, 1);
+			ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+
+			// The host does not know how many paths survive a bounce, every bounce is recorded and sized on the GPU.
+			// Once all paths have terminated the remaining dispatches are empty.
+			for (uint32_t bounce = 0; bounce != variant_.maxBounces; ++bounce)
+			{
+				constants.currentQueue = bounce % 2;
+				vkCmdPushConstants(commandBuffer, pipelineLayout_->Handle(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, extendPipeline_);
+				vkCmdDispatchIndirect(commandBuffer, queueBuffer_->Handle(), 0);
+				ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+
+				if (variant_.sortHits)
+				{
+					recordHitSort(commandBuffer);
+				}
+
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines_->shade);
+				vkCmdDispatchIndirect(commandBuffer, queueBuffer_->Handle(), 0);
+				ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, advancePipeline_);
+				vkCmdDispatch(commandBuffer, 1, 1, 1);
+				ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+			}
+		}
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, accumulatePipeline_);
+		vkCmdDispatch(commandBuffer, (width + 15) / 16, (height + 15) / 16, 1);
+		// the next tile reuses the radiance buffer
+		ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+	}
+
+	void ComputeTracer::recordHitSort(VkCommandBuffer commandBuffer)
+	{
+		// A counting sort over the bins: count the hits per bin, scan the counts into offsets, scatter.
+		vkCmdFillBuffer(commandBuffer, hitSortBuffer_->Handle(), 0, HitSortBins * sizeof(uint32_t), 0);
+		ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, sortCountPipeline_);
+		vkCmdDispatchIndirect(commandBuffer, queueBuffer_->Handle(), 0);
+		ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, sortScanPipeline_);
+		vkCmdDispatch(commandBuffer, 1, 1, 1);
+		ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, sortScatterPipeline_);
+		vkCmdDispatchIndirect(commandBuffer, queueBuffer_->Handle(), 0);
+		ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+	}
+
+	void ComputeTracer::createWavefrontBuffers(uint32_t pathCapacity)
+	{
+		// Only called between frames, after the fence of the last dispatch using the old buffers.
+		CreateStorageBuffer<PathState>(device_, "Paths", 2 * size_t(pathCapacity), 0, pathBuffer_, pathBufferMemory_);
+		CreateStorageBuffer<HitRecord>(device_, "Hits", pathCapacity, 0, hitBuffer_, hitBufferMemory_);
+		CreateStorageBuffer<glm::vec4>(device_, "Radiance", pathCapacity, 0, radianceBuffer_, radianceBufferMemory_);
+		CreateStorageBuffer<QueueCounters>(device_, "Queues", 1, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, queueBuffer_, queueBufferMemory_);
+		CreateStorageBuffer<uint32_t>(device_, "Hit Sort", 2 * size_t(HitSortBins) + pathCapacity, VK_BUFFER_USAGE_TRANSFER_DST_BIT, hitSortBuffer_, hitSortBufferMemory_);
+		wavefrontCapacity_ = pathCapacity;
+
+		const std::pair<uint32_t, const Buffer*> bindings[] = { {9, pathBuffer_.get()}, {10, hitBuffer_.get()}, {11, radianceBuffer_.get()}, {12, queueBuffer_.get()}, {14, hitSortBuffer_.get()} };
+		std::vector<VkDescriptorBufferInfo> bufferInfos;
+		for (const auto& binding : bindings)
+		{
+			VkDescriptorBufferInfo bufferInfo = {};
+			bufferInfo.buffer = binding.second->Handle();
+			bufferInfo.range = VK_WHOLE_SIZE;
+			bufferInfos.push_back(bufferInfo);
+		}
+
+		auto& descriptorSets = descriptorSetManager_->DescriptorSets();
+		std::vector<VkWriteDescriptorSet> descriptorWrites;
+		for (size_t i = 0; i != bufferInfos.size(); ++i)
+		{
+			descriptorWrites.push_back(descriptorSets.Bind(0, bindings[i].first, bufferInfos[i]));
+		}
+
+		descriptorSets.UpdateDescriptors(0, descriptorWrites);
+	}
+
+	bool ComputeTracer::updateScene()
+	{
+		// Everything submitted before this frame has finished, so older snapshots can go.
+		auto retired = retiredSnapshots_.begin();
+		for (; retired != retiredSnapshots_.end() && retired->second < frame_; ++retired)
+		{
+			sceneEditor_.Retire(retired->first);
+		}
+		retiredSnapshots_.erase(retiredSnapshots_.begin(), retired);
+
+		++frame_;
+
+		SceneSnapshot* const snapshot = sceneEditor_.Acquire();
+		if (snapshot == nullptr)
+		{
+			return false;
+		}
+
+		sceneEditor_.Acknowledge(snapshot->version);
+		pendingUploads_.Merge(snapshot->delta);
+		retiredSnapshots_.emplace_back(snapshot_, frame_);
+		snapshot_ = snapshot;
+		return true;
+	}
+
+	bool ComputeTracer::recordSceneUpdates(VkCommandBuffer commandBuffer)
+	{
+		const SceneSnapshot& scene = *snapshot_;
+		acquireSceneBuffers(commandBuffer);
+
+		// The previous trace has finished, so its copies out of the staging arena have as well. The scene upload
+		// may not have, it is only waited for once there is something to stage.
+		bool recorded = false;
+		if (!pendingUploads_.Empty())
+		{
+			waitForStaging();
+			StageUpdate(*uploads_, *vertexBuffer_, *scene.vertices, pendingUploads_.vertices);
+			StageUpdate(*uploads_, *normalBuffer_, *scene.normals, pendingUploads_.vertices);
+			StageUpdate(*uploads_, *materialBuffer_, *scene.materials, pendingUploads_.materials);
+			StageUpdate(*uploads_, *triangleBuffer_, *scene.triangles, pendingUploads_.triangles);
+			StageUpdate(*uploads_, *bvhNodeBuffer_, *scene.bvhNodes, pendingUploads_.nodes);
+			if (sceneStructure_ && !pendingUploads_.triangles.Empty())
+			{
+				sceneStructure_->StageTriangleOrder(*uploads_, scene);
+			}
+			recorded = uploads_->Record(commandBuffer);
+		}
+
+		// Reads the vertices just uploaded, its own barrier orders it after them.
+		if (sceneStructure_ && !pendingUploads_.vertices.Empty())
+		{
+			sceneStructure_->RecordRefit(commandBuffer);
+		}
+
+		if (pendingUploads_.ResetsAccumulation())
+		{
+			camera_.resetAccumulation();
+		}
+		pendingUploads_ = SceneDelta();
+
+		if (!recorded)
+		{
+			return false;
+		}
+
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		return true;
+	}
+
 	VkDescriptorSet ComputeTracer::ComputeTextureDescriptorSet() const
 	{
 		return descriptorSetManager_->DescriptorSets().Handle(0);
@@ -138,6 +1130,21 @@ namespace Vulkan
 		accumulatorImageDescriptorInfo_.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 		accumulatorImageDescriptorInfo_.imageView = accumulatorImageView_->Handle();
 	}
+	VkPipeline ComputeTracer::createPipeline(const std::string& shaderPath, const VkSpecializationInfo* specialization) const
+	{
+		const ShaderModule computeShader(device_, shaderPath);
+
+		VkComputePipelineCreateInfo computeCreateInfo = {};
+		computeCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		computeCreateInfo.layout = pipelineLayout_->Handle();
+		computeCreateInfo.stage = computeShader.CreateShaderStage(VK_SHADER_STAGE_COMPUTE_BIT, specialization);
+
+		VkPipeline pipeline{};
+		Check(vkCreateComputePipelines(device_.Handle(), pipelineCache_.Handle(), 1, &computeCreateInfo, nullptr, &pipeline),
+			"create compute pipeline");
+		return pipeline;
+	}
+
 	void ComputeTracer::deleteAccumulatorImage()
 	{
 		device_.WaitIdle();
@@ -9,40 +9,200 @@
 #include "../Vulkan/CommandPool.hpp"
 #include "../Vulkan/Buffer.hpp"
 #include "../Vulkan/DeviceMemory.hpp"
+#include "../Vulkan/PipelineCache.hpp"
+#include "../Vulkan/QueryPool.hpp"
+#include "../Vulkan/AsyncUploader.hpp"
+#include "../Vulkan/UploadBatcher.hpp"
 #include "../PathTracer/Camera.hpp"
-#include "../PathTracer/Scene.hpp"
+#include "../PathTracer/SceneEditor.hpp"
 
+#include <future>
+#include <map>
 #include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace Vulkan
 {
+	enum class TracerMode
+	{
+		// one kernel runs each path from the camera to termination
+		Megakernel,
+		// generate, extend, shade and accumulate kernels passing compacted path queues between them
+		Wavefront,
+		// the megakernel on a fixed number of workgroups, lanes start a new pixel as soon as their path ends
+		PersistentThreads
+	};
+
+	// Compile-time settings of the tracing kernels, passed as the specialization constants in Structs.glsl.
+	// Each variant is its own set of pipelines, compiled the first time it is used.
+	struct TracerVariant
+	{
+		uint32_t maxBounces = 30;
+		uint32_t rouletteStart = 4; // first bounce Russian roulette may end a path at
+		uint32_t groupWidth = 16; // megakernel workgroup
+		uint32_t groupHeight = 16;
+		// 1D megakernel workgroups of groupWidth lanes, a power of 4, each tracing a square block of pixels in
+		// Morton order. groupHeight is 1.
+		bool mortonOrder = false;
+		// Wavefront only, the hits of every bounce are sorted by material and ray direction before shading, so
+		// lanes running the same BSDF execute together.
+		bool sortHits = false;
+		// Megakernel only, traverse the hardware acceleration structure with VK_KHR_ray_query instead of the
+		// scene BVH. Needs ComputeTracer::RayQuerySupported().
+		bool rayQuery = false;
+		// Megakernel only, the first hit of each dispatch's first sample comes from a rasterized visibility
+		// buffer instead of traversal. Needs ComputeTracer::VisibilitySupported().
+		bool visibilityBuffer = false;
+		// Megakernel only, the software BVH traversal runs subgroup cooperative, with the lanes of coherent
+		// subgroups sharing node fetches and the stacks in shared memory, from tracer_subgroup.comp. Not with
+		// rayQuery, needs SubgroupTraversalSupported().
+		bool subgroupTraversal = false;
+		// Megakernel only, the BSDF's colour terms are evaluated in half floats (Precision.glsl), the rest of
+		// the kernel stays 32 bit. Needs HalfShadingSupported().
+		bool halfShading = false;
+		bool diffuseOnly = false; // every surface a Lambertian reflector of its albedo
+		float minAlpha = 0.001f; // GGX roughness floor
+		float sampleClamp = 50.0f;
+
+		bool operator==(const TracerVariant& other) const;
+		bool operator<(const TracerVariant& other) const;
+	};
+
+	enum class TracerPreset
+	{
+		Reference,
+		// few bounces, for moving around the scene
+		Preview,
+		DiffuseOnly
+	};
+
+	TracerVariant PresetVariant(TracerPreset preset);
+
+	struct TraceStatistics
+	{
+		// share of the issued SIMD lane steps that traced paths, 0 in wavefront mode
+		float simdUtilisation{};
+		// GPU time of the trace, 0 if the compute queue has no timestamps
+		double gpuTime{};
+		uint64_t rays{}; // segments of all the paths traced
+		uint32_t tiles{};
+		uint32_t tileCount{};
+		uint64_t samples{};
+	};
+
+	class SceneAccelerationStructure;
+	class VisibilityPass;
+
 	class ComputeTracer
 	{
 	public:
-		ComputeTracer(const Vulkan::Device& device, Vulkan::CommandPool& commandPool, VkDescriptorImageInfo& imageInfo, uint32_t imgWidth, uint32_t imgHeight);
+		ComputeTracer(const Vulkan::Device& device, Vulkan::CommandPool& commandPool, const Vulkan::PipelineCache& pipelineCache, VkDescriptorImageInfo& imageInfo, uint32_t imgWidth, uint32_t imgHeight, const std::string& scenePath);
 		~ComputeTracer();
 
 		void resizeComputeTarget(uint32_t imgWidth, uint32_t imgHeight, VkDescriptorImageInfo& imageDescriptor);
-		void bindPipeline(VkCommandBuffer& commandBuffer)
-		{
-			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
-		}
-		void updateCameraUBO()
-		{
-			camera_.updateCameraUBO();
-		}
+		void setMode(TracerMode mode) { mode_ = mode; }
+		TracerMode Mode() const { return mode_; }
+		// Samples per pixel traced by one dispatch. They are summed on chip and written to the accumulation
+		// image once, the count can change without restarting accumulation.
+		void setSamplesPerDispatch(uint32_t samples);
+		uint32_t SamplesPerDispatch() const { return samplesPerDispatch_; }
+		// Tiled, the image is traced in tiles and each frame takes as many as fit the frame budget (in ms),
+		// going by the GPU time of earlier tiles. Keeps the UI responsive when a full frame of samples is too slow.
+		void setTiling(bool tiled, float frameBudget);
+		// Changing the variant restarts accumulation, a variant not used before compiles its pipelines first. In the
+		// background that happens on another thread, traces keep the current variant until recordTrace finds the new
+		// pipelines ready.
+		void setVariant(const TracerVariant& variant, bool background = false);
+		// The variant traces use, the one last set once it has compiled.
+		const TracerVariant& Variant() const { return variant_; }
+		// Whether the device has ray queries, without them only the software BVH traversal is available.
+		bool RayQuerySupported() const { return sceneStructure_ != nullptr; }
+		// Whether the compute queue can rasterize the visibility buffer.
+		bool VisibilitySupported() const;
+		// Whether the compute stage has the subgroup ballot and vote operations of the cooperative traversal.
+		bool SubgroupTraversalSupported() const;
+		// Whether the device has shaderFloat16.
+		bool HalfShadingSupported() const;
+		// GPU milliseconds of a megakernel dispatch over the whole image with the variant, the fastest of a few.
+		// Waits for the result, call with the compute queue idle. Restarts accumulation, 0 without timestamps.
+		double benchmarkVariant(const TracerVariant& variant, uint32_t imgWidth, uint32_t imgHeight);
+		// Records samplesPerDispatch samples per pixel of this frame's tiles with the current mode, and writes the camera
+		// constants they read.
+		void recordTrace(VkCommandBuffer commandBuffer, uint32_t imgWidth, uint32_t imgHeight);
+		// Of the last finished frame.
+		const TraceStatistics& Statistics() const { return statistics_; }
+		void resetAccumulation() { camera_.resetAccumulation(); }
+		// Moves the camera without touching the scene, accumulation restarts.
+		void setCamera(const CameraDescription& camera);
+		// Picks up the newest scene snapshot, if the editor published one. Call before recording a trace,
+		// once the previous one has finished.
+		bool updateScene();
+		// Records the upload of everything that changed in the snapshots picked up since the last call,
+		// ahead of the dispatch. Edits to materials or geometry reset accumulation.
+		bool recordSceneUpdates(VkCommandBuffer commandBuffer);
+		// The timeline semaphore value the submit of the commands of the last recordSceneUpdates has to wait for
+		// at VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, the scene upload on the transfer queue. A null semaphore for none.
+		std::pair<VkSemaphore, uint64_t> UploadWait() const;
 
 		VkDescriptorSet ComputeTextureDescriptorSet() const;
 		const class PipelineLayout& PipelineLayout() const { return *pipelineLayout_; }
+		const SceneSnapshot& Snapshot() const { return *snapshot_; }
+		class SceneEditor& SceneEditor() { return sceneEditor_; }
 	private:
 		void createAccumulatorImage(uint32_t imgWidth, uint32_t imgHeight);
 		void deleteAccumulatorImage();
+		VkPipeline createPipeline(const std::string& shaderPath, const VkSpecializationInfo* specialization = nullptr) const;
+		struct TraceConstants;
+
+		// the kernels that read the specialization constants
+		struct VariantPipelines
+		{
+			VkPipeline megakernel{};
+			VkPipeline persistent{};
+			VkPipeline shade{};
+		};
+		// Cached, waiting for a background compile of the variant or compiling it here.
+		const VariantPipelines& variantPipelines(const TracerVariant& variant);
+		VariantPipelines compileVariant(const TracerVariant& variant) const;
+		void useVariant(const TracerVariant& variant);
+		// Caches the finished background compiles, and switches to the variant waiting for one of them.
+		void collectVariants();
+
+		void readStatistics();
+		// Waits on the host for the scene upload still copying out of the staging arena, if there is one.
+		void waitForStaging();
+		// Takes the scene buffers over from the transfer queue and builds the acceleration structure, once, ahead of
+		// the first commands using them.
+		void acquireSceneBuffers(VkCommandBuffer commandBuffer);
+		uint32_t tilesWithinBudget(uint32_t tileCount) const;
+		void recordTile(VkCommandBuffer commandBuffer, const VkRect2D& tile, bool clear);
+		void recordWavefront(VkCommandBuffer commandBuffer, TraceConstants& constants);
+		void recordHitSort(VkCommandBuffer commandBuffer);
+		void createWavefrontBuffers(uint32_t pathCapacity);
 
 		const Device& device_;
 		CommandPool& commandPool_;
+		const PipelineCache& pipelineCache_;
+		class SceneEditor sceneEditor_;
 		Camera camera_;
 
-		VULKAN_HANDLE(VkPipeline, pipeline_)
+		TracerMode mode_ = TracerMode::Megakernel;
+		uint32_t samplesPerDispatch_ = 1;
+		TracerVariant variant_;
+		std::map<TracerVariant, VariantPipelines> variants_;
+		std::map<TracerVariant, std::future<VariantPipelines>> compiling_; // on other threads
+		std::optional<TracerVariant> pendingVariant_; // set in the background, used once compiled
+		const VariantPipelines* pipelines_{}; // of variant_
+		VkPipeline generatePipeline_{};
+		VkPipeline extendPipeline_{};
+		VkPipeline advancePipeline_{};
+		VkPipeline sortCountPipeline_{};
+		VkPipeline sortScanPipeline_{};
+		VkPipeline sortScatterPipeline_{};
+		VkPipeline accumulatePipeline_{};
 
 		std::unique_ptr<DescriptorSetManager> descriptorSetManager_;
 		std::unique_ptr<Vulkan::PipelineLayout> pipelineLayout_;
@@ -52,6 +212,13 @@ namespace Vulkan
 		std::unique_ptr<class ImageView> accumulatorImageView_;
 		std::unique_ptr<class Sampler> accumulatorImageSampler_;
 		VkDescriptorImageInfo accumulatorImageDescriptorInfo_;
+		// scene buffer uploads, all at once when loading and then the edits of each frame
+		std::unique_ptr<UploadBatcher> uploads_;
+		// with a dedicated transfer queue the scene is uploaded while the pipelines are created
+		std::unique_ptr<AsyncUploader> asyncUploads_;
+		uint64_t sceneUpload_{}; // the semaphore value of the scene upload until it is acquired, 0 after
+		uint64_t uploadWait_{}; // the value the commands of the last recordSceneUpdates wait for, 0 for none
+		uint64_t stagingUpload_{}; // the scene upload until the host waited for it, it owns the staging arena till then
 		// storage buffers for all the yummy scene data
 		std::unique_ptr<Buffer> vertexBuffer_;
 		std::unique_ptr<DeviceMemory> vertexBufferMemory_;
@@ -70,7 +237,49 @@ namespace Vulkan
 
 		std::unique_ptr<Buffer> materialBuffer_;
 		std::unique_ptr<DeviceMemory> materialBufferMemory_;
-		const Scene scene;
 
+		// built from the vertex buffer, only with ray query support
+		std::unique_ptr<SceneAccelerationStructure> sceneStructure_;
+		bool sceneStructureBuilt_{};
+		// primary hits of the megakernel, sized like the image
+		std::unique_ptr<VisibilityPass> visibilityPass_;
+
+		// lane usage and the persistent work counter, read back on the host
+		std::unique_ptr<Buffer> traceCounterBuffer_;
+		std::unique_ptr<DeviceMemory> traceCounterBufferMemory_;
+		std::unique_ptr<Buffer> traceReadbackBuffer_;
+		std::unique_ptr<DeviceMemory> traceReadbackBufferMemory_;
+		void* traceCounters_{}; // the readback copy
+		TraceStatistics statistics_;
+
+		// tiles are visited round robin, the first visit after a reset clears the tile
+		bool tiled_{};
+		float frameBudget_ = 8.0f;
+		uint32_t tileCursor_{};
+		uint32_t tilesSinceReset_{};
+		double tileTime_{}; // smoothed GPU milliseconds per tile
+		uint32_t recordedTiles_{};
+		uint64_t recordedSamples_{};
+		std::unique_ptr<QueryPool> timestampQueries_;
+		double timestampPeriod_{};
+
+		// wavefront path state, sized for a path per pixel of a tile and created on first use
+		uint32_t wavefrontCapacity_{};
+		std::unique_ptr<Buffer> pathBuffer_;
+		std::unique_ptr<DeviceMemory> pathBufferMemory_;
+		std::unique_ptr<Buffer> hitBuffer_;
+		std::unique_ptr<DeviceMemory> hitBufferMemory_;
+		std::unique_ptr<Buffer> radianceBuffer_;
+		std::unique_ptr<DeviceMemory> radianceBufferMemory_;
+		std::unique_ptr<Buffer> queueBuffer_;
+		std::unique_ptr<DeviceMemory> queueBufferMemory_;
+		std::unique_ptr<Buffer> hitSortBuffer_;
+		std::unique_ptr<DeviceMemory> hitSortBufferMemory_;
+
+		SceneSnapshot* snapshot_{};
+		SceneDelta pendingUploads_;
+		// replaced snapshots and the frame they were replaced in
+		std::vector<std::pair<SceneSnapshot*, uint64_t>> retiredSnapshots_;
+		uint64_t frame_{};
 	};
 }
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include "SceneAccelerationStructure.hpp"
+
+#include "../Vulkan/UploadBatcher.hpp"
+
+#include <algorithm>
+
+namespace Vulkan
+{
+	namespace
+	{
+		// Identifies a triangle across scene BVHs, which only reorder the array: its model and first index.
+		template <class Triangle>
+		uint64_t TriangleKey(const Triangle& triangle)
+		{
+			return uint64_t(triangle.modelOffset) << 32 | triangle.v_indices;
+		}
+
+		// Vertex k of triangle i at 3 * i + k, as absolute vertex buffer indices.
+		std::vector<uint32_t> FlattenIndices(const SceneSnapshot& scene, const uint32_t triangleCount)
+		{
+			const auto& triangles = *scene.triangles;
+			const auto& indices = *scene.indices;
+
+			std::vector<uint32_t> flattened(3 * size_t(triangleCount));
+			for (uint32_t i = 0; i != triangleCount; ++i)
+			{
+				for (uint32_t k = 0; k != 3; ++k)
+				{
+					flattened[3 * size_t(i) + k] = triangles[i].modelOffset + indices[triangles[i].v_indices + k];
+				}
+			}
+			return flattened;
+		}
+
+		void BuildBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+		{
+			VkMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+			barrier.dstAccessMask = dstAccess;
+
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		}
+	}
+
+	SceneAccelerationStructure::SceneAccelerationStructure(const class Device& device, UploadBatcher& uploads, const Buffer& vertexBuffer, const SceneSnapshot& scene) :
+		device_(device),
+		deviceProcedures_(device),
+		vertexBuffer_(vertexBuffer),
+		vertexCount_(static_cast<uint32_t>(scene.vertices->size())),
+		triangleCount_(static_cast<uint32_t>(scene.triangles->size()))
+	{
+		const VkBufferUsageFlags inputUsage = VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+		uploads.CreateDeviceBuffer("Acceleration Structure Indices", inputUsage, FlattenIndices(scene, triangleCount_), indexBuffer_, indexBufferMemory_);
+
+		// Primitive i is triangle i of this scene, for good.
+		triangleMap_.resize(triangleCount_);
+		primitives_.reserve(triangleCount_);
+		for (uint32_t i = 0; i != triangleCount_; ++i)
+		{
+			triangleMap_[i] = i;
+			primitives_.emplace(TriangleKey((*scene.triangles)[i]), i);
+		}
+		uploads.CreateDeviceBuffer("Acceleration Structure Triangle Map", VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, triangleMap_, triangleMapBuffer_, triangleMapBufferMemory_);
+
+		bottomLevelGeometry_.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+		bottomLevelGeometry_.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
+		bottomLevelGeometry_.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+		auto& triangles = bottomLevelGeometry_.geometry.triangles;
+		triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
+		triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
+		triangles.vertexData.deviceAddress = vertexBuffer.GetDeviceAddress();
+		triangles.vertexStride = sizeof(glm::vec4); // the position, then u
+		triangles.maxVertex = vertexCount_ - 1;
+		triangles.indexType = VK_INDEX_TYPE_UINT32;
+		triangles.indexData.deviceAddress = indexBuffer_->GetDeviceAddress();
+
+		VkAccelerationStructureBuildSizesInfoKHR bottomLevelSizes = {};
+		bottomLevelSizes.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
+		const auto bottomLevelInfo = bottomLevelBuildInfo(VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR);
+		deviceProcedures_.vkGetAccelerationStructureBuildSizesKHR(device_.Handle(), VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &bottomLevelInfo, &triangleCount_, &bottomLevelSizes);
+		bottomLevel_.reset(new AccelerationStructure(deviceProcedures_, VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, bottomLevelSizes.accelerationStructureSize));
+
+		// One instance, the triangles are already in world space. Both faces are hit, like the software traversal.
+		VkAccelerationStructureInstanceKHR instance = {};
+		instance.transform.matrix[0][0] = 1.0f;
+		instance.transform.matrix[1][1] = 1.0f;
+		instance.transform.matrix[2][2] = 1.0f;
+		instance.mask = 0xFF;
+		instance.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
+		instance.accelerationStructureReference = bottomLevel_->GetDeviceAddress();
+		uploads.CreateDeviceBuffer("Acceleration Structure Instances", inputUsage, std::vector<VkAccelerationStructureInstanceKHR>{ instance }, instanceBuffer_, instanceBufferMemory_);
+
+		topLevelGeometry_.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+		topLevelGeometry_.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+		topLevelGeometry_.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+		topLevelGeometry_.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+		topLevelGeometry_.geometry.instances.arrayOfPointers = VK_FALSE;
+		topLevelGeometry_.geometry.instances.data.deviceAddress = instanceBuffer_->GetDeviceAddress();
+
+		const uint32_t instanceCount = 1;
+		VkAccelerationStructureBuildSizesInfoKHR topLevelSizes = {};
+		topLevelSizes.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
+		const auto topLevelInfo = topLevelBuildInfo();
+		deviceProcedures_.vkGetAccelerationStructureBuildSizesKHR(device_.Handle(), VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &topLevelInfo, &instanceCount, &topLevelSizes);
+		topLevel_.reset(new AccelerationStructure(deviceProcedures_, VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR, topLevelSizes.accelerationStructureSize));
+
+		device_.DebugUtils().SetObjectName(bottomLevel_->Handle(), "Scene BLAS");
+		device_.DebugUtils().SetObjectName(topLevel_->Handle(), "Scene TLAS");
+
+		// The scratch address has to be aligned, the buffer is made large enough to align it up.
+		VkPhysicalDeviceAccelerationStructurePropertiesKHR accelerationProperties = {};
+		accelerationProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR;
+		VkPhysicalDeviceProperties2 properties = {};
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties.pNext = &accelerationProperties;
+		vkGetPhysicalDeviceProperties2(device_.PhysicalDevice(), &properties);
+		const VkDeviceSize alignment = std::max<VkDeviceSize>(accelerationProperties.minAccelerationStructureScratchOffsetAlignment, 1);
+
+		const VkDeviceSize scratchSize = std::max({ bottomLevelSizes.buildScratchSize, bottomLevelSizes.updateScratchSize, topLevelSizes.buildScratchSize });
+		scratchBuffer_.reset(new Buffer(device_, scratchSize + alignment, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT));
+		scratchBufferMemory_.reset(new DeviceMemory(scratchBuffer_->AllocateMemory(VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
+		device_.DebugUtils().SetObjectName(scratchBuffer_->Handle(), "Acceleration Structure Scratch Buffer");
+		scratchAddress_ = (scratchBuffer_->GetDeviceAddress() + alignment - 1) / alignment * alignment;
+	}
+
+	SceneAccelerationStructure::~SceneAccelerationStructure()
+	{
+		topLevel_.reset();
+		bottomLevel_.reset();
+	}
+
+	void SceneAccelerationStructure::StageTriangleOrder(UploadBatcher& uploads, const SceneSnapshot& scene)
+	{
+		const auto& triangles = *scene.triangles;
+		for (uint32_t i = 0; i != triangleCount_; ++i)
+		{
+			triangleMap_[primitives_.at(TriangleKey(triangles[i]))] = i;
+		}
+
+		uploads.Upload(*triangleMapBuffer_, 0, triangleMap_.data(), triangleMap_.size() * sizeof(uint32_t));
+	}
+
+	void SceneAccelerationStructure::RecordBuild(VkCommandBuffer commandBuffer)
+	{
+		recordBuild(commandBuffer, VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR);
+	}
+
+	void SceneAccelerationStructure::RecordRefit(VkCommandBuffer commandBuffer)
+	{
+		recordBuild(commandBuffer, VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR);
+	}
+
+	VkAccelerationStructureBuildGeometryInfoKHR SceneAccelerationStructure::bottomLevelBuildInfo(const VkBuildAccelerationStructureModeKHR mode) const
+	{
+		VkAccelerationStructureBuildGeometryInfoKHR buildInfo = {};
+		buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+		buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+		// updatable, so moving an instance refits in place
+		buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+		buildInfo.mode = mode;
+		buildInfo.srcAccelerationStructure = mode == VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR ? bottomLevel_->Handle() : nullptr;
+		buildInfo.dstAccelerationStructure = bottomLevel_ ? bottomLevel_->Handle() : nullptr;
+		buildInfo.geometryCount = 1;
+		buildInfo.pGeometries = &bottomLevelGeometry_;
+		buildInfo.scratchData.deviceAddress = scratchAddress_;
+		return buildInfo;
+	}
+
+	VkAccelerationStructureBuildGeometryInfoKHR SceneAccelerationStructure::topLevelBuildInfo() const
+	{
+		VkAccelerationStructureBuildGeometryInfoKHR buildInfo = {};
+		buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+		buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
+		buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+		buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+		buildInfo.dstAccelerationStructure = topLevel_ ? topLevel_->Handle() : nullptr;
+		buildInfo.geometryCount = 1;
+		buildInfo.pGeometries = &topLevelGeometry_;
+		buildInfo.scratchData.deviceAddress = scratchAddress_;
+		return buildInfo;
+	}
+
+	void SceneAccelerationStructure::recordBuild(VkCommandBuffer commandBuffer, const VkBuildAccelerationStructureModeKHR mode)
+	{
+		// After the buffer uploads, and after the last trace read the structures about to be written.
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		const auto bottomLevelInfo = bottomLevelBuildInfo(mode);
+		VkAccelerationStructureBuildRangeInfoKHR bottomLevelRange = {};
+		bottomLevelRange.primitiveCount = triangleCount_;
+		const VkAccelerationStructureBuildRangeInfoKHR* bottomLevelRanges[] = { &bottomLevelRange };
+		deviceProcedures_.vkCmdBuildAccelerationStructuresKHR(commandBuffer, 1, &bottomLevelInfo, bottomLevelRanges);
+
+		// The top level reads the bottom one and reuses the scratch buffer. A changed bottom level invalidates
+		// the top level, it is rebuilt every time, being a single instance.
+		BuildBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR);
+
+		const auto topLevelInfo = topLevelBuildInfo();
+		VkAccelerationStructureBuildRangeInfoKHR topLevelRange = {};
+		topLevelRange.primitiveCount = 1;
+		const VkAccelerationStructureBuildRangeInfoKHR* topLevelRanges[] = { &topLevelRange };
+		deviceProcedures_.vkCmdBuildAccelerationStructuresKHR(commandBuffer, 1, &topLevelInfo, topLevelRanges);
+
+		BuildBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+	}
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "../Vulkan/AccelerationStructure.hpp"
+#include "../Vulkan/Buffer.hpp"
+#include "../Vulkan/DeviceMemory.hpp"
+#include "../Vulkan/DeviceProcedures.hpp"
+#include "../PathTracer/SceneEditor.hpp"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Vulkan
+{
+	class UploadBatcher;
+
+	// The hardware counterpart of the scene BVH for the ray query tracer: a bottom level structure over all the
+	// triangles and a top level one holding it once. The primitives keep the triangle order of the first scene,
+	// a new scene BVH only reorders the triangle array, so the bottom level is never rebuilt, only refit. Primitive
+	// i is triangles[TriangleMap()[i]], a hit indexes the same scene arrays as the software traversal through it.
+	class SceneAccelerationStructure final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(SceneAccelerationStructure)
+
+		// The vertex buffer needs the acceleration structure build input and device address usages. The build
+		// inputs are staged into the batch, RecordBuild comes after it.
+		SceneAccelerationStructure(const Device& device, UploadBatcher& uploads, const Buffer& vertexBuffer, const SceneSnapshot& scene);
+		~SceneAccelerationStructure();
+
+		// Records the first build, once the batch and the vertex upload have been recorded or acquired. Ends with
+		// a barrier for the tracing kernels.
+		void RecordBuild(VkCommandBuffer commandBuffer);
+		// Stages the primitive to triangle map of a reordered triangle array (a new scene BVH).
+		void StageTriangleOrder(UploadBatcher& uploads, const SceneSnapshot& scene);
+		// Records the refit after the vertex buffer was updated. Ends with a barrier for the tracing kernels.
+		void RecordRefit(VkCommandBuffer commandBuffer);
+
+		VkAccelerationStructureKHR TopLevel() const { return topLevel_->Handle(); }
+		const Buffer& TriangleMap() const { return *triangleMapBuffer_; }
+
+	private:
+
+		VkAccelerationStructureBuildGeometryInfoKHR bottomLevelBuildInfo(VkBuildAccelerationStructureModeKHR mode) const;
+		VkAccelerationStructureBuildGeometryInfoKHR topLevelBuildInfo() const;
+		void recordBuild(VkCommandBuffer commandBuffer, VkBuildAccelerationStructureModeKHR mode);
+
+		const Device& device_;
+		const DeviceProcedures deviceProcedures_;
+		const Buffer& vertexBuffer_;
+		const uint32_t vertexCount_;
+		const uint32_t triangleCount_;
+
+		// three vertex indices per primitive, written once
+		std::unique_ptr<Buffer> indexBuffer_;
+		std::unique_ptr<DeviceMemory> indexBufferMemory_;
+		// the current triangle index of each primitive, and the primitive of each triangle by TriangleKey
+		std::unique_ptr<Buffer> triangleMapBuffer_;
+		std::unique_ptr<DeviceMemory> triangleMapBufferMemory_;
+		std::unordered_map<uint64_t, uint32_t> primitives_;
+		std::vector<uint32_t> triangleMap_;
+		std::unique_ptr<Buffer> instanceBuffer_;
+		std::unique_ptr<DeviceMemory> instanceBufferMemory_;
+		// shared by both levels, the builds run one after the other
+		std::unique_ptr<Buffer> scratchBuffer_;
+		std::unique_ptr<DeviceMemory> scratchBufferMemory_;
+		VkDeviceAddress scratchAddress_{};
+
+		// kept, triangles and the instance stay put
+		VkAccelerationStructureGeometryKHR bottomLevelGeometry_{};
+		VkAccelerationStructureGeometryKHR topLevelGeometry_{};
+
+		std::unique_ptr<AccelerationStructure> bottomLevel_;
+		std::unique_ptr<AccelerationStructure> topLevel_;
+	};
+
+}
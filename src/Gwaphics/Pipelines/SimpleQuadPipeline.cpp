@@ -82,8 +82,8 @@ namespace Vulkan
         configInfo.attributeDescriptions = {};
     }
 
-	SimpleQuadPipeline::SimpleQuadPipeline(const Vulkan::SwapChain& swapChain, const Vulkan::RenderPass& renderPass, const std::vector<Vulkan::UniformBuffer>& uniformBuffers, VkDescriptorImageInfo& imageDescriptor)
-	: swapChain_(swapChain)
+	SimpleQuadPipeline::SimpleQuadPipeline(const Vulkan::SwapChain& swapChain, const Vulkan::RenderPass& renderPass, const Vulkan::PipelineCache& pipelineCache, const std::vector<Vulkan::UniformBuffer>& uniformBuffers, const std::vector<VkDescriptorImageInfo>& imageDescriptors)
+	: swapChain_(swapChain), imageCount_(static_cast<uint32_t>(imageDescriptors.size()))
 	{
 		const auto& device = swapChain.Device();
 		const std::vector<DescriptorBinding> descriptorBindings =
@@ -92,22 +92,8 @@ namespace Vulkan
 			{3, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT},
 		};
 
-		descriptorSetManager_.reset(new DescriptorSetManager(device, descriptorBindings, uniformBuffers.size()));
-        
-		auto& descriptorSets = descriptorSetManager_->DescriptorSets();
-        std::vector<VkWriteDescriptorSet> descriptorWrites;
-		for (uint32_t i = 0; i != swapChain.Images().size(); ++i)
-		{
-			VkDescriptorBufferInfo uniformBufferInfo = {};
-			uniformBufferInfo.buffer = uniformBuffers[i].Buffer().Handle();
-			uniformBufferInfo.range = VK_WHOLE_SIZE;
-            
-
-            descriptorWrites.push_back(descriptorSets.Bind(i, 3, uniformBufferInfo));
-            descriptorWrites.push_back(descriptorSets.Bind(i, 0, imageDescriptor));
-		    descriptorSets.UpdateDescriptors(i, descriptorWrites); 
-
-		}
+		descriptorSetManager_.reset(new DescriptorSetManager(device, descriptorBindings, uniformBuffers.size() * imageDescriptors.size()));
+		updateQuadTextureDescriptor(uniformBuffers, imageDescriptors);
 
 
         //const std::vector<DescriptorBinding> imageDescriptorBindings =
@@ -173,7 +159,7 @@ namespace Vulkan
 
         Check(vkCreateGraphicsPipelines(
             device.Handle(),
-            VK_NULL_HANDLE,
+            pipelineCache.Handle(),
             1,
             &pipelineInfo,
             nullptr,
@@ -192,27 +178,29 @@ namespace Vulkan
         descriptorSetManager_.reset();
 	}
 
-    void SimpleQuadPipeline::updateQuadTextureDescriptor(const std::vector<Vulkan::UniformBuffer>& uniformBuffers, VkDescriptorImageInfo& imageDescriptor)
+    void SimpleQuadPipeline::updateQuadTextureDescriptor(const std::vector<Vulkan::UniformBuffer>& uniformBuffers, const std::vector<VkDescriptorImageInfo>& imageDescriptors)
     {
         auto& descriptorSets = descriptorSetManager_->DescriptorSets();
-        std::vector<VkWriteDescriptorSet> descriptorWrites;
         for (uint32_t i = 0; i != uniformBuffers.size(); ++i)
         {
             VkDescriptorBufferInfo uniformBufferInfo = {};
             uniformBufferInfo.buffer = uniformBuffers[i].Buffer().Handle();
             uniformBufferInfo.range = VK_WHOLE_SIZE;
 
-
-            descriptorWrites.push_back(descriptorSets.Bind(i, 3, uniformBufferInfo));
-            descriptorWrites.push_back(descriptorSets.Bind(i, 0, imageDescriptor));
-            descriptorSets.UpdateDescriptors(i, descriptorWrites);
-
+            for (uint32_t image = 0; image != imageCount_; ++image)
+            {
+                const uint32_t set = i * imageCount_ + image;
+                std::vector<VkWriteDescriptorSet> descriptorWrites;
+                descriptorWrites.push_back(descriptorSets.Bind(set, 3, uniformBufferInfo));
+                descriptorWrites.push_back(descriptorSets.Bind(set, 0, imageDescriptors[image]));
+                descriptorSets.UpdateDescriptors(set, descriptorWrites);
+            }
         }
     }
 
-    VkDescriptorSet SimpleQuadPipeline::DescriptorSet(const uint32_t index) const
+    VkDescriptorSet SimpleQuadPipeline::DescriptorSet(const uint32_t index, const uint32_t image) const
     {
-        return descriptorSetManager_->DescriptorSets().Handle(index);
+        return descriptorSetManager_->DescriptorSets().Handle(index * imageCount_ + image);
     }
     //VkDescriptorSet SimpleQuadPipeline::QuadTextureDescriptorSet() const
     //{
@@ -6,6 +6,7 @@
 #include "../Vulkan/DescriptorSetLayout.hpp"
 #include "../Vulkan/DescriptorSetManager.hpp"
 #include "../Vulkan/SwapChain.hpp"
+#include "../Vulkan/PipelineCache.hpp"
 #include "UniformBuffer.hpp"
 #include <memory>
 
@@ -36,10 +37,11 @@ namespace Vulkan
 	class SimpleQuadPipeline
 	{
 	public:
-		SimpleQuadPipeline(const Vulkan::SwapChain& swapChain, const Vulkan::RenderPass& renderPass, const std::vector<Vulkan::UniformBuffer>& uniformBuffers, VkDescriptorImageInfo& imageDescriptor);
+		// A descriptor set per uniform buffer and image, so switching images needs no descriptor updates.
+		SimpleQuadPipeline(const Vulkan::SwapChain& swapChain, const Vulkan::RenderPass& renderPass, const Vulkan::PipelineCache& pipelineCache, const std::vector<Vulkan::UniformBuffer>& uniformBuffers, const std::vector<VkDescriptorImageInfo>& imageDescriptors);
 		~SimpleQuadPipeline();
 
-		void updateQuadTextureDescriptor(const std::vector<Vulkan::UniformBuffer>& uniformBuffers, VkDescriptorImageInfo& imageDescriptor);
+		void updateQuadTextureDescriptor(const std::vector<Vulkan::UniformBuffer>& uniformBuffers, const std::vector<VkDescriptorImageInfo>& imageDescriptors);
 
 		void bindPipeline(VkCommandBuffer& commandBuffer)
 		{
@@ -51,12 +53,13 @@ namespace Vulkan
 			vkCmdDraw(commandBuffer, 6, 1, 0, 0);
 		}
 
-		VkDescriptorSet DescriptorSet(uint32_t index) const;
+		VkDescriptorSet DescriptorSet(uint32_t index, uint32_t image) const;
 		//VkDescriptorSet QuadTextureDescriptorSet() const;
 		const class PipelineLayout& PipelineLayout() const { return *pipelineLayout_; }
 
 	private:
 		const SwapChain& swapChain_;
+		uint32_t imageCount_{};
 
 		VULKAN_HANDLE(VkPipeline, pipeline_)
 
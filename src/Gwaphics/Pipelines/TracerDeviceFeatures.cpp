@@ -0,0 +1,125 @@
+#include "TracerDeviceFeatures.hpp"
+#include "../Vulkan/Enumerate.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Vulkan
+{
+	namespace
+	{
+		const std::vector<const char*> RayQueryExtensions =
+		{
+			VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME,
+			VK_KHR_RAY_QUERY_EXTENSION_NAME,
+			// required by VK_KHR_acceleration_structure
+			VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME
+		};
+
+		bool SupportsExtensions(VkPhysicalDevice physicalDevice, const std::vector<const char*>& extensions)
+		{
+			const auto available = GetEnumerateVector(physicalDevice, static_cast<const char*>(nullptr), vkEnumerateDeviceExtensionProperties);
+			for (const char* const extension : extensions)
+			{
+				const auto found = std::find_if(available.begin(), available.end(), [extension](const VkExtensionProperties& properties)
+				{
+					return std::strcmp(properties.extensionName, extension) == 0;
+				});
+
+				if (found == available.end())
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		bool SupportsRayQuery(VkPhysicalDevice physicalDevice)
+		{
+			if (!SupportsExtensions(physicalDevice, RayQueryExtensions))
+			{
+				return false;
+			}
+
+			VkPhysicalDeviceBufferDeviceAddressFeatures bufferDeviceAddressFeatures = {};
+			bufferDeviceAddressFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+
+			VkPhysicalDeviceAccelerationStructureFeaturesKHR accelerationStructureFeatures = {};
+			accelerationStructureFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR;
+			accelerationStructureFeatures.pNext = &bufferDeviceAddressFeatures;
+
+			VkPhysicalDeviceRayQueryFeaturesKHR rayQueryFeatures = {};
+			rayQueryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_QUERY_FEATURES_KHR;
+			rayQueryFeatures.pNext = &accelerationStructureFeatures;
+
+			VkPhysicalDeviceFeatures2 features = {};
+			features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			features.pNext = &rayQueryFeatures;
+			vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+			return rayQueryFeatures.rayQuery && accelerationStructureFeatures.accelerationStructure && bufferDeviceAddressFeatures.bufferDeviceAddress;
+		}
+	}
+
+	bool TracerDeviceFeatures::SupportsFloat16(VkPhysicalDevice physicalDevice)
+	{
+		VkPhysicalDeviceShaderFloat16Int8Features float16Features = {};
+		float16Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_FLOAT16_INT8_FEATURES;
+
+		VkPhysicalDeviceFeatures2 features = {};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &float16Features;
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+		return float16Features.shaderFloat16;
+	}
+
+	TracerDeviceFeatures::TracerDeviceFeatures(VkPhysicalDevice physicalDevice)
+	{
+		// Pipeline statistics are optional, the GPU profiler only reports times without them.
+		VkPhysicalDeviceFeatures supportedFeatures;
+		vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+		features_.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+
+		// Core in Vulkan 1.2 but optional, hands traces from the compute queue to the frames.
+		timelineSemaphore_.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+		timelineSemaphore_.timelineSemaphore = VK_TRUE;
+		next_ = &timelineSemaphore_;
+
+		// Core in Vulkan 1.2 and optional, for the half float shading variant.
+		if (SupportsFloat16(physicalDevice))
+		{
+			shaderFloat16_.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_FLOAT16_INT8_FEATURES;
+			shaderFloat16_.pNext = next_;
+			shaderFloat16_.shaderFloat16 = VK_TRUE;
+			next_ = &shaderFloat16_;
+		}
+
+		// Optional as well, the tracer falls back to its own BVH without them.
+		if (SupportsRayQuery(physicalDevice))
+		{
+			bufferDeviceAddress_.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+			bufferDeviceAddress_.pNext = next_;
+			bufferDeviceAddress_.bufferDeviceAddress = VK_TRUE;
+
+			accelerationStructure_.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR;
+			accelerationStructure_.pNext = &bufferDeviceAddress_;
+			accelerationStructure_.accelerationStructure = VK_TRUE;
+
+			rayQuery_.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_QUERY_FEATURES_KHR;
+			rayQuery_.pNext = &accelerationStructure_;
+			rayQuery_.rayQuery = VK_TRUE;
+
+			extensions_ = RayQueryExtensions;
+			next_ = &rayQuery_;
+		}
+
+		// Lets the memory allocator keep new blocks within the heap budgets.
+		if (SupportsExtensions(physicalDevice, { VK_EXT_MEMORY_BUDGET_EXTENSION_NAME }))
+		{
+			extensions_.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		}
+	}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "../Vulkan/Vulkan.hpp"
+#include <vector>
+
+namespace Vulkan
+{
+	// The device extensions and features the tracer runs with, for creating the device in windowed and headless
+	// mode alike. The optional ones are only asked for when the physical device has them.
+	class TracerDeviceFeatures final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(TracerDeviceFeatures)
+
+		explicit TracerDeviceFeatures(VkPhysicalDevice physicalDevice);
+		~TracerDeviceFeatures() = default;
+
+		const std::vector<const char*>& Extensions() const { return extensions_; }
+		const VkPhysicalDeviceFeatures& Features() const { return features_; }
+		// Head of the feature structure chain, for VkDeviceCreateInfo::pNext.
+		void* Next() { return next_; }
+
+		// Whether the device does half float arithmetic in shaders, enabled whenever it does.
+		static bool SupportsFloat16(VkPhysicalDevice physicalDevice);
+
+	private:
+
+		std::vector<const char*> extensions_;
+		VkPhysicalDeviceFeatures features_{};
+
+		VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphore_{};
+		VkPhysicalDeviceShaderFloat16Int8Features shaderFloat16_{};
+		VkPhysicalDeviceBufferDeviceAddressFeatures bufferDeviceAddress_{};
+		VkPhysicalDeviceAccelerationStructureFeaturesKHR accelerationStructure_{};
+		VkPhysicalDeviceRayQueryFeaturesKHR rayQuery_{};
+		void* next_{};
+	};
+
+}
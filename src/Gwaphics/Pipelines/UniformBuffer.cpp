@@ -10,12 +10,15 @@ namespace Vulkan {
 
 		buffer_.reset(new Vulkan::Buffer(device, bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT));
 		memory_.reset(new Vulkan::DeviceMemory(buffer_->AllocateMemory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)));
+		data_ = memory_->Map(0, bufferSize);
 	}
 
 	UniformBuffer::UniformBuffer(UniformBuffer&& other) noexcept :
 		buffer_(other.buffer_.release()),
-		memory_(other.memory_.release())
+		memory_(other.memory_.release()),
+		data_(other.data_)
 	{
+		other.data_ = nullptr;
 	}
 
 	UniformBuffer::~UniformBuffer()
@@ -24,11 +27,10 @@ namespace Vulkan {
 		memory_.reset(); // release memory after bound buffer has been destroyed
 	}
 
+	// There is one per swap chain image, the frame that last read it has finished.
 	void UniformBuffer::SetValue(const UniformBufferObject& ubo)
 	{
-		const auto data = memory_->Map(0, sizeof(UniformBufferObject));
-		std::memcpy(data, &ubo, sizeof(ubo));
-		memory_->Unmap();
+		std::memcpy(data_, &ubo, sizeof(ubo));
 	}
 
 }
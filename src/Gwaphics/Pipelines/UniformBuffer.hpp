@@ -41,6 +41,7 @@ namespace Vulkan
 
 		std::unique_ptr<Vulkan::Buffer> buffer_;
 		std::unique_ptr<Vulkan::DeviceMemory> memory_;
+		void* data_{}; // persistently mapped
 	};
 
 }
\ No newline at end of file
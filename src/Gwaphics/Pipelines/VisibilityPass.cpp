@@ -0,0 +1,341 @@
+#include "VisibilityPass.hpp"
+
+#include "../Vulkan/Buffer.hpp"
+#include "../Vulkan/CommandPool.hpp"
+#include "../Vulkan/DepthBuffer.hpp"
+#include "../Vulkan/DescriptorSets.hpp"
+#include "../Vulkan/Device.hpp"
+#include "../Vulkan/DeviceMemory.hpp"
+#include "../Vulkan/Enumerate.hpp"
+#include "../Vulkan/Image.hpp"
+#include "../Vulkan/ImageView.hpp"
+#include "../Vulkan/PipelineCache.hpp"
+#include "../Vulkan/ShaderModule.hpp"
+#include "../Vulkan/SingleTimeCommands.hpp"
+
+#include <array>
+#include <vector>
+
+namespace Vulkan
+{
+	namespace
+	{
+		const VkFormat VisibilityFormat = VK_FORMAT_R32_UINT;
+
+		VkDescriptorBufferInfo WholeBuffer(const Buffer& buffer)
+		{
+			VkDescriptorBufferInfo bufferInfo = {};
+			bufferInfo.buffer = buffer.Handle();
+			bufferInfo.range = VK_WHOLE_SIZE;
+			return bufferInfo;
+		}
+	}
+
+	VisibilityPass::VisibilityPass(
+		CommandPool& commandPool,
+		const PipelineCache& pipelineCache,
+		const VkDescriptorBufferInfo& cameraInfo,
+		const Buffer& vertexBuffer,
+		const Buffer& indexBuffer,
+		const Buffer& triangleBuffer,
+		const uint32_t traceConstantsSize,
+		const uint32_t imgWidth,
+		const uint32_t imgHeight) :
+		device_(commandPool.Device()),
+		commandPool_(commandPool),
+		traceConstantsSize_(traceConstantsSize)
+	{
+		const std::vector<DescriptorBinding> descriptorBindings =
+		{
+			{2, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT},
+			{3, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT},
+			{4, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT},
+			{5, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT},
+		};
+
+		descriptorSetManager_.reset(new DescriptorSetManager(device_, descriptorBindings, 1));
+		auto& descriptorSets = descriptorSetManager_->DescriptorSets();
+		std::vector<VkWriteDescriptorSet> descriptorWrites;
+		descriptorWrites.push_back(descriptorSets.Bind(0, 2, cameraInfo));
+		descriptorWrites.push_back(descriptorSets.Bind(0, 3, WholeBuffer(vertexBuffer)));
+		descriptorWrites.push_back(descriptorSets.Bind(0, 4, WholeBuffer(indexBuffer)));
+		descriptorWrites.push_back(descriptorSets.Bind(0, 5, WholeBuffer(triangleBuffer)));
+		descriptorSets.UpdateDescriptors(0, descriptorWrites);
+
+		VkPushConstantRange pushConstantRange = {};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = traceConstantsSize_;
+
+		pipelineLayout_.reset(new class PipelineLayout(device_, { descriptorSetManager_->DescriptorSetLayout().Handle() }, { pushConstantRange }));
+
+		createTarget(imgWidth, imgHeight);
+		createRenderPass();
+		createPipeline(pipelineCache);
+		createFramebuffer();
+	}
+
+	VisibilityPass::~VisibilityPass()
+	{
+		deleteTarget();
+
+		if (pipeline_ != nullptr)
+		{
+			vkDestroyPipeline(device_.Handle(), pipeline_, nullptr);
+			pipeline_ = nullptr;
+		}
+
+		if (renderPass_ != nullptr)
+		{
+			vkDestroyRenderPass(device_.Handle(), renderPass_, nullptr);
+			renderPass_ = nullptr;
+		}
+
+		pipelineLayout_.reset();
+		descriptorSetManager_.reset();
+	}
+
+	bool VisibilityPass::Supported(const Device& device)
+	{
+		const auto queueFamilies = GetEnumerateVector(device.PhysicalDevice(), vkGetPhysicalDeviceQueueFamilyProperties);
+		return (queueFamilies[device.ComputeFamilyIndex()].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+	}
+
+	void VisibilityPass::Resize(const uint32_t imgWidth, const uint32_t imgHeight)
+	{
+		deleteTarget();
+		createTarget(imgWidth, imgHeight);
+		createFramebuffer();
+	}
+
+	void VisibilityPass::Record(VkCommandBuffer commandBuffer, const uint32_t triangleCount, const void* traceConstants, const uint32_t cameraOffset)
+	{
+		std::array<VkClearValue, 2> clearValues = {};
+		clearValues[0].color.uint32[0] = 0;
+		clearValues[1].depthStencil = { 0.0f, 0 };
+
+		VkRenderPassBeginInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = renderPass_;
+		renderPassInfo.framebuffer = framebuffer_;
+		renderPassInfo.renderArea.extent = extent_;
+		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+		renderPassInfo.pClearValues = clearValues.data();
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		VkViewport viewport = {};
+		viewport.width = static_cast<float>(extent_.width);
+		viewport.height = static_cast<float>(extent_.height);
+		viewport.maxDepth = 1.0f;
+		VkRect2D scissor = {};
+		scissor.extent = extent_;
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+		VkDescriptorSet descriptorSets[] = { descriptorSetManager_->DescriptorSets().Handle(0) };
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout_->Handle(), 0, 1, descriptorSets, 1, &cameraOffset);
+		vkCmdPushConstants(commandBuffer, pipelineLayout_->Handle(), VK_SHADER_STAGE_VERTEX_BIT, 0, traceConstantsSize_, traceConstants);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
+		vkCmdDraw(commandBuffer, 3 * triangleCount, 1, 0, 0);
+
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	void VisibilityPass::createTarget(const uint32_t imgWidth, const uint32_t imgHeight)
+	{
+		extent_ = { imgWidth, imgHeight };
+
+		image_.reset(new Image(device_, extent_, VisibilityFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT));
+		imageMemory_.reset(new DeviceMemory(image_->AllocateMemory(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
+		image_->TransitionImageLayout(commandPool_, VK_IMAGE_LAYOUT_GENERAL);
+		imageView_.reset(new ImageView(device_, image_->Handle(), VisibilityFormat, VK_IMAGE_ASPECT_COLOR_BIT));
+		depthBuffer_.reset(new DepthBuffer(commandPool_, extent_));
+
+		// Empty until the first draw, a megakernel dispatched before it traces every pixel.
+		SingleTimeCommands::Submit(commandPool_, [&](VkCommandBuffer commandBuffer)
+		{
+			VkClearColorValue clear = {};
+			VkImageSubresourceRange range = {};
+			range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			range.levelCount = 1;
+			range.layerCount = 1;
+			vkCmdClearColorImage(commandBuffer, image_->Handle(), VK_IMAGE_LAYOUT_GENERAL, &clear, 1, &range);
+		});
+
+		imageInfo_ = {};
+		imageInfo_.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		imageInfo_.imageView = imageView_->Handle();
+	}
+
+	void VisibilityPass::createFramebuffer()
+	{
+		const std::array<VkImageView, 2> attachments = { imageView_->Handle(), depthBuffer_->ImageView().Handle() };
+
+		VkFramebufferCreateInfo framebufferInfo = {};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = renderPass_;
+		framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+		framebufferInfo.pAttachments = attachments.data();
+		framebufferInfo.width = extent_.width;
+		framebufferInfo.height = extent_.height;
+		framebufferInfo.layers = 1;
+
+		Check(vkCreateFramebuffer(device_.Handle(), &framebufferInfo, nullptr, &framebuffer_),
+			"create visibility framebuffer");
+	}
+
+	void VisibilityPass::deleteTarget()
+	{
+		if (framebuffer_ != nullptr)
+		{
+			vkDestroyFramebuffer(device_.Handle(), framebuffer_, nullptr);
+			framebuffer_ = nullptr;
+		}
+
+		depthBuffer_.reset();
+		imageView_.reset();
+		image_.reset();
+		imageMemory_.reset();
+	}
+
+	void VisibilityPass::createRenderPass()
+	{
+		// The image stays in the general layout for the tracer to read, the depth is only needed while drawing.
+		VkAttachmentDescription attachments[2] = {};
+		attachments[0].format = VisibilityFormat;
+		attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[0].initialLayout = VK_IMAGE_LAYOUT_GENERAL;
+		attachments[0].finalLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		attachments[1].format = depthBuffer_->Format();
+		attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		VkAttachmentReference colorAttachmentRef = { 0, VK_IMAGE_LAYOUT_GENERAL };
+		VkAttachmentReference depthAttachmentRef = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 1;
+		subpass.pColorAttachments = &colorAttachmentRef;
+		subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+		// After the scene uploads and the previous dispatch reading the image, before the next one.
+		VkSubpassDependency dependencies[2] = {};
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+		dependencies[1].srcSubpass = 0;
+		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		VkRenderPassCreateInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = 2;
+		renderPassInfo.pAttachments = attachments;
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+		renderPassInfo.dependencyCount = 2;
+		renderPassInfo.pDependencies = dependencies;
+
+		Check(vkCreateRenderPass(device_.Handle(), &renderPassInfo, nullptr, &renderPass_),
+			"create visibility render pass");
+	}
+
+	void VisibilityPass::createPipeline(const PipelineCache& pipelineCache)
+	{
+		const ShaderModule vertShader(device_, "assets/shaders/visibility.vert.spv");
+		const ShaderModule fragShader(device_, "assets/shaders/visibility.frag.spv");
+
+		const VkPipelineShaderStageCreateInfo shaderStages[] =
+		{
+			vertShader.CreateShaderStage(VK_SHADER_STAGE_VERTEX_BIT),
+			fragShader.CreateShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT)
+		};
+
+		// the vertex shader pulls the triangles from the scene buffers
+		VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo = {};
+		inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+		VkPipelineViewportStateCreateInfo viewportInfo = {};
+		viewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportInfo.viewportCount = 1;
+		viewportInfo.scissorCount = 1;
+
+		// rays hit both faces
+		VkPipelineRasterizationStateCreateInfo rasterizationInfo = {};
+		rasterizationInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterizationInfo.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
+		rasterizationInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+		rasterizationInfo.lineWidth = 1.0f;
+
+		VkPipelineMultisampleStateCreateInfo multisampleInfo = {};
+		multisampleInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisampleInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+		// reversed, depth is near / distance
+		VkPipelineDepthStencilStateCreateInfo depthStencilInfo = {};
+		depthStencilInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		depthStencilInfo.depthTestEnable = VK_TRUE;
+		depthStencilInfo.depthWriteEnable = VK_TRUE;
+		depthStencilInfo.depthCompareOp = VK_COMPARE_OP_GREATER;
+		depthStencilInfo.maxDepthBounds = 1.0f;
+
+		VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+		colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT;
+
+		VkPipelineColorBlendStateCreateInfo colorBlendInfo = {};
+		colorBlendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		colorBlendInfo.attachmentCount = 1;
+		colorBlendInfo.pAttachments = &colorBlendAttachment;
+
+		const VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+		VkPipelineDynamicStateCreateInfo dynamicStateInfo = {};
+		dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamicStateInfo.dynamicStateCount = 2;
+		dynamicStateInfo.pDynamicStates = dynamicStates;
+
+		VkGraphicsPipelineCreateInfo pipelineInfo = {};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineInfo.stageCount = 2;
+		pipelineInfo.pStages = shaderStages;
+		pipelineInfo.pVertexInputState = &vertexInputInfo;
+		pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
+		pipelineInfo.pViewportState = &viewportInfo;
+		pipelineInfo.pRasterizationState = &rasterizationInfo;
+		pipelineInfo.pMultisampleState = &multisampleInfo;
+		pipelineInfo.pDepthStencilState = &depthStencilInfo;
+		pipelineInfo.pColorBlendState = &colorBlendInfo;
+		pipelineInfo.pDynamicState = &dynamicStateInfo;
+		pipelineInfo.layout = pipelineLayout_->Handle();
+		pipelineInfo.renderPass = renderPass_;
+		pipelineInfo.subpass = 0;
+		pipelineInfo.basePipelineIndex = -1;
+
+		Check(vkCreateGraphicsPipelines(device_.Handle(), pipelineCache.Handle(), 1, &pipelineInfo, nullptr, &pipeline_),
+			"create visibility pipeline");
+	}
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "../Vulkan/Vulkan.hpp"
+#include "../Vulkan/DescriptorSetManager.hpp"
+#include "../Vulkan/PipelineLayout.hpp"
+
+#include <memory>
+
+namespace Vulkan
+{
+	class Buffer;
+	class CommandPool;
+	class DepthBuffer;
+	class Device;
+	class DeviceMemory;
+	class Image;
+	class ImageView;
+	class PipelineCache;
+
+	// Rasterized primary visibility for the megakernel. Draws the scene from the camera with the jitter of the
+	// first sample of the coming dispatch and stores the triangle seen through each pixel, plus one, 0 where
+	// there is none. The megakernel then starts those paths at their first hit instead of traversing for it.
+	// Recorded into the tracer's own command buffer, so the compute queue has to take graphics work.
+	class VisibilityPass final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(VisibilityPass)
+
+		// The scene buffers and the camera are the tracer's, bound at the same bindings as in the megakernel.
+		// The push constants are the tracer's TraceConstants.
+		VisibilityPass(
+			CommandPool& commandPool,
+			const PipelineCache& pipelineCache,
+			const VkDescriptorBufferInfo& cameraInfo,
+			const Buffer& vertexBuffer,
+			const Buffer& indexBuffer,
+			const Buffer& triangleBuffer,
+			uint32_t traceConstantsSize,
+			uint32_t imgWidth,
+			uint32_t imgHeight);
+		~VisibilityPass();
+
+		// Whether the tracer's queue family can draw.
+		static bool Supported(const Device& device);
+
+		// Call with the previous dispatches finished, the image is recreated.
+		void Resize(uint32_t imgWidth, uint32_t imgHeight);
+		// The visibility image for the tracer, r32ui in the general layout.
+		const VkDescriptorImageInfo& ImageInfo() const { return imageInfo_; }
+
+		// Draws all of the scene's triangles with the camera constants at cameraOffset. Orders itself after the
+		// scene uploads and the previous dispatch, and the dispatches after it.
+		void Record(VkCommandBuffer commandBuffer, uint32_t triangleCount, const void* traceConstants, uint32_t cameraOffset);
+
+	private:
+
+		void createTarget(uint32_t imgWidth, uint32_t imgHeight);
+		void deleteTarget();
+		void createRenderPass();
+		void createFramebuffer();
+		void createPipeline(const PipelineCache& pipelineCache);
+
+		const Device& device_;
+		CommandPool& commandPool_;
+		const uint32_t traceConstantsSize_;
+
+		std::unique_ptr<DescriptorSetManager> descriptorSetManager_;
+		std::unique_ptr<class PipelineLayout> pipelineLayout_;
+		VkRenderPass renderPass_{};
+		VkPipeline pipeline_{};
+
+		VkExtent2D extent_{};
+		std::unique_ptr<Image> image_;
+		std::unique_ptr<DeviceMemory> imageMemory_;
+		std::unique_ptr<ImageView> imageView_;
+		std::unique_ptr<DepthBuffer> depthBuffer_;
+		VkFramebuffer framebuffer_{};
+		VkDescriptorImageInfo imageInfo_{};
+	};
+
+}
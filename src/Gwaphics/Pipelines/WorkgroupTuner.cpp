@@ -0,0 +1,162 @@
+#include "WorkgroupTuner.hpp"
+#include "ComputeTracer.hpp"
+#include "../Vulkan/Device.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace Vulkan
+{
+	namespace
+	{
+		std::string DeviceUUID(VkPhysicalDevice physicalDevice)
+		{
+			VkPhysicalDeviceIDProperties idProperties = {};
+			idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+			VkPhysicalDeviceProperties2 properties = {};
+			properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			properties.pNext = &idProperties;
+			vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+			std::ostringstream uuid;
+			for (const uint8_t byte : idProperties.deviceUUID)
+			{
+				uuid << std::hex << std::setw(2) << std::setfill('0') << static_cast<uint32_t>(byte);
+			}
+			return uuid.str();
+		}
+	}
+
+	WorkgroupTuner::WorkgroupTuner(const Device& device, std::string path) :
+		device_(device),
+		path_(std::move(path)),
+		deviceUUID_(DeviceUUID(device.PhysicalDevice())),
+		candidates_{
+			{ "16x16", 16, 16, false },
+			{ "8x8", 8, 8, false },
+			{ "16x8", 16, 8, false },
+			{ "32x4", 32, 4, false },
+			{ "Morton 8x8", 64, 1, true },
+			{ "Morton 16x16", 256, 1, true },
+		}
+	{
+		load();
+	}
+
+	void WorkgroupTuner::Tune(ComputeTracer& tracer, const uint32_t imgWidth, const uint32_t imgHeight)
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(device_.PhysicalDevice(), &properties);
+
+		best_ = -1;
+		for (size_t i = 0; i != candidates_.size(); ++i)
+		{
+			auto& candidate = candidates_[i];
+			candidate.time = 0.0;
+			if (candidate.groupWidth * candidate.groupHeight > properties.limits.maxComputeWorkGroupInvocations)
+			{
+				continue;
+			}
+
+			TracerVariant variant = tracer.Variant();
+			variant.groupWidth = candidate.groupWidth;
+			variant.groupHeight = candidate.groupHeight;
+			variant.mortonOrder = candidate.mortonOrder;
+			candidate.time = tracer.benchmarkVariant(variant, imgWidth, imgHeight);
+
+			if (candidate.time > 0.0 && (best_ < 0 || candidate.time < candidates_[best_].time))
+			{
+				best_ = static_cast<int>(i);
+			}
+		}
+
+		// without timestamps nothing was measured, keep what was saved
+		if (best_ < 0)
+		{
+			load();
+			return;
+		}
+
+		std::cout << "Fastest megakernel workgroup: " << candidates_[best_].name << " (" << candidates_[best_].time << " ms)" << std::endl;
+		save();
+	}
+
+	void WorkgroupTuner::Apply(TracerVariant& variant) const
+	{
+		if (const Candidate* best = Best())
+		{
+			variant.groupWidth = best->groupWidth;
+			variant.groupHeight = best->groupHeight;
+			variant.mortonOrder = best->mortonOrder;
+		}
+	}
+
+	// One line per device: the UUID, then workgroup width, height and Morton order.
+	void WorkgroupTuner::load()
+	{
+		best_ = -1;
+
+		std::ifstream file(path_);
+		std::string line;
+		while (std::getline(file, line))
+		{
+			std::istringstream fields(line);
+			std::string uuid;
+			uint32_t width = 0;
+			uint32_t height = 0;
+			bool morton = false;
+			if (!(fields >> uuid >> width >> height >> morton) || uuid != deviceUUID_)
+			{
+				continue;
+			}
+
+			// a shape that is no longer a candidate is ignored
+			for (size_t i = 0; i != candidates_.size(); ++i)
+			{
+				const auto& candidate = candidates_[i];
+				if (candidate.groupWidth == width && candidate.groupHeight == height && candidate.mortonOrder == morton)
+				{
+					best_ = static_cast<int>(i);
+				}
+			}
+		}
+	}
+
+	void WorkgroupTuner::save() const
+	{
+		// Keeps the lines of the other devices.
+		std::vector<std::string> lines;
+		{
+			std::ifstream file(path_);
+			std::string line;
+			while (std::getline(file, line))
+			{
+				if (line.compare(0, deviceUUID_.size(), deviceUUID_) != 0)
+				{
+					lines.push_back(line);
+				}
+			}
+		}
+
+		const Candidate& best = candidates_[best_];
+		std::ostringstream line;
+		line << deviceUUID_ << ' ' << best.groupWidth << ' ' << best.groupHeight << ' ' << best.mortonOrder;
+		lines.push_back(line.str());
+
+		std::ofstream file(path_, std::ios::out | std::ios::trunc);
+		if (!file)
+		{
+			throw std::runtime_error("failed to open '" + path_ + "'");
+		}
+		for (const auto& saved : lines)
+		{
+			file << saved << '\n';
+		}
+	}
+
+}
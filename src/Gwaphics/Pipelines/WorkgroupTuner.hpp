@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../Vulkan/Vulkan.hpp"
+
+#include <string>
+#include <vector>
+
+namespace Vulkan
+{
+	class ComputeTracer;
+	class Device;
+	struct TracerVariant;
+
+	// Finds the megakernel workgroup shape and pixel order that trace fastest on this device by timing each
+	// candidate, and keeps the winner per device UUID in a text file. Coherence and occupancy depend a lot on
+	// the driver, so no single shape is best everywhere.
+	class WorkgroupTuner final
+	{
+	public:
+
+		struct Candidate
+		{
+			const char* name;
+			uint32_t groupWidth;
+			uint32_t groupHeight;
+			bool mortonOrder;
+			double time{}; // ms per dispatch, 0 until timed or if the device does not support the shape
+		};
+
+		VULKAN_NON_COPIABLE(WorkgroupTuner)
+
+		WorkgroupTuner(const Device& device, std::string path);
+
+		// Times every candidate with the rest of the tracer's current variant and saves the fastest. Waits for
+		// the GPU, call with the compute queue idle.
+		void Tune(ComputeTracer& tracer, uint32_t imgWidth, uint32_t imgHeight);
+		// Gives the variant the tuned shape, if this device has been tuned.
+		void Apply(TracerVariant& variant) const;
+
+		const Candidate* Best() const { return best_ >= 0 ? &candidates_[best_] : nullptr; }
+		const std::vector<Candidate>& Candidates() const { return candidates_; }
+
+	private:
+
+		void load();
+		void save() const;
+
+		const Device& device_;
+		const std::string path_;
+		std::string deviceUUID_; // hex, the key of this device's line in the file
+		std::vector<Candidate> candidates_;
+		int best_ = -1;
+	};
+
+}
@@ -0,0 +1,163 @@
+#include "RenderJobs.hpp"
+
+#include <sstream>
+#include <stdexcept>
+
+namespace Vulkan
+{
+
+RenderJobReader::RenderJobReader(std::istream& input, const std::string& name, const HeadlessSettings& defaults) :
+	input_(input),
+	name_(name),
+	defaults_(defaults)
+{
+}
+
+bool RenderJobReader::Next(HeadlessSettings& job)
+{
+	std::string keyword;
+	std::istringstream args;
+
+	// properties before the first job line have no job to go to
+	if (!pending_)
+	{
+		if (!ReadLine(keyword, args))
+		{
+			return false;
+		}
+		if (keyword != "job")
+		{
+			Fail("expected 'job <output>' before '" + keyword + "'");
+		}
+		ReadJob(args);
+	}
+
+	job = defaults_;
+	job.output = pendingOutput_;
+	pending_ = false;
+
+	bool samplesGiven = false;
+	bool timeGiven = false;
+	while (ReadLine(keyword, args))
+	{
+		if (keyword == "job")
+		{
+			ReadJob(args);
+			break;
+		}
+
+		samplesGiven |= keyword == "spp";
+		timeGiven |= keyword == "time";
+		ParseProperty(job, keyword, args);
+	}
+
+	// a time budget alone renders until it runs out, as on the command line
+	if (timeGiven && !samplesGiven)
+	{
+		job.samples = 0;
+	}
+
+	return true;
+}
+
+void RenderJobReader::ParseProperty(HeadlessSettings& job, const std::string& keyword, std::istringstream& args) const
+{
+	const auto camera = [&]() -> CameraDescription&
+	{
+		if (!job.camera)
+		{
+			job.camera = CameraDescription();
+		}
+		return *job.camera;
+	};
+
+	if (keyword == "size")
+	{
+		job.width = Read<uint32_t>(args, "a width");
+		job.height = Read<uint32_t>(args, "a height");
+		if (job.width == 0 || job.height == 0)
+		{
+			Fail("the image size must not be empty");
+		}
+	}
+	else if (keyword == "spp") job.samples = Read<uint32_t>(args, "a sample count");
+	else if (keyword == "time") job.timeBudget = Read<double>(args, "seconds");
+	else if (keyword == "ray_query") job.rayQuery = true;
+	else if (keyword == "visibility_buffer") job.visibilityBuffer = true;
+	else if (keyword == "subgroup_traversal") job.subgroupTraversal = true;
+	else if (keyword == "half_shading") job.halfShading = true;
+	else if (keyword == "tracer")
+	{
+		const std::string tracer = Read<std::string>(args, "a name");
+		if (tracer == "megakernel") job.mode = TracerMode::Megakernel;
+		else if (tracer == "wavefront") job.mode = TracerMode::Wavefront;
+		else Fail("unknown tracer '" + tracer + "'");
+	}
+	else if (keyword == "preset")
+	{
+		const std::string preset = Read<std::string>(args, "a name");
+		if (preset == "reference") job.preset = TracerPreset::Reference;
+		else if (preset == "preview") job.preset = TracerPreset::Preview;
+		else if (preset == "diffuse") job.preset = TracerPreset::DiffuseOnly;
+		else Fail("unknown preset '" + preset + "'");
+	}
+	else if (keyword == "position") camera().position = ReadVec3(args);
+	else if (keyword == "forward") camera().forward = ReadVec3(args);
+	else if (keyword == "fstop") camera().fStop = Read<float>(args, "a number");
+	else if (keyword == "focus_distance") camera().focusDist = Read<float>(args, "a number");
+	else if (keyword == "focal_length") camera().focalLength = Read<float>(args, "a number");
+	else if (keyword == "sensor_width") camera().sensorWidth = Read<float>(args, "a number");
+	else Fail("unknown job property '" + keyword + "'");
+
+	std::string trailing;
+	if (args >> trailing)
+	{
+		Fail("unexpected '" + trailing + "' after '" + keyword + "'");
+	}
+}
+
+void RenderJobReader::ReadJob(std::istringstream& args)
+{
+	pendingOutput_ = Read<std::string>(args, "an output file");
+	pending_ = true;
+
+	std::string trailing;
+	if (args >> trailing)
+	{
+		Fail("unexpected '" + trailing + "' after 'job'");
+	}
+}
+
+glm::vec3 RenderJobReader::ReadVec3(std::istringstream& args) const
+{
+	const float x = Read<float>(args, "a number");
+	const float y = Read<float>(args, "a number");
+	const float z = Read<float>(args, "a number");
+	return { x, y, z };
+}
+
+bool RenderJobReader::ReadLine(std::string& keyword, std::istringstream& args)
+{
+	std::string line;
+	while (std::getline(input_, line))
+	{
+		++lineNumber_;
+		line = line.substr(0, line.find('#'));
+
+		args.clear();
+		args.str(line);
+		if (args >> keyword)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void RenderJobReader::Fail(const std::string& message) const
+{
+	throw std::runtime_error(name_ + ":" + std::to_string(lineNumber_) + ": " + message);
+}
+
+}
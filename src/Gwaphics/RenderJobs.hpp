@@ -0,0 +1,60 @@
+#pragma once
+
+#include "HeadlessRenderer.hpp"
+
+#include <istream>
+#include <sstream>
+#include <string>
+
+namespace Vulkan
+{
+	// Reads render jobs one at a time, so a pipe can feed them while earlier ones render. The format is line
+	// based like the .scene files, '#' starts a comment:
+	//
+	//   job <output>                        followed by any of: size <width> <height>, spp <n>, time <seconds>,
+	//                                       tracer megakernel|wavefront, preset reference|preview|diffuse, ray_query,
+	//                                       visibility_buffer, subgroup_traversal, half_shading and the camera properties of a .scene file
+	//
+	// A job ends at the next job or at the end of the input. Whatever it leaves out comes from the defaults,
+	// a camera property changes the defaults' camera.
+	class RenderJobReader final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(RenderJobReader)
+
+		RenderJobReader(std::istream& input, const std::string& name, const HeadlessSettings& defaults);
+		~RenderJobReader() = default;
+
+		// False once the input is exhausted.
+		bool Next(HeadlessSettings& job);
+
+	private:
+
+		void ParseProperty(HeadlessSettings& job, const std::string& keyword, std::istringstream& args) const;
+		void ReadJob(std::istringstream& args);
+		bool ReadLine(std::string& keyword, std::istringstream& args);
+		glm::vec3 ReadVec3(std::istringstream& args) const;
+
+		template <class T>
+		T Read(std::istringstream& args, const char* expected) const
+		{
+			T value;
+			if (!(args >> value))
+			{
+				Fail(std::string("expected ") + expected);
+			}
+			return value;
+		}
+
+		[[noreturn]] void Fail(const std::string& message) const;
+
+		std::istream& input_;
+		const std::string name_;
+		const HeadlessSettings defaults_;
+		unsigned lineNumber_ = 0;
+		std::string pendingOutput_; // of the job line that ended the previous job
+		bool pending_ = false;
+	};
+
+}
@@ -1,8 +1,11 @@
 #include "UserInterface.hpp"
+#include "Gwaphics/PathTracer/SceneEditor.hpp"
+#include "Gwaphics/Pipelines/ComputeTracer.hpp"
 #include "Gwaphics/Vulkan/DescriptorPool.hpp"
 #include "Gwaphics/Vulkan/Device.hpp"
 #include "Gwaphics/Vulkan/FrameBuffer.hpp"
 #include "Gwaphics/Vulkan/Instance.hpp"
+#include "Gwaphics/Vulkan/PipelineCache.hpp"
 #include "Gwaphics/Vulkan/RenderPass.hpp"
 #include "Gwaphics/Vulkan/SingleTimeCommands.hpp"
 #include "Gwaphics/Vulkan/Surface.hpp"
@@ -35,7 +38,8 @@ UserInterface::UserInterface(
 	Vulkan::CommandPool& commandPool, 
 	const Vulkan::SwapChain& swapChain, 
 	const Vulkan::DepthBuffer& depthBuffer, 
-	const Vulkan::RenderPass& renderPass)
+	const Vulkan::RenderPass& renderPass,
+	const Vulkan::PipelineCache& pipelineCache)
 {
 	const auto& device = swapChain.Device();
 	const auto& window = device.Surface().Instance().Window();
@@ -74,7 +78,7 @@ UserInterface::UserInterface(
 	vulkanInit.Device = device.Handle();
 	vulkanInit.QueueFamily = device.GraphicsFamilyIndex();
 	vulkanInit.Queue = device.GraphicsQueue();
-	vulkanInit.PipelineCache = nullptr;
+	vulkanInit.PipelineCache = pipelineCache.Handle();
 	vulkanInit.DescriptorPool = descriptorPool_->Handle();
 	vulkanInit.MinImageCount = swapChain.MinImageCount();
 	vulkanInit.ImageCount = static_cast<uint32_t>(swapChain.Images().size());
@@ -277,6 +281,61 @@ void UserInterface::DrawOverlay(const Statistics& stats, UserSettings& settings)
 		if (ImGui::CollapsingHeader("Statistics", ImGuiTreeNodeFlags_DefaultOpen))
 		{
 			ImGui::Text("Average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
+			ImGui::Text("%.1f Msamples/s", static_cast<float>(stats.samplesPerFrame) * io.Framerate / 1e6f);
+			if (stats.traceTime > 0.0)
+			{
+				ImGui::Text("GPU trace: %.2f ms/frame (%u of %u tiles)", stats.traceTime, stats.tiles, stats.tileCount);
+				ImGui::Text("%.1f Mrays/s while tracing", static_cast<double>(stats.rays) / stats.traceTime / 1e3);
+			}
+			if (stats.simdUtilisation > 0.0f)
+			{
+				ImGui::Text("SIMD utilisation: %.1f%%", stats.simdUtilisation * 100.0f);
+			}
+			ImGui::Text("BVH: %s, %u nodes (built in %.2f ms)", stats.bvhFinal ? "SAH" : "LBVH preview", stats.bvhNodes, stats.bvhBuildTime);
+			if (!stats.gpuPasses.empty() && ImGui::TreeNodeEx("GPU Passes", ImGuiTreeNodeFlags_DefaultOpen))
+			{
+				for (const auto& pass : stats.gpuPasses)
+				{
+					if (pass.invocations != 0)
+					{
+						ImGui::Text("%s: %.3f ms (%llu invocations)", pass.name.c_str(), pass.time, static_cast<unsigned long long>(pass.invocations));
+					}
+					else
+					{
+						ImGui::Text("%s: %.3f ms", pass.name.c_str(), pass.time);
+					}
+				}
+				ImGui::Checkbox("Log to CSV", &settings.LogGpuTimings);
+				ImGui::TreePop();
+			}
+			if (ImGui::TreeNode("Job System", "Job System (%zu workers)", stats.workers.size()))
+			{
+				for (size_t i = 0; i != stats.workers.size(); ++i)
+				{
+					const auto& worker = stats.workers[i];
+					const std::string label = std::format("Worker {}: {:.0f}% ({} jobs, {} stolen)", i, worker.utilisation * 100.0f, worker.jobs, worker.steals);
+					ImGui::ProgressBar(worker.utilisation, ImVec2(-1.0f, 0.0f), label.c_str());
+				}
+				ImGui::TreePop();
+			}
+			if (ImGui::TreeNode("Device Memory"))
+			{
+				const double mb = 1024.0 * 1024.0;
+				for (size_t i = 0; i != stats.memoryHeaps.size(); ++i)
+				{
+					const auto& heap = stats.memoryHeaps[i];
+					if (heap.blocks == 0 && heap.dedicatedAllocations == 0)
+					{
+						continue;
+					}
+
+					const std::string label = std::format("Heap {} ({}): {:.0f} of {:.0f} MB", i, heap.deviceLocal ? "device" : "host", heap.usage / mb, heap.budget / mb);
+					ImGui::ProgressBar(static_cast<float>(static_cast<double>(heap.usage) / static_cast<double>(heap.budget)), ImVec2(-1.0f, 0.0f), label.c_str());
+					ImGui::Text("%u blocks: %.1f of %.1f MB in %u allocations", heap.blocks, heap.usedBytes / mb, heap.blockBytes / mb, heap.allocations);
+					ImGui::Text("%u dedicated: %.1f MB", heap.dedicatedAllocations, heap.dedicatedBytes / mb);
+				}
+				ImGui::TreePop();
+			}
 
 		}
 		ImGui::Spacing();
@@ -286,14 +345,126 @@ void UserInterface::DrawOverlay(const Statistics& stats, UserSettings& settings)
 		{
 			ImGui::SliderInt("Width", settings.ImageWidth, 100, 3840);
 			ImGui::SliderInt("Height", settings.ImageHeight, 100, 2160);
+			ImGui::Combo("Tracer", &settings.Tracer, "Megakernel\0Wavefront\0Persistent threads\0");
+			ImGui::Combo("Variant", &settings.Variant, "Reference\0Preview\0Diffuse only\0");
+			if (settings.Tracer == static_cast<int>(Vulkan::TracerMode::Wavefront))
+			{
+				ImGui::Checkbox("Sort hits by material", &settings.SortHits);
+			}
+			if (settings.Tracer == static_cast<int>(Vulkan::TracerMode::Megakernel) && stats.rayQuerySupported)
+			{
+				int traversal = settings.RayQuery ? 1 : 0;
+				ImGui::Combo("Traversal", &traversal, "Software BVH\0Ray query\0");
+				settings.RayQuery = traversal == 1;
+			}
+			if (settings.Tracer == static_cast<int>(Vulkan::TracerMode::Megakernel) && stats.visibilitySupported)
+			{
+				ImGui::Checkbox("Rasterized primary hits", &settings.VisibilityBuffer);
+			}
+			if (settings.Tracer == static_cast<int>(Vulkan::TracerMode::Megakernel) && stats.subgroupTraversalSupported && !settings.RayQuery)
+			{
+				ImGui::Checkbox("Subgroup traversal", &settings.SubgroupTraversal);
+			}
+			if (settings.Tracer == static_cast<int>(Vulkan::TracerMode::Megakernel) && stats.halfShadingSupported)
+			{
+				ImGui::Checkbox("Half float shading", &settings.HalfShading);
+			}
+			ImGui::SliderInt("Samples per dispatch", &settings.SamplesPerDispatch, 1, 64);
+			ImGui::Checkbox("Tiled dispatch", &settings.TiledDispatch);
+			if (settings.TiledDispatch)
+			{
+				ImGui::SliderFloat("Frame budget (ms)", &settings.FrameBudget, 1.0f, 50.0f);
+			}
+			if (ImGui::Button("Tune workgroups"))
+			{
+				settings.TuneWorkgroups = true;
+			}
+			ImGui::SameLine();
+			ImGui::Text("Workgroup: %s", stats.workgroup != nullptr ? stats.workgroup : "16x16 (untuned)");
+			for (const auto& candidate : stats.workgroups)
+			{
+				if (candidate.time > 0.0)
+				{
+					ImGui::BulletText("%s: %.3f ms", candidate.name, candidate.time);
+				}
+			}
+			if (stats.rayQuerySupported || stats.subgroupTraversalSupported)
+			{
+				if (ImGui::Button("Benchmark traversal"))
+				{
+					settings.BenchmarkTraversal = true;
+				}
+				for (const auto& traversal : stats.traversalTimes)
+				{
+					ImGui::BulletText("%s: %.3f ms primary, %.3f ms bounces", traversal.name, traversal.primary, traversal.bounces);
+				}
+			}
 		}
 		if (ImGui::CollapsingHeader("Post Processing"))
 		{
 			ImGui::SliderFloat("Vignette", settings.Vignette, 0.001f, 0.3f);
 		}
+		if (settings.SceneEditor != nullptr && ImGui::CollapsingHeader("Scene"))
+		{
+			DrawSceneEditor(*settings.SceneEditor);
+		}
 		
 	}
 	ImGui::End();
 
 	ImGui::End();
 }
+
+void UserInterface::DrawSceneEditor(Vulkan::SceneEditor& editor)
+{
+	auto& scene = editor.View();
+
+	if (ImGui::TreeNode("Materials"))
+	{
+		for (uint32_t i = 0; i != scene.materials.size(); ++i)
+		{
+			auto& material = scene.materials[i];
+			ImGui::PushID(static_cast<int>(i));
+			if (ImGui::TreeNode(scene.materialNames[i].c_str()))
+			{
+				bool changed = false;
+				changed |= ImGui::ColorEdit3("Albedo", &material.albedo.x);
+				changed |= ImGui::DragFloat("Emission", &material.albedo.w, 0.05f, 0.0f, 100.0f);
+				changed |= ImGui::SliderFloat("Roughness", &material.roughness, 0.0f, 1.0f);
+				changed |= ImGui::SliderFloat("Metalness", &material.metalness, 0.0f, 1.0f);
+				changed |= ImGui::SliderFloat("Transmission", &material.transmission, 0.0f, 1.0f);
+				changed |= ImGui::SliderFloat("IOR", &material.ior, 1.0f, 3.0f);
+				if (changed)
+				{
+					editor.UpdateMaterial(i);
+				}
+				ImGui::TreePop();
+			}
+			ImGui::PopID();
+		}
+		ImGui::TreePop();
+	}
+
+	if (ImGui::TreeNode("Instances"))
+	{
+		for (uint32_t i = 0; i != scene.instances.size(); ++i)
+		{
+			auto& instance = scene.instances[i];
+			ImGui::PushID(static_cast<int>(i));
+			if (ImGui::TreeNode("Instance", "%s (%s)", scene.meshNames[instance.mesh].c_str(), scene.materialNames[instance.material].c_str()))
+			{
+				bool changed = false;
+				changed |= ImGui::DragFloat3("Translation", &instance.translation.x, 0.01f);
+				changed |= ImGui::DragFloat3("Rotation", &instance.rotation.x, 0.5f, -180.0f, 180.0f);
+				changed |= ImGui::DragFloat("Scale", &instance.scale, 0.01f, 0.01f, 100.0f);
+				if (changed)
+				{
+					editor.UpdateInstance(i);
+				}
+				ImGui::TreePop();
+			}
+			ImGui::PopID();
+		}
+		ImGui::TreePop();
+	}
+}
@@ -1,6 +1,11 @@
 #pragma once
 #include "Gwaphics/Vulkan/Vulkan.hpp"
+#include "Gwaphics/Utilities/JobSystem.hpp"
+#include "Gwaphics/Vulkan/GpuProfiler.hpp"
+#include "Gwaphics/Vulkan/MemoryAllocator.hpp"
+#include "Gwaphics/Pipelines/WorkgroupTuner.hpp"
 #include <memory>
+#include <vector>
 
 namespace Vulkan
 {
@@ -8,18 +13,34 @@ namespace Vulkan
 	class DepthBuffer;
 	class DescriptorPool;
 	class FrameBuffer;
+	class PipelineCache;
 	class RenderPass;
+	class SceneEditor;
 	class SwapChain;
 }
 
 struct UserSettings final
 {
 	// Scene
+	Vulkan::SceneEditor* SceneEditor{};
 	int* ImageWidth;
 	int* ImageHeight;
 	float* Vignette;
 	// Renderer
 	bool AccumulateRays;
+	int Tracer; // a Vulkan::TracerMode
+	int Variant; // a Vulkan::TracerPreset
+	bool SortHits; // wavefront only
+	bool RayQuery; // megakernel only, trace with VK_KHR_ray_query instead of the software BVH
+	bool VisibilityBuffer; // megakernel only, rasterize the first hits
+	bool SubgroupTraversal; // megakernel only, subgroup cooperative software BVH traversal
+	bool HalfShading; // megakernel only, half float BSDF colour terms
+	int SamplesPerDispatch;
+	bool TiledDispatch;
+	float FrameBudget; // ms of GPU time per frame in tiled dispatch
+	bool LogGpuTimings;
+	bool TuneWorkgroups; // set to request a workgroup tuning run, cleared once it has run
+	bool BenchmarkTraversal; // set to time the megakernel with every traversal, cleared once it has run
 
 	// Camera
 
@@ -32,9 +53,50 @@ struct Statistics final
 	{
 		initView = false;
 		viewImage = nullptr;
+		bvhFinal = false;
+		bvhNodes = 0;
+		bvhBuildTime = 0.0;
+		simdUtilisation = 0.0f;
+		traceTime = 0.0;
+		tiles = 0;
+		tileCount = 0;
+		samplesPerFrame = 0;
+		rays = 0;
+		workgroup = nullptr;
+		rayQuerySupported = false;
+		visibilitySupported = false;
+		subgroupTraversalSupported = false;
+		halfShadingSupported = false;
 	}
 	bool initView;
 	VkDescriptorSet* viewImage;
+	bool bvhFinal;
+	uint32_t bvhNodes;
+	double bvhBuildTime;
+	float simdUtilisation;
+	double traceTime;
+	uint32_t tiles;
+	uint32_t tileCount;
+	uint64_t samplesPerFrame;
+	uint64_t rays;
+	std::vector<Vulkan::GpuProfiler::Region> gpuPasses;
+	std::vector<Vulkan::WorkgroupTuner::Candidate> workgroups;
+	const char* workgroup; // the tuned megakernel workgroup, nullptr before tuning
+	bool rayQuerySupported;
+	bool visibilitySupported;
+	bool subgroupTraversalSupported;
+	bool halfShadingSupported;
+	// Of the last traversal benchmark, empty before it has run. ms per megakernel dispatch of the coherent
+	// primary rays alone and of the incoherent bounces after them.
+	struct TraversalTime
+	{
+		const char* name;
+		double primary;
+		double bounces;
+	};
+	std::vector<TraversalTime> traversalTimes;
+	std::vector<Utilities::WorkerStatistics> workers;
+	std::vector<Vulkan::MemoryAllocator::HeapStatistics> memoryHeaps;
 };
 
 class UserInterface final
@@ -47,7 +109,8 @@ public:
 		Vulkan::CommandPool& commandPool, 
 		const Vulkan::SwapChain& swapChain, 
 		const Vulkan::DepthBuffer& depthBuffer,
-		const Vulkan::RenderPass& renderPass);
+		const Vulkan::RenderPass& renderPass,
+		const Vulkan::PipelineCache& pipelineCache);
 	~UserInterface();
 
 	VkExtent2D DrawUI(const Statistics& stats, UserSettings& settings);
@@ -59,6 +122,7 @@ private:
 
 	void DrawSettings();
 	void DrawOverlay(const Statistics& stats, UserSettings& settings);
+	void DrawSceneEditor(Vulkan::SceneEditor& editor);
 
 	std::unique_ptr<Vulkan::DescriptorPool> descriptorPool_;
 	VkExtent2D viewportExtent;
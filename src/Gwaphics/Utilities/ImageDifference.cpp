@@ -0,0 +1,60 @@
+#include "ImageDifference.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace Utilities
+{
+	ImageDifference ImageDifference::Of(const std::vector<float>& a, const std::vector<float>& b)
+	{
+		if (a.size() != b.size() || a.size() % 4 != 0)
+		{
+			throw std::invalid_argument("images of different sizes");
+		}
+
+		double reference = 0.0;
+		double squared = 0.0;
+		double bias = 0.0;
+		ImageDifference difference;
+		for (size_t i = 0; i != a.size(); ++i)
+		{
+			if (i % 4 == 3)
+			{
+				continue;
+			}
+
+			const double delta = static_cast<double>(b[i]) - a[i];
+			reference += a[i];
+			squared += delta * delta;
+			bias += delta;
+			difference.maxDifference = std::max(difference.maxDifference, std::abs(delta));
+		}
+
+		const double channels = static_cast<double>(a.size() / 4 * 3);
+		const double mean = reference / channels;
+		if (channels != 0.0 && mean != 0.0)
+		{
+			difference.relativeRmse = std::sqrt(squared / channels) / mean;
+			difference.relativeBias = bias / channels / mean;
+		}
+
+		return difference;
+	}
+
+	std::vector<float> ImageDifference::Image(const std::vector<float>& a, const std::vector<float>& b)
+	{
+		if (a.size() != b.size())
+		{
+			throw std::invalid_argument("images of different sizes");
+		}
+
+		std::vector<float> image(a.size());
+		for (size_t i = 0; i != a.size(); ++i)
+		{
+			image[i] = i % 4 == 3 ? 1.0f : std::abs(b[i] - a[i]);
+		}
+
+		return image;
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+
+namespace Utilities
+{
+	// How far apart two renders of the same view are, over the RGB of linear RGBA pixels, rows from the top
+	// like ImageWriter takes them. Both are relative to the mean of the first image, the reference.
+	struct ImageDifference
+	{
+		double relativeRmse{};
+		// mean of b - a, the part of the difference that does not average out with more samples
+		double relativeBias{};
+		double maxDifference{}; // absolute, of a single channel
+
+		static ImageDifference Of(const std::vector<float>& a, const std::vector<float>& b);
+		// |a - b| per pixel with alpha 1, to write out with ImageWriter.
+		static std::vector<float> Image(const std::vector<float>& a, const std::vector<float>& b);
+	};
+}
@@ -0,0 +1,269 @@
+#include "ImageWriter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace Utilities
+{
+	namespace
+	{
+		std::string Extension(const std::string& path)
+		{
+			const auto dot = path.find_last_of('.');
+			std::string extension = dot == std::string::npos ? std::string() : path.substr(dot);
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](const char c) { return static_cast<char>(std::tolower(c)); });
+			return extension;
+		}
+
+		void PutBigEndian(std::vector<uint8_t>& out, const uint32_t value)
+		{
+			out.insert(out.end(), { uint8_t(value >> 24), uint8_t(value >> 16), uint8_t(value >> 8), uint8_t(value) });
+		}
+
+		template <class T>
+		void PutLittleEndian(std::vector<uint8_t>& out, const T value)
+		{
+			static_assert(sizeof(T) == 4 || sizeof(T) == 8, "32 or 64 bit values");
+			uint64_t bits = 0;
+			std::memcpy(&bits, &value, sizeof(T));
+			for (size_t i = 0; i != sizeof(T); ++i)
+			{
+				out.push_back(uint8_t(bits >> (8 * i)));
+			}
+		}
+
+		void PutString(std::vector<uint8_t>& out, const char* const text)
+		{
+			out.insert(out.end(), text, text + std::strlen(text) + 1);
+		}
+
+		uint32_t Crc32(const uint8_t* data, const size_t size)
+		{
+			static const auto table = []
+			{
+				std::array<uint32_t, 256> entries{};
+				for (uint32_t n = 0; n != 256; ++n)
+				{
+					uint32_t c = n;
+					for (int k = 0; k != 8; ++k)
+					{
+						c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+					}
+					entries[n] = c;
+				}
+				return entries;
+			}();
+
+			uint32_t crc = 0xFFFFFFFFu;
+			for (size_t i = 0; i != size; ++i)
+			{
+				crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+			}
+			return crc ^ 0xFFFFFFFFu;
+		}
+
+		void PutPngChunk(std::vector<uint8_t>& out, const char* const type, const std::vector<uint8_t>& data)
+		{
+			PutBigEndian(out, static_cast<uint32_t>(data.size()));
+			const size_t start = out.size();
+			out.insert(out.end(), type, type + 4);
+			out.insert(out.end(), data.begin(), data.end());
+			PutBigEndian(out, Crc32(out.data() + start, out.size() - start));
+		}
+
+		uint8_t ToSrgb8(const float linear)
+		{
+			const float c = std::clamp(linear, 0.0f, 1.0f);
+			const float srgb = c <= 0.0031308f ? 12.92f * c : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+			return static_cast<uint8_t>(std::lround(srgb * 255.0f));
+		}
+	}
+
+	void ImageWriter::Write(const std::string& path, const uint32_t width, const uint32_t height, const std::vector<float>& pixels)
+	{
+		if (pixels.size() < size_t(width) * height * 4)
+		{
+			throw std::runtime_error("image '" + path + "' has fewer pixels than its size");
+		}
+
+		std::vector<uint8_t> file;
+		const std::string extension = Extension(path);
+		if (extension == ".png")
+		{
+			WritePng(file, width, height, pixels);
+		}
+		else if (extension == ".hdr")
+		{
+			WriteHdr(file, width, height, pixels);
+		}
+		else if (extension == ".exr")
+		{
+			WriteExr(file, width, height, pixels);
+		}
+		else
+		{
+			throw std::runtime_error("cannot write '" + path + "', use .png, .hdr or .exr");
+		}
+
+		std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+		if (!stream.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size())))
+		{
+			throw std::runtime_error("failed to write '" + path + "'");
+		}
+	}
+
+	bool ImageWriter::IsSupported(const std::string& path)
+	{
+		const std::string extension = Extension(path);
+		return extension == ".png" || extension == ".hdr" || extension == ".exr";
+	}
+
+	// 8 bit RGB. The image data is zlib wrapped but stored, not compressed, which keeps this short at the
+	// cost of file size.
+	void ImageWriter::WritePng(std::vector<uint8_t>& file, const uint32_t width, const uint32_t height, const std::vector<float>& pixels)
+	{
+		const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		file.insert(file.end(), std::begin(signature), std::end(signature));
+
+		std::vector<uint8_t> header;
+		PutBigEndian(header, width);
+		PutBigEndian(header, height);
+		header.insert(header.end(), { 8, 2, 0, 0, 0 }); // bit depth, truecolour, deflate, adaptive filters, no interlace
+		PutPngChunk(file, "IHDR", header);
+
+		// Each row starts with its filter type, none.
+		std::vector<uint8_t> raw;
+		raw.reserve(size_t(height) * (1 + 3 * size_t(width)));
+		for (uint32_t y = 0; y != height; ++y)
+		{
+			raw.push_back(0);
+			for (uint32_t x = 0; x != width; ++x)
+			{
+				const float* const pixel = &pixels[4 * (size_t(y) * width + x)];
+				raw.insert(raw.end(), { ToSrgb8(pixel[0]), ToSrgb8(pixel[1]), ToSrgb8(pixel[2]) });
+			}
+		}
+
+		std::vector<uint8_t> zlib = { 0x78, 0x01 };
+		const size_t maxBlock = 65535;
+		for (size_t offset = 0; offset == 0 || offset < raw.size(); offset += maxBlock)
+		{
+			const size_t size = std::min(maxBlock, raw.size() - offset);
+			const bool last = offset + size == raw.size();
+			zlib.insert(zlib.end(), { uint8_t(last ? 1 : 0), uint8_t(size), uint8_t(size >> 8), uint8_t(~size), uint8_t(~size >> 8) });
+			zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+		}
+
+		uint32_t a = 1, b = 0;
+		for (const uint8_t byte : raw)
+		{
+			a = (a + byte) % 65521;
+			b = (b + a) % 65521;
+		}
+		PutBigEndian(zlib, (b << 16) | a);
+
+		PutPngChunk(file, "IDAT", zlib);
+		PutPngChunk(file, "IEND", {});
+	}
+
+	// Flat RGBE scanlines, which every reader accepts next to the run length encoded ones.
+	void ImageWriter::WriteHdr(std::vector<uint8_t>& file, const uint32_t width, const uint32_t height, const std::vector<float>& pixels)
+	{
+		const std::string header = "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " + std::to_string(height) + " +X " + std::to_string(width) + "\n";
+		file.insert(file.end(), header.begin(), header.end());
+
+		for (size_t i = 0; i != size_t(width) * height; ++i)
+		{
+			const float* const pixel = &pixels[4 * i];
+			const float maximum = std::max({ pixel[0], pixel[1], pixel[2] });
+			if (!(maximum > 1e-32f))
+			{
+				file.insert(file.end(), { 0, 0, 0, 0 });
+				continue;
+			}
+
+			int exponent = 0;
+			const float scale = std::frexp(maximum, &exponent) * 256.0f / maximum;
+			file.insert(file.end(), {
+				uint8_t(std::max(pixel[0], 0.0f) * scale),
+				uint8_t(std::max(pixel[1], 0.0f) * scale),
+				uint8_t(std::max(pixel[2], 0.0f) * scale),
+				uint8_t(exponent + 128) });
+		}
+	}
+
+	// Single part scanline file with B, G and R 32 bit float channels, one uncompressed line per block.
+	void ImageWriter::WriteExr(std::vector<uint8_t>& file, const uint32_t width, const uint32_t height, const std::vector<float>& pixels)
+	{
+		const auto putAttribute = [&file](const char* const name, const char* const type, const std::vector<uint8_t>& value)
+		{
+			PutString(file, name);
+			PutString(file, type);
+			PutLittleEndian(file, static_cast<int32_t>(value.size()));
+			file.insert(file.end(), value.begin(), value.end());
+		};
+
+		PutLittleEndian(file, 20000630); // magic number
+		PutLittleEndian(file, 2); // version 2, single part scanline
+
+		// Channels are listed in alphabetical order, and stored in that order in every line.
+		std::vector<uint8_t> channels;
+		for (const char* const channel : { "B", "G", "R" })
+		{
+			PutString(channels, channel);
+			PutLittleEndian(channels, 2); // FLOAT
+			channels.insert(channels.end(), { 0, 0, 0, 0 }); // pLinear and reserved
+			PutLittleEndian(channels, 1); // x sampling
+			PutLittleEndian(channels, 1); // y sampling
+		}
+		channels.push_back(0);
+
+		std::vector<uint8_t> window;
+		for (const int32_t value : { 0, 0, static_cast<int32_t>(width) - 1, static_cast<int32_t>(height) - 1 })
+		{
+			PutLittleEndian(window, value);
+		}
+
+		std::vector<uint8_t> one;
+		PutLittleEndian(one, 1.0f);
+		std::vector<uint8_t> center;
+		PutLittleEndian(center, 0.0f);
+		PutLittleEndian(center, 0.0f);
+
+		putAttribute("channels", "chlist", channels);
+		putAttribute("compression", "compression", { 0 });
+		putAttribute("dataWindow", "box2i", window);
+		putAttribute("displayWindow", "box2i", window);
+		putAttribute("lineOrder", "lineOrder", { 0 });
+		putAttribute("pixelAspectRatio", "float", one);
+		putAttribute("screenWindowCenter", "v2f", center);
+		putAttribute("screenWindowWidth", "float", one);
+		file.push_back(0);
+
+		// Offset table, then the lines: y, byte count, and each channel's values for the line.
+		const uint64_t lineSize = 3 * sizeof(float) * uint64_t(width);
+		const uint64_t firstLine = file.size() + sizeof(uint64_t) * uint64_t(height);
+		for (uint32_t y = 0; y != height; ++y)
+		{
+			PutLittleEndian(file, firstLine + y * (8 + lineSize));
+		}
+
+		for (uint32_t y = 0; y != height; ++y)
+		{
+			PutLittleEndian(file, static_cast<int32_t>(y));
+			PutLittleEndian(file, static_cast<int32_t>(lineSize));
+			for (const int channel : { 2, 1, 0 })
+			{
+				for (uint32_t x = 0; x != width; ++x)
+				{
+					PutLittleEndian(file, pixels[4 * (size_t(y) * width + x) + channel]);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Utilities
+{
+	// Writes rendered images without any image library. The format follows the file extension:
+	// .png is 8 bit sRGB clamped to [0, 1], .hdr Radiance RGBE and .exr uncompressed 32 bit float, both linear.
+	class ImageWriter final
+	{
+	public:
+
+		// pixels holds linear RGBA floats, rows from the top. Alpha is not written.
+		static void Write(const std::string& path, uint32_t width, uint32_t height, const std::vector<float>& pixels);
+
+		static bool IsSupported(const std::string& path);
+
+	private:
+
+		static void WritePng(std::vector<uint8_t>& file, uint32_t width, uint32_t height, const std::vector<float>& pixels);
+		static void WriteHdr(std::vector<uint8_t>& file, uint32_t width, uint32_t height, const std::vector<float>& pixels);
+		static void WriteExr(std::vector<uint8_t>& file, uint32_t width, uint32_t height, const std::vector<float>& pixels);
+	};
+}
@@ -0,0 +1,196 @@
+#include "JobSystem.hpp"
+
+namespace Utilities {
+
+namespace
+{
+	// Identifies the pool and worker the current thread belongs to, so nested jobs go to the local deque.
+	thread_local const JobSystem* tlsJobSystem = nullptr;
+	thread_local int tlsWorkerIndex = -1;
+}
+
+JobSystem::JobSystem(const unsigned workerCount) :
+	sampleTime_(std::chrono::steady_clock::now())
+{
+	for (unsigned i = 0; i != workerCount; ++i)
+	{
+		workers_.push_back(std::make_unique<Worker>());
+	}
+
+	for (unsigned i = 0; i != workerCount; ++i)
+	{
+		workers_[i]->thread = std::thread([this, i]() { WorkerLoop(static_cast<int>(i)); });
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex_);
+		quit_ = true;
+	}
+
+	wake_.notify_all();
+
+	for (auto& worker : workers_)
+	{
+		worker->thread.join();
+	}
+}
+
+JobSystem& JobSystem::Get()
+{
+	static JobSystem jobSystem(std::max(1u, std::thread::hardware_concurrency()) - 1);
+	return jobSystem;
+}
+
+void JobSystem::Run(Job job, JobCounter& counter)
+{
+	counter.pending_.fetch_add(1, std::memory_order_relaxed);
+
+	Worker& worker = tlsJobSystem == this ? *workers_[tlsWorkerIndex] : external_;
+	{
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.tasks.push_back(Task{ std::move(job), &counter });
+	}
+
+	queued_.fetch_add(1, std::memory_order_release);
+
+	// Taking the lock makes sure a worker about to sleep sees the new job.
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex_);
+	}
+
+	wake_.notify_one();
+}
+
+void JobSystem::Wait(const JobCounter& counter)
+{
+	const int self = tlsJobSystem == this ? tlsWorkerIndex : -1;
+
+	while (!counter.IsDone())
+	{
+		if (!TryRunOne(self))
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+std::vector<WorkerStatistics> JobSystem::Statistics()
+{
+	const auto now = std::chrono::steady_clock::now();
+	const auto window = std::chrono::duration_cast<std::chrono::nanoseconds>(now - sampleTime_).count();
+
+	// Sample over at least a quarter of a second, single frames are too noisy to read.
+	if (window >= 250'000'000)
+	{
+		for (auto& worker : workers_)
+		{
+			const uint64_t busy = worker->busyTime.load(std::memory_order_relaxed);
+			worker->utilisation = std::min(1.0f, static_cast<float>(busy - worker->sampledBusyTime) / static_cast<float>(window));
+			worker->sampledBusyTime = busy;
+		}
+
+		sampleTime_ = now;
+	}
+
+	std::vector<WorkerStatistics> statistics;
+	statistics.reserve(workers_.size());
+
+	for (const auto& worker : workers_)
+	{
+		statistics.push_back({ worker->utilisation, worker->jobCount.load(std::memory_order_relaxed), worker->stealCount.load(std::memory_order_relaxed) });
+	}
+
+	return statistics;
+}
+
+bool JobSystem::TryRunOne(const int self)
+{
+	Worker* const local = self >= 0 ? workers_[self].get() : nullptr;
+	Task task;
+
+	// Own work first (newest first, it is still warm in the cache), then the external queue, then steal the oldest job of another worker.
+	if ((local != nullptr && TryPop(*local, true, task)) || TryPop(external_, false, task))
+	{
+		Execute(task, local);
+		return true;
+	}
+
+	const int count = static_cast<int>(workers_.size());
+	for (int i = 1; i <= count; ++i)
+	{
+		const int victim = (std::max(self, 0) + i) % count;
+		if (victim != self && TryPop(*workers_[victim], false, task))
+		{
+			if (local != nullptr)
+			{
+				local->stealCount.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			Execute(task, local);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool JobSystem::TryPop(Worker& worker, const bool back, Task& task)
+{
+	std::lock_guard<std::mutex> lock(worker.mutex);
+
+	if (worker.tasks.empty())
+	{
+		return false;
+	}
+
+	if (back)
+	{
+		task = std::move(worker.tasks.back());
+		worker.tasks.pop_back();
+	}
+	else
+	{
+		task = std::move(worker.tasks.front());
+		worker.tasks.pop_front();
+	}
+
+	queued_.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+void JobSystem::Execute(Task& task, Worker* const worker)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	task.function();
+	task.counter->pending_.fetch_sub(1, std::memory_order_release);
+
+	if (worker != nullptr)
+	{
+		const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		worker->busyTime.fetch_add(static_cast<uint64_t>(elapsed), std::memory_order_relaxed);
+		worker->jobCount.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void JobSystem::WorkerLoop(const int index)
+{
+	tlsJobSystem = this;
+	tlsWorkerIndex = index;
+
+	while (!quit_)
+	{
+		if (TryRunOne(index))
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex_);
+		wake_.wait(lock, [this]() { return quit_ || queued_.load(std::memory_order_acquire) != 0; });
+	}
+}
+
+}
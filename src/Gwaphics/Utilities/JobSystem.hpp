@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Utilities
+{
+	// Number of jobs still outstanding. Jobs depending on others wait on the counter and help run queued work meanwhile.
+	class JobCounter final
+	{
+	public:
+
+		JobCounter() = default;
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator = (const JobCounter&) = delete;
+
+		bool IsDone() const { return pending_.load(std::memory_order_acquire) == 0; }
+
+	private:
+
+		friend class JobSystem;
+
+		std::atomic<uint32_t> pending_{};
+	};
+
+	struct WorkerStatistics
+	{
+		float utilisation; // fraction of wall time spent running jobs over the last sampling window
+		uint64_t jobs;
+		uint64_t steals;
+	};
+
+	// Work-stealing job system: each worker owns a deque it pushes to and pops from at the back, idle workers steal from the front of the others.
+	// Jobs must not throw, capture exceptions and rethrow them after waiting instead.
+	class JobSystem final
+	{
+	public:
+
+		using Job = std::function<void()>;
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem(JobSystem&&) = delete;
+		JobSystem& operator = (const JobSystem&) = delete;
+		JobSystem& operator = (JobSystem&&) = delete;
+
+		explicit JobSystem(unsigned workerCount);
+		~JobSystem();
+
+		// The engine-wide instance, with one worker per hardware thread besides the main thread.
+		static JobSystem& Get();
+
+		unsigned WorkerCount() const { return static_cast<unsigned>(workers_.size()); }
+
+		void Run(Job job, JobCounter& counter);
+		void Wait(const JobCounter& counter);
+
+		// Calls body(first, last) over chunks of [begin, end) of at least grainSize elements.
+		template <class Body>
+		void ParallelFor(size_t begin, size_t end, size_t grainSize, const Body& body);
+
+		// Maps each chunk with map(first, last) -> T and folds the partial results in order with reduce(T, T) -> T.
+		template <class T, class Map, class Reduce>
+		T ParallelReduce(size_t begin, size_t end, size_t grainSize, T identity, const Map& map, const Reduce& reduce);
+
+		std::vector<WorkerStatistics> Statistics();
+
+	private:
+
+		struct Task
+		{
+			Job function;
+			JobCounter* counter;
+		};
+
+		struct Worker
+		{
+			std::mutex mutex;
+			std::deque<Task> tasks;
+			std::thread thread;
+
+			std::atomic<uint64_t> busyTime{}; // ns
+			std::atomic<uint64_t> jobCount{};
+			std::atomic<uint64_t> stealCount{};
+			uint64_t sampledBusyTime{};
+			float utilisation{};
+		};
+
+		size_t ChunkSize(size_t count, size_t grainSize) const;
+		bool TryRunOne(int self);
+		bool TryPop(Worker& worker, bool back, Task& task);
+		void Execute(Task& task, Worker* worker);
+		void WorkerLoop(int index);
+
+		std::vector<std::unique_ptr<Worker>> workers_;
+		Worker external_; // jobs queued from threads outside the pool
+
+		std::mutex sleepMutex_;
+		std::condition_variable wake_;
+		std::atomic<uint32_t> queued_{};
+		std::atomic<bool> quit_{};
+
+		std::chrono::steady_clock::time_point sampleTime_;
+	};
+
+	inline size_t JobSystem::ChunkSize(const size_t count, const size_t grainSize) const
+	{
+		// No point in cutting the range much finer than what the workers and the calling thread can chew through.
+		const size_t maxChunks = 4 * (workers_.size() + 1);
+		return std::max(std::max<size_t>(grainSize, 1), (count + maxChunks - 1) / maxChunks);
+	}
+
+	template <class Body>
+	void JobSystem::ParallelFor(const size_t begin, const size_t end, const size_t grainSize, const Body& body)
+	{
+		if (end <= begin)
+		{
+			return;
+		}
+
+		const size_t chunk = ChunkSize(end - begin, grainSize);
+		JobCounter counter;
+
+		for (size_t first = begin + chunk; first < end; first += chunk)
+		{
+			const size_t last = std::min(first + chunk, end);
+			Run([&body, first, last]() { body(first, last); }, counter);
+		}
+
+		body(begin, std::min(begin + chunk, end));
+		Wait(counter);
+	}
+
+	template <class T, class Map, class Reduce>
+	T JobSystem::ParallelReduce(const size_t begin, const size_t end, const size_t grainSize, T identity, const Map& map, const Reduce& reduce)
+	{
+		if (end <= begin)
+		{
+			return identity;
+		}
+
+		const size_t chunk = ChunkSize(end - begin, grainSize);
+		std::vector<T> partials((end - begin + chunk - 1) / chunk, identity);
+
+		ParallelFor(begin, end, chunk, [&](const size_t first, const size_t last)
+		{
+			partials[(first - begin) / chunk] = map(first, last);
+		});
+
+		T result = identity;
+		for (const T& partial : partials)
+		{
+			result = reduce(result, partial);
+		}
+
+		return result;
+	}
+}
@@ -0,0 +1,49 @@
+#include "AccelerationStructure.hpp"
+#include "Buffer.hpp"
+#include "Device.hpp"
+#include "DeviceMemory.hpp"
+#include "DeviceProcedures.hpp"
+
+namespace Vulkan {
+
+AccelerationStructure::AccelerationStructure(const DeviceProcedures& deviceProcedures, const VkAccelerationStructureTypeKHR type, const VkDeviceSize size) :
+	deviceProcedures_(deviceProcedures),
+	device_(deviceProcedures.Device()),
+	type_(type)
+{
+	buffer_.reset(new Buffer(device_, size, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT));
+	memory_.reset(new DeviceMemory(buffer_->AllocateMemory(VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
+
+	VkAccelerationStructureCreateInfoKHR createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+	createInfo.buffer = buffer_->Handle();
+	createInfo.offset = 0;
+	createInfo.size = size;
+	createInfo.type = type;
+
+	Check(deviceProcedures.vkCreateAccelerationStructureKHR(device_.Handle(), &createInfo, nullptr, &accelerationStructure_),
+		"create acceleration structure");
+}
+
+AccelerationStructure::~AccelerationStructure()
+{
+	if (accelerationStructure_ != nullptr)
+	{
+		deviceProcedures_.vkDestroyAccelerationStructureKHR(device_.Handle(), accelerationStructure_, nullptr);
+		accelerationStructure_ = nullptr;
+	}
+
+	buffer_.reset();
+	memory_.reset();
+}
+
+VkDeviceAddress AccelerationStructure::GetDeviceAddress() const
+{
+	VkAccelerationStructureDeviceAddressInfoKHR addressInfo = {};
+	addressInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
+	addressInfo.accelerationStructure = Handle();
+
+	return deviceProcedures_.vkGetAccelerationStructureDeviceAddressKHR(device_.Handle(), &addressInfo);
+}
+
+}
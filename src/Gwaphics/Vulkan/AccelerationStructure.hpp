@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Vulkan.hpp"
+#include <memory>
+
+namespace Vulkan
+{
+	class Buffer;
+	class Device;
+	class DeviceMemory;
+	class DeviceProcedures;
+
+	// A bottom or top level acceleration structure and the device memory it lives in. Built by recording
+	// vkCmdBuildAccelerationStructuresKHR into it, see SceneAccelerationStructure.
+	class AccelerationStructure final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(AccelerationStructure)
+
+		AccelerationStructure(const DeviceProcedures& deviceProcedures, VkAccelerationStructureTypeKHR type, VkDeviceSize size);
+		~AccelerationStructure();
+
+		const class Device& Device() const { return device_; }
+		VkAccelerationStructureTypeKHR Type() const { return type_; }
+		VkDeviceAddress GetDeviceAddress() const;
+
+	private:
+
+		const DeviceProcedures& deviceProcedures_;
+		const class Device& device_;
+		const VkAccelerationStructureTypeKHR type_;
+
+		std::unique_ptr<Buffer> buffer_;
+		std::unique_ptr<DeviceMemory> memory_;
+
+		VULKAN_HANDLE(VkAccelerationStructureKHR, accelerationStructure_)
+	};
+
+}
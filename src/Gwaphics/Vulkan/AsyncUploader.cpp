@@ -0,0 +1,199 @@
+#include "AsyncUploader.hpp"
+#include "CommandBuffers.hpp"
+#include "CommandPool.hpp"
+#include "Device.hpp"
+#include "TimelineSemaphore.hpp"
+#include "UploadBatcher.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace Vulkan
+{
+	bool AsyncUploader::Supported(const class Device& device)
+	{
+		return device.HasTransferQueue();
+	}
+
+	AsyncUploader::AsyncUploader(const class Device& device) :
+		device_(device),
+		commandPool_(new CommandPool(device, device.TransferFamilyIndex(), false)),
+		semaphore_(new TimelineSemaphore(device, 0)),
+		thread_(&AsyncUploader::run, this)
+	{
+	}
+
+	AsyncUploader::~AsyncUploader()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+
+		wake_.notify_all();
+		thread_.join();
+
+		semaphore_.reset();
+		commandPool_.reset();
+	}
+
+	uint64_t AsyncUploader::Submit(UploadBatcher& batch)
+	{
+		Batch queued = { &batch, {}, ++submitted_ };
+
+		// Release and acquire name the same ranges, the batch sorts its copies once it records them.
+		for (const auto& copy : batch.Copies())
+		{
+			VkBufferMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcQueueFamilyIndex = device_.TransferFamilyIndex();
+			barrier.dstQueueFamilyIndex = device_.ComputeFamilyIndex();
+			barrier.buffer = copy.buffer;
+			barrier.offset = copy.region.dstOffset;
+			barrier.size = copy.region.size;
+			queued.barriers.push_back(barrier);
+		}
+
+		unacquired_.push_back(queued);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			queued_.push_back(std::move(queued));
+		}
+
+		wake_.notify_all();
+		return submitted_;
+	}
+
+	void AsyncUploader::Wait(const uint64_t value)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		wake_.wait(lock, [this, value]() { return completed_ >= value || error_; });
+
+		if (error_)
+		{
+			std::rethrow_exception(error_);
+		}
+	}
+
+	bool AsyncUploader::Done(const uint64_t value)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (error_)
+		{
+			std::rethrow_exception(error_);
+		}
+
+		return completed_ >= value;
+	}
+
+	void AsyncUploader::RecordAcquire(VkCommandBuffer commandBuffer, const uint64_t value)
+	{
+		std::vector<VkBufferMemoryBarrier> barriers;
+		for (const auto& batch : unacquired_)
+		{
+			if (batch.value <= value)
+			{
+				for (auto barrier : batch.barriers)
+				{
+					barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+					barriers.push_back(barrier);
+				}
+			}
+		}
+
+		unacquired_.erase(std::remove_if(unacquired_.begin(), unacquired_.end(), [value](const Batch& batch)
+		{
+			return batch.value <= value;
+		}), unacquired_.end());
+
+		if (barriers.empty())
+		{
+			return;
+		}
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+			0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+	}
+
+	void AsyncUploader::run()
+	{
+		for (;;)
+		{
+			Batch batch;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				wake_.wait(lock, [this]() { return stop_ || !queued_.empty(); });
+
+				// Stopping still finishes the batches handed over, their buffers would never be written otherwise.
+				if (queued_.empty())
+				{
+					return;
+				}
+
+				batch = std::move(queued_.front());
+				queued_.pop_front();
+			}
+
+			try
+			{
+				upload(batch);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				error_ = std::current_exception();
+				queued_.clear();
+				wake_.notify_all();
+				return;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				completed_ = batch.value;
+			}
+
+			wake_.notify_all();
+		}
+	}
+
+	void AsyncUploader::upload(Batch& batch)
+	{
+		CommandBuffers commandBuffers(*commandPool_, 1);
+		const VkCommandBuffer commandBuffer = commandBuffers.Begin(0);
+		batch.batch->Record(commandBuffer);
+
+		for (auto& barrier : batch.barriers)
+		{
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		}
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			0, nullptr, static_cast<uint32_t>(batch.barriers.size()), batch.barriers.data(), 0, nullptr);
+		commandBuffers.End(0);
+
+		VkSemaphore signalSemaphores[] = { semaphore_->Handle() };
+		const uint64_t signalValues[] = { batch.value };
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.signalSemaphoreValueCount = 1;
+		timelineInfo.pSignalSemaphoreValues = signalValues;
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = signalSemaphores;
+
+		// Only this thread submits to the transfer queue.
+		Check(vkQueueSubmit(device_.TransferQueue(), 1, &submitInfo, nullptr),
+			"submit asynchronous upload");
+
+		// The command buffer and the batch's staging stay in use until then.
+		semaphore_->Wait(batch.value, UINT64_MAX);
+	}
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Vulkan.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Vulkan
+{
+	class CommandPool;
+	class Device;
+	class TimelineSemaphore;
+	class UploadBatcher;
+
+	// Uploads batches on the dedicated transfer queue from a thread of its own, so they overlap whatever the
+	// compute queue and the host are doing. Each batch signals the next value of a timeline semaphore and releases
+	// its buffers to the compute queue family, which takes them over with RecordAcquire. Submit, Wait and
+	// RecordAcquire are called from one thread.
+	class AsyncUploader final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(AsyncUploader)
+
+		// Whether the device has a transfer only queue family.
+		static bool Supported(const Device& device);
+
+		explicit AsyncUploader(const Device& device);
+		// Finishes the batches handed over.
+		~AsyncUploader();
+
+		// Hands the staged batch to the upload thread. The batch is left alone until Wait returned for the value
+		// the semaphore reaches once it is done, which is returned.
+		uint64_t Submit(UploadBatcher& batch);
+		// Waits on the host for the batches up to the value. Rethrows what failed on the upload thread.
+		void Wait(uint64_t value);
+		// Whether the batches up to the value are done, without waiting. Rethrows like Wait.
+		bool Done(uint64_t value);
+		// Records the compute queue's half of the ownership transfer of the batches up to the value. The commands
+		// run after the batches, by Wait or by a submit waiting for Semaphore().
+		void RecordAcquire(VkCommandBuffer commandBuffer, uint64_t value);
+
+		const TimelineSemaphore& Semaphore() const { return *semaphore_; }
+
+	private:
+
+		struct Batch
+		{
+			UploadBatcher* batch;
+			std::vector<VkBufferMemoryBarrier> barriers;
+			uint64_t value;
+		};
+
+		void run();
+		void upload(Batch& batch);
+
+		const class Device& device_;
+		std::unique_ptr<CommandPool> commandPool_;
+		std::unique_ptr<TimelineSemaphore> semaphore_;
+		uint64_t submitted_{};
+		// Released on the transfer queue, not yet acquired on the compute queue.
+		std::vector<Batch> unacquired_;
+
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		std::deque<Batch> queued_;
+		uint64_t completed_{};
+		std::exception_ptr error_;
+		bool stop_{};
+		std::thread thread_;
+	};
+
+}
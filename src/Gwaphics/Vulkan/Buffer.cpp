@@ -1,4 +1,5 @@
 #include "Buffer.hpp"
+#include "Device.hpp"
 #include "SingleTimeCommands.hpp"
 
 namespace Vulkan {
@@ -32,10 +33,29 @@ DeviceMemory Buffer::AllocateMemory(const VkMemoryPropertyFlags propertyFlags)
 
 DeviceMemory Buffer::AllocateMemory(const VkMemoryAllocateFlags allocateFlags, const VkMemoryPropertyFlags propertyFlags)
 {
-	const auto requirements = GetMemoryRequirements();
-	DeviceMemory memory(device_, requirements.size, requirements.memoryTypeBits, allocateFlags, propertyFlags);
+	VkBufferMemoryRequirementsInfo2 info = {};
+	info.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+	info.buffer = buffer_;
 
-	Check(vkBindBufferMemory(device_.Handle(), buffer_, memory.Handle(), 0),
+	VkMemoryDedicatedRequirements dedicated = {};
+	dedicated.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+	VkMemoryRequirements2 requirements = {};
+	requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+	requirements.pNext = &dedicated;
+	vkGetBufferMemoryRequirements2(device_.Handle(), &info, &requirements);
+
+	MemoryAllocator::Request request;
+	request.requirements = requirements.memoryRequirements;
+	request.allocateFlags = allocateFlags;
+	request.propertyFlags = propertyFlags;
+	request.linear = true;
+	request.dedicated = dedicated.prefersDedicatedAllocation || dedicated.requiresDedicatedAllocation;
+	request.buffer = buffer_;
+
+	DeviceMemory memory(device_, request);
+
+	Check(vkBindBufferMemory(device_.Handle(), buffer_, memory.Handle(), memory.Offset()),
 		"bind buffer memory");
 
 	return memory;
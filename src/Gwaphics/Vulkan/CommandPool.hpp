@@ -16,10 +16,12 @@ namespace Vulkan
 		~CommandPool();
 
 		const class Device& Device() const { return device_; }
+		uint32_t QueueFamilyIndex() const { return queueFamilyIndex_; }
 
 	private:
 
 		const class Device& device_;
+		const uint32_t queueFamilyIndex_;
 
 		VULKAN_HANDLE(VkCommandPool, commandPool_)
 	};
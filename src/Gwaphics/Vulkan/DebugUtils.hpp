@@ -37,6 +37,27 @@ namespace Vulkan
 		void SetObjectName(const VkSemaphore& object, const char* name) const { SetObjectName(object, name, VK_OBJECT_TYPE_SEMAPHORE); }
 		void SetObjectName(const VkShaderModule& object, const char* name) const { SetObjectName(object, name, VK_OBJECT_TYPE_SHADER_MODULE); }
 		void SetObjectName(const VkSwapchainKHR& object, const char* name) const { SetObjectName(object, name, VK_OBJECT_TYPE_SWAPCHAIN_KHR); }
+
+		// Named regions of a command buffer for debuggers and profilers, no-ops without VK_EXT_debug_utils.
+		void BeginRegion(VkCommandBuffer commandBuffer, const char* name) const
+		{
+			if (vkCmdBeginDebugUtilsLabelEXT_ != nullptr)
+			{
+				VkDebugUtilsLabelEXT label = {};
+				label.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
+				label.pLabelName = name;
+
+				vkCmdBeginDebugUtilsLabelEXT_(commandBuffer, &label);
+			}
+		}
+
+		void EndRegion(VkCommandBuffer commandBuffer) const
+		{
+			if (vkCmdEndDebugUtilsLabelEXT_ != nullptr)
+			{
+				vkCmdEndDebugUtilsLabelEXT_(commandBuffer);
+			}
+		}
 		
 	private:
 
@@ -56,6 +77,8 @@ namespace Vulkan
 		}
 
 		const PFN_vkSetDebugUtilsObjectNameEXT vkSetDebugUtilsObjectNameEXT_;
+		const PFN_vkCmdBeginDebugUtilsLabelEXT vkCmdBeginDebugUtilsLabelEXT_;
+		const PFN_vkCmdEndDebugUtilsLabelEXT vkCmdEndDebugUtilsLabelEXT_;
 
 		VkDevice device_{};
 	};
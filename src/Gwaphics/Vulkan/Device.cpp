@@ -1,6 +1,7 @@
 #include "Device.hpp"
 #include "Enumerate.hpp"
 #include "Instance.hpp"
+#include "MemoryAllocator.hpp"
 #include "Surface.hpp"
 
 
@@ -42,9 +43,33 @@ Device::Device(
 	const std::vector<const char*>& requiredExtensions,
 	const VkPhysicalDeviceFeatures& deviceFeatures,
 	const void* nextDeviceFeatures) :
+	Device(physicalDevice, surface.Instance(), &surface, requiredExtensions, deviceFeatures, nextDeviceFeatures)
+{
+}
+
+Device::Device(
+	VkPhysicalDevice physicalDevice,
+	const class Instance& instance,
+	const std::vector<const char*>& requiredExtensions,
+	const VkPhysicalDeviceFeatures& deviceFeatures,
+	const void* nextDeviceFeatures) :
+	Device(physicalDevice, instance, nullptr, requiredExtensions, deviceFeatures, nextDeviceFeatures)
+{
+}
+
+Device::Device(
+	VkPhysicalDevice physicalDevice,
+	const class Instance& instance,
+	const class Surface* const surface,
+	const std::vector<const char*>& requiredExtensions,
+	const VkPhysicalDeviceFeatures& deviceFeatures,
+	const void* nextDeviceFeatures) :
 	physicalDevice_(physicalDevice),
+	instance_(instance),
 	surface_(surface),
-	debugUtils_(surface.Instance().Handle())
+	debugUtils_(instance.Handle()),
+	enabledFeatures_(deviceFeatures),
+	enabledExtensions_(requiredExtensions.begin(), requiredExtensions.end())
 {
 	CheckRequiredExtensions(physicalDevice, requiredExtensions);
 
@@ -54,16 +79,23 @@ Device::Device(
 	const auto graphicsFamily = FindQueue(queueFamilies, "graphics", VK_QUEUE_GRAPHICS_BIT, 0);
 	const auto computeFamily = FindQueue(queueFamilies, "compute", VK_QUEUE_COMPUTE_BIT, 0);
 
-	//Commented out the dedicated transfer queue, as it's never used (relic from Vulkan tutorial) 
-	//and causes problems with RADV (see https://github.com/NVIDIA/Q2RTX/issues/147).
-	//const auto transferFamily = FindQueue(queueFamilies, "transfer", VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+	// The dedicated transfer queue is optional, not every device has a family for transfers alone (RADV, see
+	// https://github.com/NVIDIA/Q2RTX/issues/147). Only asynchronous uploads use it.
+	const auto transferFamily = std::find_if(queueFamilies.begin(), queueFamilies.end(), [](const VkQueueFamilyProperties& queueFamily)
+	{
+		return
+			queueFamily.queueCount > 0 &&
+			queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT &&
+			!(queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT));
+	});
+	const bool hasTransferFamily = transferFamily != queueFamilies.end();
 
-	// Find the presentation queue (usually the same as graphics queue).
-	const auto presentFamily = std::find_if(queueFamilies.begin(), queueFamilies.end(), [&](const VkQueueFamilyProperties& queueFamily)
+	// Find the presentation queue (usually the same as graphics queue). Headless, nothing is presented.
+	const auto presentFamily = surface == nullptr ? graphicsFamily : std::find_if(queueFamilies.begin(), queueFamilies.end(), [&](const VkQueueFamilyProperties& queueFamily)
 	{
 		VkBool32 presentSupport = false;
 		const uint32_t i = static_cast<uint32_t>(&*queueFamilies.cbegin() - &queueFamily);
-		vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface.Handle(), &presentSupport);
+		vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface->Handle(), &presentSupport);
 		return queueFamily.queueCount > 0 && presentSupport;
 	});
 
@@ -75,7 +107,7 @@ Device::Device(
 	graphicsFamilyIndex_ = static_cast<uint32_t>(graphicsFamily - queueFamilies.begin());
 	computeFamilyIndex_ = static_cast<uint32_t>(computeFamily - queueFamilies.begin());
 	presentFamilyIndex_ = static_cast<uint32_t>(presentFamily - queueFamilies.begin());
-	//transferFamilyIndex_ = static_cast<uint32_t>(transferFamily - queueFamilies.begin());
+	transferFamilyIndex_ = hasTransferFamily ? static_cast<uint32_t>(transferFamily - queueFamilies.begin()) : computeFamilyIndex_;
 
 	// Queues can be the same
 	const std::set<uint32_t> uniqueQueueFamilies =
@@ -83,7 +115,7 @@ Device::Device(
 		graphicsFamilyIndex_,
 		computeFamilyIndex_,
 		presentFamilyIndex_,
-		//transferFamilyIndex_
+		transferFamilyIndex_
 	};
 
 	// Create queues
@@ -108,8 +140,8 @@ Device::Device(
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.pEnabledFeatures = &deviceFeatures;
-	createInfo.enabledLayerCount = static_cast<uint32_t>(surface_.Instance().ValidationLayers().size());
-	createInfo.ppEnabledLayerNames = surface_.Instance().ValidationLayers().data();
+	createInfo.enabledLayerCount = static_cast<uint32_t>(instance.ValidationLayers().size());
+	createInfo.ppEnabledLayerNames = instance.ValidationLayers().data();
 	createInfo.enabledExtensionCount = static_cast<uint32_t>(requiredExtensions.size());
 	createInfo.ppEnabledExtensionNames = requiredExtensions.data();
 
@@ -117,15 +149,21 @@ Device::Device(
 		"create logical device");
 
 	debugUtils_.SetDevice(device_);
+	memoryAllocator_.reset(new class MemoryAllocator(*this));
 
 	vkGetDeviceQueue(device_, graphicsFamilyIndex_, 0, &graphicsQueue_);
 	vkGetDeviceQueue(device_, computeFamilyIndex_, 0, &computeQueue_);
 	vkGetDeviceQueue(device_, presentFamilyIndex_, 0, &presentQueue_);
-	//vkGetDeviceQueue(device_, transferFamilyIndex_, 0, &transferQueue_);
+	if (hasTransferFamily)
+	{
+		vkGetDeviceQueue(device_, transferFamilyIndex_, 0, &transferQueue_);
+	}
 }
 
 Device::~Device()
 {
+	memoryAllocator_.reset();
+
 	if (device_ != nullptr)
 	{
 		vkDestroyDevice(device_, nullptr);
@@ -133,6 +171,16 @@ Device::~Device()
 	}
 }
 
+VkQueue Device::Queue(const uint32_t familyIndex) const
+{
+	if (familyIndex == graphicsFamilyIndex_) return graphicsQueue_;
+	if (familyIndex == computeFamilyIndex_) return computeQueue_;
+	if (familyIndex == presentFamilyIndex_) return presentQueue_;
+	if (familyIndex == transferFamilyIndex_ && transferQueue_ != nullptr) return transferQueue_;
+
+	throw std::runtime_error("no queue was created for family " + std::to_string(familyIndex));
+}
+
 void Device::WaitIdle() const
 {
 	Check(vkDeviceWaitIdle(device_),
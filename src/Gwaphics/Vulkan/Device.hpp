@@ -2,10 +2,15 @@
 
 #include "DebugUtils.hpp"
 #include "Vulkan.hpp"
+#include <memory>
+#include <set>
+#include <string>
 #include <vector>
 
 namespace Vulkan
 {
+	class Instance;
+	class MemoryAllocator;
 	class Surface;
 
 	class Device final
@@ -20,46 +25,77 @@ namespace Vulkan
 			const std::vector<const char*>& requiredExtensionsconst,
 			const VkPhysicalDeviceFeatures& deviceFeatures,
 			const void* nextDeviceFeatures);
+
+		// Headless, without a surface to present to. The present queue is the graphics queue.
+		Device(
+			VkPhysicalDevice physicalDevice,
+			const Instance& instance,
+			const std::vector<const char*>& requiredExtensions,
+			const VkPhysicalDeviceFeatures& deviceFeatures,
+			const void* nextDeviceFeatures);
 		
 		~Device();
 
 		VkPhysicalDevice PhysicalDevice() const { return physicalDevice_; }
-		const class Surface& Surface() const { return surface_; }
+		const class Instance& Instance() const { return instance_; }
+		bool Headless() const { return surface_ == nullptr; }
+		const class Surface& Surface() const { return *surface_; }
 
 		const class DebugUtils& DebugUtils() const { return debugUtils_; }
+		const VkPhysicalDeviceFeatures& EnabledFeatures() const { return enabledFeatures_; }
+		bool IsEnabled(const std::string& extension) const { return enabledExtensions_.count(extension) != 0; }
+		class MemoryAllocator& MemoryAllocator() const { return *memoryAllocator_; }
 
 		uint32_t GraphicsFamilyIndex() const { return graphicsFamilyIndex_; }
 		uint32_t ComputeFamilyIndex() const { return computeFamilyIndex_; }
 		uint32_t PresentFamilyIndex() const { return presentFamilyIndex_; }
-		//uint32_t TransferFamilyIndex() const { return transferFamilyIndex_; }
+		// Only with a transfer only queue family, see HasTransferQueue().
+		uint32_t TransferFamilyIndex() const { return transferFamilyIndex_; }
 		
 		VkQueue GraphicsQueue() const { return graphicsQueue_; }
 		VkQueue ComputeQueue() const { return computeQueue_; }
 		VkQueue PresentQueue() const { return presentQueue_; }
-		//VkQueue TransferQueue() const { return transferQueue_; }
+		VkQueue TransferQueue() const { return transferQueue_; }
+		// The queue created for the family, throws for a family without one.
+		VkQueue Queue(uint32_t familyIndex) const;
+
+		// Whether the device has a queue family for transfers alone, usually backed by a DMA engine.
+		bool HasTransferQueue() const { return transferQueue_ != nullptr; }
 
 		void WaitIdle() const;
 
 	private:
 
+		Device(
+			VkPhysicalDevice physicalDevice,
+			const class Instance& instance,
+			const class Surface* surface,
+			const std::vector<const char*>& requiredExtensions,
+			const VkPhysicalDeviceFeatures& deviceFeatures,
+			const void* nextDeviceFeatures);
+
 		void CheckRequiredExtensions(VkPhysicalDevice physicalDevice, const std::vector<const char*>& requiredExtensions) const;
 
 		const VkPhysicalDevice physicalDevice_;
-		const class Surface& surface_;
+		const class Instance& instance_;
+		const class Surface* const surface_;
 
 		VULKAN_HANDLE(VkDevice, device_)
 
 		class DebugUtils debugUtils_;
+		const VkPhysicalDeviceFeatures enabledFeatures_;
+		const std::set<std::string> enabledExtensions_;
+		std::unique_ptr<class MemoryAllocator> memoryAllocator_;
 
 		uint32_t graphicsFamilyIndex_ {};
 		uint32_t computeFamilyIndex_{};
 		uint32_t presentFamilyIndex_{};
-		//uint32_t transferFamilyIndex_{};
+		uint32_t transferFamilyIndex_{};
 
 		VkQueue graphicsQueue_{};
 		VkQueue computeQueue_{};
 		VkQueue presentQueue_{};
-		//VkQueue transferQueue_{};
+		VkQueue transferQueue_{};
 	};
 
 }
@@ -5,74 +5,40 @@
 
 namespace Vulkan {
 
-DeviceMemory::DeviceMemory(
-	const class Device& device, 
-	const size_t size, 
-	const uint32_t memoryTypeBits,
-	const VkMemoryAllocateFlags allocateFLags,
-	const VkMemoryPropertyFlags propertyFlags) :
-	device_(device)
+DeviceMemory::DeviceMemory(const class Device& device, const MemoryAllocator::Request& request) :
+	device_(device),
+	allocation_(device.MemoryAllocator().Allocate(request))
 {
-	VkMemoryAllocateFlagsInfo flagsInfo = {};
-	flagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
-	flagsInfo.pNext = nullptr;
-	flagsInfo.flags = allocateFLags;
-	
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.pNext = &flagsInfo;
-	allocInfo.allocationSize = size;
-	allocInfo.memoryTypeIndex = FindMemoryType(memoryTypeBits, propertyFlags);
-
-	Check(vkAllocateMemory(device.Handle(), &allocInfo, nullptr, &memory_),
-		"allocate memory");
 }
 
 DeviceMemory::DeviceMemory(DeviceMemory&& other) noexcept :
 	device_(other.device_),
-	memory_(other.memory_)
+	allocation_(other.allocation_)
 {
-	other.memory_ = nullptr;
+	other.allocation_ = MemoryAllocator::Allocation();
 }
 
 DeviceMemory::~DeviceMemory()
 {
-	if (memory_ != nullptr)
+	if (allocation_.memory != nullptr)
 	{
-		vkFreeMemory(device_.Handle(), memory_, nullptr);
-		memory_ = nullptr;
+		device_.MemoryAllocator().Free(allocation_);
+		allocation_ = MemoryAllocator::Allocation();
 	}
 }
 
 void* DeviceMemory::Map(const size_t offset, const size_t size)
 {
-	void* data;
-	Check(vkMapMemory(device_.Handle(), memory_, offset, size, 0, &data),
-		"map memory");
+	if (allocation_.mapped == nullptr || offset + size > allocation_.size)
+	{
+		throw std::runtime_error("failed to map memory, it is not host visible or the range is out of bounds");
+	}
 
-	return data;
+	return allocation_.mapped + offset;
 }
 
 void DeviceMemory::Unmap()
 {
-	vkUnmapMemory(device_.Handle(), memory_);
-}
-
-uint32_t DeviceMemory::FindMemoryType(const uint32_t typeFilter, const VkMemoryPropertyFlags propertyFlags) const
-{
-	VkPhysicalDeviceMemoryProperties memProperties;
-	vkGetPhysicalDeviceMemoryProperties(device_.PhysicalDevice(), &memProperties);
-
-	for (uint32_t i = 0; i != memProperties.memoryTypeCount; ++i)
-	{
-		if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & propertyFlags) == propertyFlags)
-		{
-			return i;
-		}
-	}
-
-	
-	(std::runtime_error("failed to find suitable memory type"));
 }
 
 }
@@ -1,11 +1,14 @@
 #pragma once
 
 #include "Vulkan.hpp"
+#include "MemoryAllocator.hpp"
 
 namespace Vulkan
 {
 	class Device;
 
+	// Memory of a single resource, placed by the device's MemoryAllocator. It usually shares its VkDeviceMemory
+	// with other resources, so the resource is bound at Offset().
 	class DeviceMemory final
 	{
 	public:
@@ -14,22 +17,23 @@ namespace Vulkan
 		DeviceMemory& operator = (const DeviceMemory&) = delete;
 		DeviceMemory& operator = (DeviceMemory&&) = delete;
 
-		DeviceMemory(const Device& device, size_t size, uint32_t memoryTypeBits, VkMemoryAllocateFlags allocateFLags, VkMemoryPropertyFlags propertyFlags);
+		DeviceMemory(const Device& device, const MemoryAllocator::Request& request);
 		DeviceMemory(DeviceMemory&& other) noexcept;
 		~DeviceMemory();
 
 		const class Device& Device() const { return device_; }
+		VkDeviceMemory Handle() const { return allocation_.memory; }
+		VkDeviceSize Offset() const { return allocation_.offset; }
+		VkDeviceSize Size() const { return allocation_.size; }
 
+		// Host visible memory stays mapped, Map only hands out the pointer and Unmap does nothing.
 		void* Map(size_t offset, size_t size);
 		void Unmap();
 
 	private:
 
-		uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
-
 		const class Device& device_;
-
-		VULKAN_HANDLE(VkDeviceMemory, memory_)
+		MemoryAllocator::Allocation allocation_;
 	};
 
 }
@@ -0,0 +1,33 @@
+#include "DeviceProcedures.hpp"
+#include "Device.hpp"
+#include <string>
+#include <stdexcept>
+
+namespace Vulkan {
+
+namespace
+{
+	template <class Func>
+	Func GetProcedure(const Device& device, const char* const name)
+	{
+		const auto func = reinterpret_cast<Func>(vkGetDeviceProcAddr(device.Handle(), name));
+		if (func == nullptr)
+		{
+			throw std::runtime_error(std::string("failed to get address of '") + name + "'");
+		}
+
+		return func;
+	}
+}
+
+DeviceProcedures::DeviceProcedures(const class Device& device) :
+	vkCreateAccelerationStructureKHR(GetProcedure<PFN_vkCreateAccelerationStructureKHR>(device, "vkCreateAccelerationStructureKHR")),
+	vkDestroyAccelerationStructureKHR(GetProcedure<PFN_vkDestroyAccelerationStructureKHR>(device, "vkDestroyAccelerationStructureKHR")),
+	vkGetAccelerationStructureBuildSizesKHR(GetProcedure<PFN_vkGetAccelerationStructureBuildSizesKHR>(device, "vkGetAccelerationStructureBuildSizesKHR")),
+	vkCmdBuildAccelerationStructuresKHR(GetProcedure<PFN_vkCmdBuildAccelerationStructuresKHR>(device, "vkCmdBuildAccelerationStructuresKHR")),
+	vkGetAccelerationStructureDeviceAddressKHR(GetProcedure<PFN_vkGetAccelerationStructureDeviceAddressKHR>(device, "vkGetAccelerationStructureDeviceAddressKHR")),
+	device_(device)
+{
+}
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Vulkan.hpp"
+#include <functional>
+
+namespace Vulkan
+{
+	class Device;
+
+	// Extension commands, which the loader does not export and have to be looked up per device. Only those of
+	// VK_KHR_acceleration_structure, load once the device has the extension enabled.
+	class DeviceProcedures final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(DeviceProcedures)
+
+		explicit DeviceProcedures(const Device& device);
+		~DeviceProcedures() = default;
+
+		const class Device& Device() const { return device_; }
+
+		const std::function<VkResult(
+			VkDevice device,
+			const VkAccelerationStructureCreateInfoKHR* pCreateInfo,
+			const VkAllocationCallbacks* pAllocator,
+			VkAccelerationStructureKHR* pAccelerationStructure)>
+		vkCreateAccelerationStructureKHR;
+
+		const std::function<void(
+			VkDevice device,
+			VkAccelerationStructureKHR accelerationStructure,
+			const VkAllocationCallbacks* pAllocator)>
+		vkDestroyAccelerationStructureKHR;
+
+		const std::function<void(
+			VkDevice device,
+			VkAccelerationStructureBuildTypeKHR buildType,
+			const VkAccelerationStructureBuildGeometryInfoKHR* pBuildInfo,
+			const uint32_t* pMaxPrimitiveCounts,
+			VkAccelerationStructureBuildSizesInfoKHR* pSizeInfo)>
+		vkGetAccelerationStructureBuildSizesKHR;
+
+		const std::function<void(
+			VkCommandBuffer commandBuffer,
+			uint32_t infoCount,
+			const VkAccelerationStructureBuildGeometryInfoKHR* pInfos,
+			const VkAccelerationStructureBuildRangeInfoKHR* const* ppBuildRangeInfos)>
+		vkCmdBuildAccelerationStructuresKHR;
+
+		const std::function<VkDeviceAddress(
+			VkDevice device,
+			const VkAccelerationStructureDeviceAddressInfoKHR* pInfo)>
+		vkGetAccelerationStructureDeviceAddressKHR;
+
+	private:
+
+		const class Device& device_;
+	};
+
+}
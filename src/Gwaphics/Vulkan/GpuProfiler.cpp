@@ -0,0 +1,165 @@
+#include "GpuProfiler.hpp"
+#include "Device.hpp"
+#include "Enumerate.hpp"
+#include <numeric>
+#include <stdexcept>
+
+namespace Vulkan {
+
+GpuProfiler::GpuProfiler(const class Device& device, const uint32_t queueFamilyIndex, const uint32_t frameCount, const VkQueryPipelineStatisticFlags statistic) :
+	device_(device),
+	recorded_(frameCount)
+{
+	// Some compute only families cannot write timestamps, the profiler only labels regions then.
+	const auto queueFamilies = GetEnumerateVector(device.PhysicalDevice(), vkGetPhysicalDeviceQueueFamilyProperties);
+	if (queueFamilies[queueFamilyIndex].timestampValidBits == 0)
+	{
+		return;
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device.PhysicalDevice(), &properties);
+	timestampPeriod_ = properties.limits.timestampPeriod;
+
+	timestamps_.reset(new QueryPool(device, VK_QUERY_TYPE_TIMESTAMP, 2 * MaxRegions * frameCount));
+	if (statistic != 0 && device.EnabledFeatures().pipelineStatisticsQuery)
+	{
+		statistics_.reset(new QueryPool(device, VK_QUERY_TYPE_PIPELINE_STATISTICS, MaxRegions * frameCount, statistic));
+	}
+}
+
+void GpuProfiler::BeginFrame(VkCommandBuffer commandBuffer, const uint32_t frame)
+{
+	frame_ = frame;
+	if (timestamps_ == nullptr)
+	{
+		return;
+	}
+
+	ReadBack(frame);
+	recorded_[frame].clear();
+
+	timestamps_->Reset(commandBuffer, 2 * MaxRegions * frame, 2 * MaxRegions);
+	if (statistics_)
+	{
+		statistics_->Reset(commandBuffer, MaxRegions * frame, MaxRegions);
+	}
+}
+
+void GpuProfiler::BeginRegion(VkCommandBuffer commandBuffer, const char* name)
+{
+	device_.DebugUtils().BeginRegion(commandBuffer, name);
+
+	auto& recorded = recorded_[frame_];
+	regionOpen_ = timestamps_ != nullptr && recorded.size() != MaxRegions;
+	if (!regionOpen_)
+	{
+		return;
+	}
+
+	const uint32_t slot = static_cast<uint32_t>(recorded.size());
+	recorded.push_back(FindRegion(name));
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestamps_->Handle(), 2 * (MaxRegions * frame_ + slot));
+	if (statistics_)
+	{
+		vkCmdBeginQuery(commandBuffer, statistics_->Handle(), MaxRegions * frame_ + slot, 0);
+	}
+}
+
+void GpuProfiler::EndRegion(VkCommandBuffer commandBuffer)
+{
+	if (regionOpen_)
+	{
+		const uint32_t slot = static_cast<uint32_t>(recorded_[frame_].size()) - 1;
+		if (statistics_)
+		{
+			vkCmdEndQuery(commandBuffer, statistics_->Handle(), MaxRegions * frame_ + slot);
+		}
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestamps_->Handle(), 2 * (MaxRegions * frame_ + slot) + 1);
+
+		regionOpen_ = false;
+	}
+
+	device_.DebugUtils().EndRegion(commandBuffer);
+}
+
+void GpuProfiler::SetLog(const std::string& path)
+{
+	log_.close();
+	if (path.empty())
+	{
+		return;
+	}
+
+	log_.open(path, std::ios::out | std::ios::app);
+	if (!log_)
+	{
+		throw std::runtime_error("failed to open '" + path + "'");
+	}
+
+	if (log_.tellp() == 0)
+	{
+		log_ << "frame,region,ms,invocations\n";
+	}
+}
+
+void GpuProfiler::ReadBack(const uint32_t frame)
+{
+	const auto& recorded = recorded_[frame];
+	if (recorded.empty())
+	{
+		return;
+	}
+
+	// Only unavailable if the slot was recorded but never submitted.
+	const uint32_t count = static_cast<uint32_t>(recorded.size());
+	std::vector<uint64_t> timestamps;
+	if (!timestamps_->GetResults(2 * MaxRegions * frame, 2 * count, timestamps))
+	{
+		return;
+	}
+
+	std::vector<uint64_t> invocations;
+	const bool counted = statistics_ && statistics_->GetResults(MaxRegions * frame, count, invocations);
+
+	++framesReadBack_;
+	for (uint32_t i = 0; i != count; ++i)
+	{
+		Region& region = regions_[recorded[i]];
+		auto& history = history_[recorded[i]];
+		const double time = static_cast<double>(timestamps[2 * i + 1] - timestamps[2 * i]) * timestampPeriod_ * 1e-6;
+
+		// rolling window, the oldest frame makes room for the new one
+		if (history.size() == History)
+		{
+			history.erase(history.begin());
+		}
+		history.push_back(time);
+
+		region.time = std::accumulate(history.begin(), history.end(), 0.0) / static_cast<double>(history.size());
+		region.invocations = counted ? invocations[i] : 0;
+
+		if (log_.is_open())
+		{
+			log_ << framesReadBack_ << ',' << region.name << ',' << time << ',' << region.invocations << '\n';
+		}
+	}
+}
+
+uint32_t GpuProfiler::FindRegion(const char* name)
+{
+	for (uint32_t i = 0; i != regions_.size(); ++i)
+	{
+		if (regions_[i].name == name)
+		{
+			return i;
+		}
+	}
+
+	regions_.push_back({ name });
+	history_.emplace_back();
+	return static_cast<uint32_t>(regions_.size()) - 1;
+}
+
+}
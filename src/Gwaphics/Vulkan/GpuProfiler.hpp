@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Vulkan.hpp"
+#include "QueryPool.hpp"
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Vulkan
+{
+	class Device;
+
+	// GPU time of named regions of the command buffers submitted to one queue, from timestamp queries, and a
+	// pipeline statistic per region where those queries are enabled. The results of a frame slot are read back
+	// when the slot is recorded again, by then the caller has waited for its last submission. Regions do not nest,
+	// and are labelled through DebugUtils for frame debuggers.
+	class GpuProfiler final
+	{
+	public:
+
+		struct Region
+		{
+			std::string name;
+			double time{}; // milliseconds, averaged over the last frames read back
+			uint64_t invocations{}; // the pipeline statistic of the last frame read back, 0 without one
+		};
+
+		VULKAN_NON_COPIABLE(GpuProfiler)
+
+		// statistic is a single pipeline statistic or 0, the queue family has to support it
+		// (no graphics statistics on a compute only family).
+		GpuProfiler(const Device& device, uint32_t queueFamilyIndex, uint32_t frameCount, VkQueryPipelineStatisticFlags statistic);
+
+		// Reads back what was recorded in this slot last time and resets its queries, outside a render pass.
+		void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frame);
+		void BeginRegion(VkCommandBuffer commandBuffer, const char* name);
+		void EndRegion(VkCommandBuffer commandBuffer);
+
+		// In order of first use.
+		const std::vector<Region>& Regions() const { return regions_; }
+
+		// Appends a frame,region,ms,invocations row per region read back to the CSV file, an empty path stops logging.
+		void SetLog(const std::string& path);
+
+	private:
+
+		static constexpr uint32_t MaxRegions = 8;
+		static constexpr size_t History = 64;
+
+		void ReadBack(uint32_t frame);
+		uint32_t FindRegion(const char* name);
+
+		const class Device& device_;
+		double timestampPeriod_{};
+		std::unique_ptr<QueryPool> timestamps_; // null if the queue family has no timestamps
+		std::unique_ptr<QueryPool> statistics_;
+
+		std::vector<Region> regions_;
+		std::vector<std::vector<double>> history_; // per region
+		std::vector<std::vector<uint32_t>> recorded_; // regions recorded in each frame slot, in order
+		uint32_t frame_{};
+		bool regionOpen_{};
+		uint64_t framesReadBack_{};
+		std::ofstream log_;
+	};
+
+}
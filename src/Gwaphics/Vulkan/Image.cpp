@@ -23,6 +23,7 @@ Image::Image(
 	device_(device),
 	extent_(extent),
 	format_(format),
+	tiling_(tiling),
 	imageLayout_(VK_IMAGE_LAYOUT_UNDEFINED)
 {
 	VkImageCreateInfo imageInfo = {};
@@ -49,6 +50,7 @@ Image::Image(Image&& other) noexcept :
 	device_(other.device_),
 	extent_(other.extent_),
 	format_(other.format_),
+	tiling_(other.tiling_),
 	imageLayout_(other.imageLayout_),
 	image_(other.image_)
 {
@@ -66,10 +68,28 @@ Image::~Image()
 
 DeviceMemory Image::AllocateMemory(const VkMemoryPropertyFlags properties) const
 {
-	const auto requirements = GetMemoryRequirements();
-	DeviceMemory memory(device_, requirements.size, requirements.memoryTypeBits, 0, properties);
+	VkImageMemoryRequirementsInfo2 info = {};
+	info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+	info.image = image_;
 
-	Check(vkBindImageMemory(device_.Handle(), image_, memory.Handle(), 0),
+	VkMemoryDedicatedRequirements dedicated = {};
+	dedicated.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+	VkMemoryRequirements2 requirements = {};
+	requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+	requirements.pNext = &dedicated;
+	vkGetImageMemoryRequirements2(device_.Handle(), &info, &requirements);
+
+	MemoryAllocator::Request request;
+	request.requirements = requirements.memoryRequirements;
+	request.propertyFlags = properties;
+	request.linear = tiling_ == VK_IMAGE_TILING_LINEAR;
+	request.dedicated = dedicated.prefersDedicatedAllocation || dedicated.requiresDedicatedAllocation;
+	request.image = image_;
+
+	DeviceMemory memory(device_, request);
+
+	Check(vkBindImageMemory(device_.Handle(), image_, memory.Handle(), memory.Offset()),
 		"bind image memory");
 
 	return memory;
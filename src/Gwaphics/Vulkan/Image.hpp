@@ -37,6 +37,7 @@ namespace Vulkan
 		const class Device& device_;
 		const VkExtent2D extent_;
 		const VkFormat format_;
+		const VkImageTiling tiling_;
 		VkImageLayout imageLayout_;
 
 		VULKAN_HANDLE(VkImage, image_)
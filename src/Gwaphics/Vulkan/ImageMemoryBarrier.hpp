@@ -33,6 +33,38 @@ namespace Vulkan
 				VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1,
 				&barrier);
 		}
+
+		// Between the given stages, and with a queue family ownership transfer if the families differ.
+		// Both the releasing and the acquiring queue record it, with the same layouts and families.
+		static void Insert(
+			const VkCommandBuffer commandBuffer,
+			const VkImage image,
+			const VkImageSubresourceRange subresourceRange,
+			const VkPipelineStageFlags srcStageMask,
+			const VkAccessFlags srcAccessMask,
+			const VkPipelineStageFlags dstStageMask,
+			const VkAccessFlags dstAccessMask,
+			const VkImageLayout oldLayout,
+			const VkImageLayout newLayout,
+			const uint32_t srcQueueFamilyIndex,
+			const uint32_t dstQueueFamilyIndex)
+		{
+			const bool transfer = srcQueueFamilyIndex != dstQueueFamilyIndex;
+
+			VkImageMemoryBarrier barrier;
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.pNext = nullptr;
+			barrier.srcAccessMask = srcAccessMask;
+			barrier.dstAccessMask = dstAccessMask;
+			barrier.oldLayout = oldLayout;
+			barrier.newLayout = newLayout;
+			barrier.srcQueueFamilyIndex = transfer ? srcQueueFamilyIndex : VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = transfer ? dstQueueFamilyIndex : VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = image;
+			barrier.subresourceRange = subresourceRange;
+
+			vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		}
 	};
 
 }
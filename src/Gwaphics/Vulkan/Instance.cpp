@@ -5,19 +5,65 @@
 
 #include <algorithm>
 #include <sstream>
+#include <stdexcept>
 
 namespace Vulkan {
 
+namespace
+{
+	bool HasGraphicsQueue(const VkPhysicalDevice& device)
+	{
+		const auto queueFamilies = GetEnumerateVector(device, vkGetPhysicalDeviceQueueFamilyProperties);
+		return std::any_of(queueFamilies.begin(), queueFamilies.end(), [](const VkQueueFamilyProperties& queueFamily)
+			{
+				return queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+			});
+	}
+}
+
+VkPhysicalDevice ChoosePhysicalDevice(const std::vector<VkPhysicalDevice>& physicalDevices)
+{
+	auto result = std::find_if(physicalDevices.begin(), physicalDevices.end(), [](const VkPhysicalDevice& device)
+		{
+			VkPhysicalDeviceProperties properties{};
+			vkGetPhysicalDeviceProperties(device, &properties);
+			return properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU && HasGraphicsQueue(device);
+		});
+
+	if (result == physicalDevices.end())
+	{
+		result = std::find_if(physicalDevices.begin(), physicalDevices.end(), HasGraphicsQueue);
+	}
+
+	if (result == physicalDevices.end())
+	{
+		throw std::runtime_error("cannot find a suitable device");
+	}
+
+	return *result;
+}
+
 Instance::Instance(const class Window& window, const std::vector<const char*>& validationLayers, uint32_t vulkanVersion) :
-	window_(window),
+	window_(&window),
 	validationLayers_(validationLayers)
 {
+	Create(window.GetRequiredInstanceExtensions(), vulkanVersion);
+}
+
+Instance::Instance(const std::vector<const char*>& validationLayers, uint32_t vulkanVersion) :
+	window_(nullptr),
+	validationLayers_(validationLayers)
+{
+	Create({}, vulkanVersion);
+}
+
+void Instance::Create(std::vector<const char*> extensions, const uint32_t vulkanVersion)
+{
+	const auto& validationLayers = validationLayers_;
+
 	// Check the minimum version.
 	CheckVulkanMinimumVersion(vulkanVersion);
 
-	// Get the list of required extensions.
-	auto extensions = window.GetRequiredInstanceExtensions();
-
 	// Check the validation layers and add them to the list of required extensions.
 	CheckVulkanValidationLayerSupport(validationLayers);
 
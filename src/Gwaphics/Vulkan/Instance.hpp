@@ -14,9 +14,11 @@ namespace Vulkan
 		VULKAN_NON_COPIABLE(Instance)
 
 		Instance(const Window& window, const std::vector<const char*>& validationLayers, uint32_t vulkanVersion);
+		// Headless, without the extensions to present to a window.
+		Instance(const std::vector<const char*>& validationLayers, uint32_t vulkanVersion);
 		~Instance();
 
-		const class Window& Window() const { return window_; }
+		const class Window& Window() const { return *window_; }
 
 		const std::vector<VkExtensionProperties>& Extensions() const { return extensions_; }
 		const std::vector<VkLayerProperties>& Layers() const { return layers_; }
@@ -25,6 +27,7 @@ namespace Vulkan
 
 	private:
 
+		void Create(std::vector<const char*> extensions, uint32_t vulkanVersion);
 		void GetVulkanExtensions();
 		void GetVulkanLayers();
 		void GetVulkanPhysicalDevices();
@@ -32,7 +35,7 @@ namespace Vulkan
 		static void CheckVulkanMinimumVersion(uint32_t minVersion);
 		static void CheckVulkanValidationLayerSupport(const std::vector<const char*>& validationLayers);
 
-		const class Window& window_;
+		const class Window* const window_;
 		const std::vector<const char*> validationLayers_;
 
 		VULKAN_HANDLE(VkInstance, instance_)
@@ -42,4 +45,8 @@ namespace Vulkan
 		std::vector<VkPhysicalDevice> physicalDevices_;
 	};
 
+	// A discrete GPU if there is one, otherwise anything with a graphics queue, like a software implementation
+	// (lavapipe, SwiftShader) to test on. Used by the windowed application and the headless renderer alike.
+	VkPhysicalDevice ChoosePhysicalDevice(const std::vector<VkPhysicalDevice>& physicalDevices);
+
 }
@@ -0,0 +1,380 @@
+#include "MemoryAllocator.hpp"
+#include "Device.hpp"
+
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+namespace Vulkan
+{
+	namespace
+	{
+		// The smallest buddy, every placement is a power of two multiple of it.
+		const VkDeviceSize MinNodeSize = 256;
+		const VkDeviceSize MinBlockSize = 1024 * 1024;
+		const VkDeviceSize MaxBlockSize = 64 * 1024 * 1024;
+
+		VkDeviceSize NodeSize(const uint32_t order)
+		{
+			return MinNodeSize << order;
+		}
+
+		uint32_t OrderOf(const VkDeviceSize size)
+		{
+			uint32_t order = 0;
+			while (NodeSize(order) < size)
+			{
+				++order;
+			}
+
+			return order;
+		}
+
+		// An eighth of the heap at most, so small heaps such as the host visible part of VRAM are not taken up by
+		// a couple of blocks.
+		VkDeviceSize BlockSize(const VkDeviceSize heapSize)
+		{
+			VkDeviceSize size = MaxBlockSize;
+			while (size > MinBlockSize && size > heapSize / 8)
+			{
+				size /= 2;
+			}
+
+			return size;
+		}
+	}
+
+	struct MemoryAllocator::Pool
+	{
+		uint32_t memoryType;
+		VkMemoryAllocateFlags allocateFlags;
+		VkDeviceSize blockSize;
+		std::vector<std::unique_ptr<Block>> blocks;
+	};
+
+	struct MemoryAllocator::Block
+	{
+		VkDeviceMemory memory;
+		uint8_t* mapped;
+		uint32_t allocations;
+		// Offsets of the free buddies by order, the last order is the whole block.
+		std::vector<std::set<VkDeviceSize>> free;
+
+		bool Allocate(const uint32_t order, VkDeviceSize& offset)
+		{
+			uint32_t split = order;
+			while (split != free.size() && free[split].empty())
+			{
+				++split;
+			}
+
+			if (split == free.size())
+			{
+				return false;
+			}
+
+			offset = *free[split].begin();
+			free[split].erase(free[split].begin());
+
+			// Halve the buddy down to the order, the upper halves are free.
+			while (split != order)
+			{
+				--split;
+				free[split].insert(offset + NodeSize(split));
+			}
+
+			++allocations;
+			return true;
+		}
+
+		void Free(VkDeviceSize offset, uint32_t order)
+		{
+			// Merge with the buddy for as long as it is free as well.
+			while (order + 1 != free.size())
+			{
+				const auto buddy = free[order].find(offset ^ NodeSize(order));
+				if (buddy == free[order].end())
+				{
+					break;
+				}
+
+				free[order].erase(buddy);
+				offset &= ~NodeSize(order);
+				++order;
+			}
+
+			free[order].insert(offset);
+			--allocations;
+		}
+	};
+
+	MemoryAllocator::MemoryAllocator(const class Device& device) :
+		device_(device),
+		budgetSupported_(device.IsEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+	{
+		vkGetPhysicalDeviceMemoryProperties(device.PhysicalDevice(), &properties_);
+
+		heaps_.resize(properties_.memoryHeapCount, HeapStatistics{});
+		for (uint32_t i = 0; i != properties_.memoryHeapCount; ++i)
+		{
+			heaps_[i].deviceLocal = (properties_.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+			heaps_[i].size = properties_.memoryHeaps[i].size;
+		}
+	}
+
+	MemoryAllocator::~MemoryAllocator()
+	{
+		for (auto& pool : pools_)
+		{
+			for (auto& block : pool.second->blocks)
+			{
+				vkFreeMemory(device_.Handle(), block->memory, nullptr);
+			}
+		}
+	}
+
+	MemoryAllocator::Allocation MemoryAllocator::Allocate(const Request& request)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		const uint32_t memoryType = findMemoryType(request.requirements.memoryTypeBits, request.propertyFlags);
+		const uint32_t heap = properties_.memoryTypes[memoryType].heapIndex;
+
+		auto& pool = pools_[std::make_tuple(memoryType, request.allocateFlags, request.linear)];
+		if (!pool)
+		{
+			pool.reset(new Pool{ memoryType, request.allocateFlags, BlockSize(properties_.memoryHeaps[heap].size), {} });
+		}
+
+		// Buddies are aligned to their size.
+		const VkDeviceSize size = std::max(request.requirements.size, request.requirements.alignment);
+		if (request.dedicated || size > pool->blockSize / 2)
+		{
+			return allocateDedicated(request, memoryType);
+		}
+
+		Allocation allocation;
+		allocation.order = OrderOf(size);
+		allocation.memoryType = memoryType;
+
+		for (auto& block : pool->blocks)
+		{
+			if (block->Allocate(allocation.order, allocation.offset))
+			{
+				allocation.block = block.get();
+				break;
+			}
+		}
+
+		if (allocation.block == nullptr)
+		{
+			// Over the budget, hand back the empty blocks first and then take no more than the resource needs.
+			if (!fitsBudget(heap, pool->blockSize))
+			{
+				releaseEmptyBlocks(heap, false);
+				if (!fitsBudget(heap, pool->blockSize))
+				{
+					return allocateDedicated(request, memoryType);
+				}
+			}
+
+			allocation.block = createBlock(*pool);
+			allocation.block->Allocate(allocation.order, allocation.offset);
+		}
+
+		allocation.memory = allocation.block->memory;
+		allocation.size = request.requirements.size;
+		allocation.mapped = allocation.block->mapped != nullptr ? allocation.block->mapped + allocation.offset : nullptr;
+
+		heaps_[heap].allocations++;
+		heaps_[heap].usedBytes += NodeSize(allocation.order);
+
+		return allocation;
+	}
+
+	void MemoryAllocator::Free(const Allocation& allocation)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		const uint32_t heap = properties_.memoryTypes[allocation.memoryType].heapIndex;
+
+		if (allocation.block == nullptr)
+		{
+			vkFreeMemory(device_.Handle(), allocation.memory, nullptr);
+			heaps_[heap].dedicatedAllocations--;
+			heaps_[heap].dedicatedBytes -= allocation.size;
+			return;
+		}
+
+		allocation.block->Free(allocation.offset, allocation.order);
+		heaps_[heap].allocations--;
+		heaps_[heap].usedBytes -= NodeSize(allocation.order);
+
+		// One empty block per pool is kept, resizing frees and allocates the same sizes right after another.
+		if (allocation.block->allocations == 0)
+		{
+			releaseEmptyBlocks(heap, true);
+		}
+	}
+
+	std::vector<MemoryAllocator::HeapStatistics> MemoryAllocator::Statistics() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		std::vector<HeapStatistics> heaps = heaps_;
+		const auto budget = queryBudget();
+
+		for (uint32_t i = 0; i != heaps.size(); ++i)
+		{
+			heaps[i].budget = budgetSupported_ ? budget.heapBudget[i] : heaps[i].size;
+			heaps[i].usage = budgetSupported_ ? budget.heapUsage[i] : heaps[i].blockBytes + heaps[i].dedicatedBytes;
+		}
+
+		return heaps;
+	}
+
+	uint32_t MemoryAllocator::findMemoryType(const uint32_t typeFilter, const VkMemoryPropertyFlags propertyFlags) const
+	{
+		for (uint32_t i = 0; i != properties_.memoryTypeCount; ++i)
+		{
+			if ((typeFilter & (1 << i)) && (properties_.memoryTypes[i].propertyFlags & propertyFlags) == propertyFlags)
+			{
+				return i;
+			}
+		}
+
+		throw std::runtime_error("failed to find suitable memory type");
+	}
+
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT MemoryAllocator::queryBudget() const
+	{
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = {};
+		budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+		if (budgetSupported_)
+		{
+			VkPhysicalDeviceMemoryProperties2 properties = {};
+			properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+			properties.pNext = &budget;
+			vkGetPhysicalDeviceMemoryProperties2(device_.PhysicalDevice(), &properties);
+			budget.pNext = nullptr;
+		}
+
+		return budget;
+	}
+
+	bool MemoryAllocator::fitsBudget(const uint32_t heap, const VkDeviceSize size) const
+	{
+		if (!budgetSupported_)
+		{
+			return true;
+		}
+
+		const auto budget = queryBudget();
+		return budget.heapUsage[heap] + size <= budget.heapBudget[heap];
+	}
+
+	MemoryAllocator::Allocation MemoryAllocator::allocateDedicated(const Request& request, const uint32_t memoryType)
+	{
+		const uint32_t heap = properties_.memoryTypes[memoryType].heapIndex;
+
+		Allocation allocation;
+		allocation.memory = allocateMemory(memoryType, request.requirements.size, request.allocateFlags, &request, allocation.mapped);
+		allocation.size = request.requirements.size;
+		allocation.memoryType = memoryType;
+
+		heaps_[heap].dedicatedAllocations++;
+		heaps_[heap].dedicatedBytes += allocation.size;
+
+		return allocation;
+	}
+
+	MemoryAllocator::Block* MemoryAllocator::createBlock(Pool& pool)
+	{
+		std::unique_ptr<Block> block(new Block{ nullptr, nullptr, 0, {} });
+		block->memory = allocateMemory(pool.memoryType, pool.blockSize, pool.allocateFlags, nullptr, block->mapped);
+		block->free.resize(OrderOf(pool.blockSize) + 1);
+		block->free.back().insert(0);
+
+		const uint32_t heap = properties_.memoryTypes[pool.memoryType].heapIndex;
+		heaps_[heap].blocks++;
+		heaps_[heap].blockBytes += pool.blockSize;
+
+		pool.blocks.push_back(std::move(block));
+		return pool.blocks.back().get();
+	}
+
+	void MemoryAllocator::releaseEmptyBlocks(const uint32_t heap, const bool keepOne)
+	{
+		for (auto& entry : pools_)
+		{
+			Pool& pool = *entry.second;
+			if (properties_.memoryTypes[pool.memoryType].heapIndex != heap)
+			{
+				continue;
+			}
+
+			bool kept = !keepOne;
+			auto& blocks = pool.blocks;
+			blocks.erase(std::remove_if(blocks.begin(), blocks.end(), [&](const std::unique_ptr<Block>& block)
+			{
+				if (block->allocations != 0)
+				{
+					return false;
+				}
+
+				if (!kept)
+				{
+					kept = true;
+					return false;
+				}
+
+				vkFreeMemory(device_.Handle(), block->memory, nullptr);
+				heaps_[heap].blocks--;
+				heaps_[heap].blockBytes -= pool.blockSize;
+				return true;
+			}), blocks.end());
+		}
+	}
+
+	VkDeviceMemory MemoryAllocator::allocateMemory(
+		const uint32_t memoryType,
+		const VkDeviceSize size,
+		const VkMemoryAllocateFlags allocateFlags,
+		const Request* const dedicated,
+		uint8_t*& mapped)
+	{
+		VkMemoryDedicatedAllocateInfo dedicatedInfo = {};
+		dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+		dedicatedInfo.buffer = dedicated != nullptr ? dedicated->buffer : nullptr;
+		dedicatedInfo.image = dedicated != nullptr ? dedicated->image : nullptr;
+
+		VkMemoryAllocateFlagsInfo flagsInfo = {};
+		flagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+		flagsInfo.pNext = dedicated != nullptr ? &dedicatedInfo : nullptr;
+		flagsInfo.flags = allocateFlags;
+
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.pNext = &flagsInfo;
+		allocInfo.allocationSize = size;
+		allocInfo.memoryTypeIndex = memoryType;
+
+		VkDeviceMemory memory;
+		Check(vkAllocateMemory(device_.Handle(), &allocInfo, nullptr, &memory),
+			"allocate memory");
+
+		// Mapped for as long as it lives, vkFreeMemory unmaps it.
+		mapped = nullptr;
+		if (properties_.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			void* data;
+			Check(vkMapMemory(device_.Handle(), memory, 0, VK_WHOLE_SIZE, 0, &data),
+				"map memory");
+			mapped = static_cast<uint8_t*>(data);
+		}
+
+		return memory;
+	}
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Vulkan.hpp"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+namespace Vulkan
+{
+	class Device;
+
+	// Sub-allocates device memory. Every memory type gets pools of large blocks, and a buddy allocator places the
+	// resources in them, so a scene costs a handful of vkAllocateMemory calls rather than one per resource.
+	// Resources the driver wants on their own, or that would take up most of a block, get a dedicated allocation.
+	// Host visible memory is mapped once and stays mapped. With VK_EXT_memory_budget, new blocks are not allocated
+	// past the heap budget.
+	class MemoryAllocator final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(MemoryAllocator)
+
+		struct Block;
+
+		struct Request
+		{
+			VkMemoryRequirements requirements{};
+			VkMemoryAllocateFlags allocateFlags{};
+			VkMemoryPropertyFlags propertyFlags{};
+			// Buffers and linear images are kept apart from optimal images, so bufferImageGranularity never applies.
+			bool linear{};
+			// The driver prefers or requires the resource in an allocation of its own.
+			bool dedicated{};
+			// The resource, for VkMemoryDedicatedAllocateInfo.
+			VkBuffer buffer{};
+			VkImage image{};
+		};
+
+		struct Allocation
+		{
+			VkDeviceMemory memory{};
+			VkDeviceSize offset{};
+			VkDeviceSize size{};
+			uint8_t* mapped{}; // at offset, nullptr when not host visible
+			Block* block{}; // nullptr for dedicated allocations
+			uint32_t order{};
+			uint32_t memoryType{};
+		};
+
+		struct HeapStatistics
+		{
+			bool deviceLocal;
+			VkDeviceSize size;
+			VkDeviceSize budget; // the heap size without VK_EXT_memory_budget
+			VkDeviceSize usage; // of every process with VK_EXT_memory_budget, of ours alone without it
+			VkDeviceSize blockBytes;
+			VkDeviceSize usedBytes; // of the blocks, with the buddy rounding
+			VkDeviceSize dedicatedBytes;
+			uint32_t blocks;
+			uint32_t allocations; // placed in blocks
+			uint32_t dedicatedAllocations;
+		};
+
+		explicit MemoryAllocator(const Device& device);
+		~MemoryAllocator();
+
+		Allocation Allocate(const Request& request);
+		void Free(const Allocation& allocation);
+
+		bool BudgetSupported() const { return budgetSupported_; }
+		std::vector<HeapStatistics> Statistics() const;
+
+	private:
+
+		struct Pool;
+
+		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags propertyFlags) const;
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT queryBudget() const;
+		bool fitsBudget(uint32_t heap, VkDeviceSize size) const;
+
+		Allocation allocateDedicated(const Request& request, uint32_t memoryType);
+		Block* createBlock(Pool& pool);
+		void releaseEmptyBlocks(uint32_t heap, bool keepOne);
+		VkDeviceMemory allocateMemory(uint32_t memoryType, VkDeviceSize size, VkMemoryAllocateFlags allocateFlags, const Request* dedicated, uint8_t*& mapped);
+
+		const class Device& device_;
+		VkPhysicalDeviceMemoryProperties properties_{};
+		bool budgetSupported_{};
+
+		mutable std::mutex mutex_;
+		std::map<std::tuple<uint32_t, VkMemoryAllocateFlags, bool>, std::unique_ptr<Pool>> pools_;
+		std::vector<HeapStatistics> heaps_;
+	};
+
+}
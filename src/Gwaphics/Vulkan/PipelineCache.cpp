@@ -0,0 +1,164 @@
+#include "PipelineCache.hpp"
+#include "Device.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace Vulkan {
+
+namespace
+{
+	// Written ahead of the driver's blob. Drivers are meant to reject foreign data themselves but not all do,
+	// so nothing reaches them unless device and driver match.
+	struct FileHeader
+	{
+		char magic[4];
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t deviceUUID[VK_UUID_SIZE];
+		uint8_t driverUUID[VK_UUID_SIZE];
+		uint64_t dataSize;
+	};
+
+	const char Magic[4] = { 'T', 'T', 'P', 'C' };
+
+	FileHeader DeviceHeader(VkPhysicalDevice physicalDevice)
+	{
+		VkPhysicalDeviceIDProperties idProperties = {};
+		idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+		VkPhysicalDeviceProperties2 properties = {};
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties.pNext = &idProperties;
+		vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+		FileHeader header = {};
+		std::memcpy(header.magic, Magic, sizeof(Magic));
+		header.vendorID = properties.properties.vendorID;
+		header.deviceID = properties.properties.deviceID;
+		header.driverVersion = properties.properties.driverVersion;
+		std::memcpy(header.deviceUUID, idProperties.deviceUUID, VK_UUID_SIZE);
+		std::memcpy(header.driverUUID, idProperties.driverUUID, VK_UUID_SIZE);
+		return header;
+	}
+
+	bool SameDevice(const FileHeader& a, const FileHeader& b)
+	{
+		return std::memcmp(a.magic, b.magic, sizeof(a.magic)) == 0 &&
+			a.vendorID == b.vendorID &&
+			a.deviceID == b.deviceID &&
+			a.driverVersion == b.driverVersion &&
+			std::memcmp(a.deviceUUID, b.deviceUUID, VK_UUID_SIZE) == 0 &&
+			std::memcmp(a.driverUUID, b.driverUUID, VK_UUID_SIZE) == 0;
+	}
+
+	// The driver's own header, checked against the cache UUID it reports now.
+	bool ValidBlob(VkPhysicalDevice physicalDevice, const std::vector<char>& data)
+	{
+		VkPipelineCacheHeaderVersionOne header;
+		if (data.size() < sizeof(header))
+		{
+			return false;
+		}
+		std::memcpy(&header, data.data(), sizeof(header));
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		return header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			header.vendorID == properties.vendorID &&
+			header.deviceID == properties.deviceID &&
+			std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+
+	std::vector<char> LoadBlob(VkPhysicalDevice physicalDevice, const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		FileHeader header;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || !SameDevice(header, DeviceHeader(physicalDevice)))
+		{
+			return {};
+		}
+
+		// A damaged file can claim any size, it has to fit in what is left of the file.
+		const std::streamoff start = file.tellg();
+		file.seekg(0, std::ios::end);
+		const std::streamoff remaining = file.tellg() - start;
+		file.seekg(start);
+		if (!file || remaining < 0 || header.dataSize > static_cast<uint64_t>(remaining))
+		{
+			return {};
+		}
+
+		std::vector<char> data(static_cast<size_t>(header.dataSize));
+		if (!file.read(data.data(), static_cast<std::streamsize>(data.size())) || !ValidBlob(physicalDevice, data))
+		{
+			return {};
+		}
+
+		return data;
+	}
+}
+
+PipelineCache::PipelineCache(const class Device& device, std::string path) :
+	device_(device),
+	path_(std::move(path))
+{
+	const std::vector<char> data = LoadBlob(device.PhysicalDevice(), path_);
+	warm_ = !data.empty();
+
+	VkPipelineCacheCreateInfo cacheInfo = {};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = data.size();
+	cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	Check(vkCreatePipelineCache(device.Handle(), &cacheInfo, nullptr, &pipelineCache_),
+		"create pipeline cache");
+
+	std::cout << "Pipeline cache: " << (warm_ ? "loaded " + std::to_string(data.size()) + " bytes from '" + path_ + "'" : std::string("cold start")) << std::endl;
+}
+
+PipelineCache::~PipelineCache()
+{
+	if (pipelineCache_ != nullptr)
+	{
+		vkDestroyPipelineCache(device_.Handle(), pipelineCache_, nullptr);
+		pipelineCache_ = nullptr;
+	}
+}
+
+void PipelineCache::Save() const
+{
+	size_t size = 0;
+	Check(vkGetPipelineCacheData(device_.Handle(), pipelineCache_, &size, nullptr),
+		"get pipeline cache size");
+
+	std::vector<char> data(size);
+	Check(vkGetPipelineCacheData(device_.Handle(), pipelineCache_, &size, data.data()),
+		"get pipeline cache data");
+	data.resize(size);
+
+	FileHeader header = DeviceHeader(device_.PhysicalDevice());
+	header.dataSize = data.size();
+
+	// Written next to the old file and renamed over it, an interrupted save leaves the old one intact.
+	const std::string temporary = path_ + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(data.data(), static_cast<std::streamsize>(data.size()));
+		if (!file)
+		{
+			throw std::runtime_error("failed to write '" + temporary + "'");
+		}
+	}
+
+	std::filesystem::rename(temporary, path_);
+}
+
+}
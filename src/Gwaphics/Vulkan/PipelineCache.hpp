@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Vulkan.hpp"
+#include <string>
+
+namespace Vulkan
+{
+	class Device;
+
+	// Driver compiled pipelines kept across runs. Starts from the blob saved at the given path if it was written
+	// by the same device and driver, otherwise empty. Pass Handle() to every pipeline creation.
+	class PipelineCache final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(PipelineCache)
+
+		PipelineCache(const Device& device, std::string path);
+		~PipelineCache();
+
+		const class Device& Device() const { return device_; }
+		// Whether the cache started from a saved blob.
+		bool Warm() const { return warm_; }
+
+		// Replaces the file with everything compiled so far.
+		void Save() const;
+
+	private:
+
+		const class Device& device_;
+		const std::string path_;
+		bool warm_{};
+
+		VULKAN_HANDLE(VkPipelineCache, pipelineCache_)
+	};
+
+}
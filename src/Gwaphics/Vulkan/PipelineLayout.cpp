@@ -4,7 +4,7 @@
 
 namespace Vulkan {
 
-PipelineLayout::PipelineLayout(const Device & device, const std::vector<VkDescriptorSetLayout> descriptorSetLayouts) :
+PipelineLayout::PipelineLayout(const Device & device, const std::vector<VkDescriptorSetLayout> descriptorSetLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges) :
 	device_(device)
 {
 	/*std::vector<VkDescriptorSetLayout> descriptorSetLayouts_;
@@ -18,8 +18,8 @@ PipelineLayout::PipelineLayout(const Device & device, const std::vector<VkDescri
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
 	pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-	pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-	pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
+	pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+	pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
 
 	Check(vkCreatePipelineLayout(device_.Handle(), &pipelineLayoutInfo, nullptr, &pipelineLayout_),
 		"create pipeline layout");
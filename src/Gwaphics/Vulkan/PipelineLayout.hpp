@@ -13,7 +13,7 @@ namespace Vulkan
 
 		VULKAN_NON_COPIABLE(PipelineLayout)
 
-		PipelineLayout(const Device& device, const std::vector<VkDescriptorSetLayout> descriptorSetLayouts);
+		PipelineLayout(const Device& device, const std::vector<VkDescriptorSetLayout> descriptorSetLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges = {});
 		~PipelineLayout();
 
 	private:
@@ -0,0 +1,53 @@
+#include "QueryPool.hpp"
+#include "Device.hpp"
+
+namespace Vulkan {
+
+QueryPool::QueryPool(const class Device& device, const VkQueryType type, const uint32_t queryCount, const VkQueryPipelineStatisticFlags pipelineStatistics) :
+	device_(device),
+	queryCount_(queryCount)
+{
+	VkQueryPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = type;
+	poolInfo.queryCount = queryCount;
+	poolInfo.pipelineStatistics = pipelineStatistics;
+
+	Check(vkCreateQueryPool(device.Handle(), &poolInfo, nullptr, &queryPool_),
+		"create query pool");
+}
+
+QueryPool::~QueryPool()
+{
+	if (queryPool_ != nullptr)
+	{
+		vkDestroyQueryPool(device_.Handle(), queryPool_, nullptr);
+		queryPool_ = nullptr;
+	}
+}
+
+void QueryPool::Reset(VkCommandBuffer commandBuffer)
+{
+	vkCmdResetQueryPool(commandBuffer, queryPool_, 0, queryCount_);
+}
+
+void QueryPool::Reset(VkCommandBuffer commandBuffer, const uint32_t first, const uint32_t count)
+{
+	vkCmdResetQueryPool(commandBuffer, queryPool_, first, count);
+}
+
+bool QueryPool::GetResults(const uint32_t first, const uint32_t count, std::vector<uint64_t>& results) const
+{
+	results.resize(count);
+	const VkResult result = vkGetQueryPoolResults(device_.Handle(), queryPool_, first, count, count * sizeof(uint64_t), results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+	if (result == VK_NOT_READY)
+	{
+		return false;
+	}
+
+	Check(result, "get query pool results");
+	return true;
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Vulkan.hpp"
+#include <vector>
+
+namespace Vulkan
+{
+	class Device;
+
+	class QueryPool final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(QueryPool)
+
+		// pipelineStatistics only for VK_QUERY_TYPE_PIPELINE_STATISTICS, each query then has a result per statistic.
+		QueryPool(const Device& device, VkQueryType type, uint32_t queryCount, VkQueryPipelineStatisticFlags pipelineStatistics = 0);
+		~QueryPool();
+
+		const class Device& Device() const { return device_; }
+		uint32_t QueryCount() const { return queryCount_; }
+
+		void Reset(VkCommandBuffer commandBuffer);
+		void Reset(VkCommandBuffer commandBuffer, uint32_t first, uint32_t count);
+		// Copies the 64 bit results of queries [first, first + count) without waiting, returns false if any is not available yet.
+		bool GetResults(uint32_t first, uint32_t count, std::vector<uint64_t>& results) const;
+
+	private:
+
+		const class Device& device_;
+		const uint32_t queryCount_;
+
+		VULKAN_HANDLE(VkQueryPool, queryPool_)
+	};
+
+}
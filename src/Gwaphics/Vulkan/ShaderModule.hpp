@@ -20,7 +20,8 @@ namespace Vulkan
 
 		const class Device& Device() const { return device_; }
 
-		VkPipelineShaderStageCreateInfo CreateShaderStage(VkShaderStageFlagBits stage) const;
+		// The specialization info has to outlive pipeline creation.
+		VkPipelineShaderStageCreateInfo CreateShaderStage(VkShaderStageFlagBits stage, const VkSpecializationInfo* specialization = nullptr) const;
 
 	private:
 
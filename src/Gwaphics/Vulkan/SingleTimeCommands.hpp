@@ -31,10 +31,12 @@ namespace Vulkan
 			submitInfo.commandBufferCount = 1;
 			submitInfo.pCommandBuffers = &commandBuffers[0];
 
-			const auto graphicsQueue = commandPool.Device().GraphicsQueue();
+			// on a queue of the family the pool allocates for
+			const auto& device = commandPool.Device();
+			const auto queue = device.Queue(commandPool.QueueFamilyIndex());
 
-			vkQueueSubmit(graphicsQueue, 1, &submitInfo, nullptr);
-			vkQueueWaitIdle(graphicsQueue);
+			vkQueueSubmit(queue, 1, &submitInfo, nullptr);
+			vkQueueWaitIdle(queue);
 		}
 	};
 
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Vulkan.hpp"
+
+namespace Vulkan
+{
+	class Device;
+
+	// A semaphore with a 64 bit counter (Vulkan 1.2 timelineSemaphore feature). Submits signal and wait for
+	// values of the counter, and the host can read it without blocking.
+	class TimelineSemaphore final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(TimelineSemaphore)
+
+		TimelineSemaphore(const Device& device, uint64_t initialValue);
+		~TimelineSemaphore();
+
+		const class Device& Device() const { return device_; }
+
+		uint64_t Value() const;
+		void Wait(uint64_t value, uint64_t timeout) const;
+
+	private:
+
+		const class Device& device_;
+
+		VULKAN_HANDLE(VkSemaphore, semaphore_)
+	};
+
+}
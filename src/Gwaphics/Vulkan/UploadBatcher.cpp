@@ -0,0 +1,143 @@
+#include "UploadBatcher.hpp"
+#include "CommandBuffers.hpp"
+#include "Fence.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace Vulkan
+{
+	namespace
+	{
+		// Staged data starts at multiples of this, copies of whole vectors keep their alignment.
+		const VkDeviceSize StagingAlignment = 16;
+		// The arena is never smaller, most edits fit without growing it.
+		const VkDeviceSize MinArenaSize = 4 * 1024 * 1024;
+	}
+
+	UploadBatcher::UploadBatcher(CommandPool& commandPool) :
+		commandPool_(commandPool),
+		fence_(new Fence(commandPool.Device(), false))
+	{
+	}
+
+	UploadBatcher::~UploadBatcher()
+	{
+		if (arenaMemory_)
+		{
+			arenaMemory_->Unmap();
+		}
+
+		arena_.reset();
+		arenaMemory_.reset();
+		fence_.reset();
+	}
+
+	void UploadBatcher::Upload(const Buffer& buffer, const VkDeviceSize offset, const void* const data, const VkDeviceSize size)
+	{
+		if (size == 0)
+		{
+			return;
+		}
+
+		const VkDeviceSize stagingOffset = (used_ + StagingAlignment - 1) / StagingAlignment * StagingAlignment;
+		reserve(stagingOffset + size);
+		std::memcpy(arenaData_ + stagingOffset, data, static_cast<size_t>(size));
+		used_ = stagingOffset + size;
+
+		Copy copy = {};
+		copy.buffer = buffer.Handle();
+		copy.region.srcOffset = stagingOffset;
+		copy.region.dstOffset = offset;
+		copy.region.size = size;
+		copies_.push_back(copy);
+	}
+
+	void UploadBatcher::Submit()
+	{
+		if (copies_.empty())
+		{
+			return;
+		}
+
+		CommandBuffers commandBuffers(commandPool_, 1);
+		const VkCommandBuffer commandBuffer = commandBuffers.Begin(0);
+		Record(commandBuffer);
+		commandBuffers.End(0);
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+
+		// on a queue of the family the pool allocates for
+		const auto queue = commandPool_.Device().Queue(commandPool_.QueueFamilyIndex());
+
+		Check(vkQueueSubmit(queue, 1, &submitInfo, fence_->Handle()),
+			"submit upload batch");
+
+		fence_->Wait(UINT64_MAX);
+		fence_->Reset();
+	}
+
+	bool UploadBatcher::Record(VkCommandBuffer commandBuffer)
+	{
+		if (copies_.empty())
+		{
+			return false;
+		}
+
+		// Grouped by destination, in the order staged within each buffer.
+		std::stable_sort(copies_.begin(), copies_.end(), [](const Copy& a, const Copy& b)
+		{
+			return std::less<VkBuffer>()(a.buffer, b.buffer);
+		});
+
+		std::vector<VkBufferCopy> regions;
+		for (size_t first = 0; first != copies_.size();)
+		{
+			size_t last = first;
+			regions.clear();
+			for (; last != copies_.size() && copies_[last].buffer == copies_[first].buffer; ++last)
+			{
+				regions.push_back(copies_[last].region);
+			}
+
+			vkCmdCopyBuffer(commandBuffer, arena_->Handle(), copies_[first].buffer, static_cast<uint32_t>(regions.size()), regions.data());
+			first = last;
+		}
+
+		copies_.clear();
+		used_ = 0;
+		return true;
+	}
+
+	void UploadBatcher::reserve(const VkDeviceSize size)
+	{
+		if (size <= capacity_)
+		{
+			return;
+		}
+
+		// Nothing staged so far has been recorded yet, it moves along to the new arena.
+		const auto& device = commandPool_.Device();
+		const VkDeviceSize capacity = std::max({ size, 2 * capacity_, MinArenaSize });
+
+		std::unique_ptr<Buffer> arena(new Buffer(device, static_cast<size_t>(capacity), VK_BUFFER_USAGE_TRANSFER_SRC_BIT));
+		std::unique_ptr<DeviceMemory> arenaMemory(new DeviceMemory(arena->AllocateMemory(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)));
+		auto* const arenaData = static_cast<uint8_t*>(arenaMemory->Map(0, static_cast<size_t>(capacity)));
+		device.DebugUtils().SetObjectName(arena->Handle(), "Upload Staging Buffer");
+
+		if (arenaMemory_)
+		{
+			std::memcpy(arenaData, arenaData_, static_cast<size_t>(used_));
+			arenaMemory_->Unmap();
+		}
+
+		arena_ = std::move(arena);
+		arenaMemory_ = std::move(arenaMemory);
+		arenaData_ = arenaData;
+		capacity_ = capacity;
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Buffer.hpp"
+#include "CommandPool.hpp"
+#include "Device.hpp"
+#include "DeviceMemory.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Vulkan
+{
+	class Fence;
+
+	// Batches buffer uploads. The data is packed into one persistently mapped staging arena and the copies of a
+	// batch are recorded together, one vkCmdCopyBuffer per destination buffer. Submit runs a batch on its own
+	// with a single submit and a fence, Record adds it to a command buffer of the caller's. The arena only grows
+	// and every batch starts at its beginning again, so a batch has to have finished before the next is staged.
+	class UploadBatcher final
+	{
+	public:
+
+		VULKAN_NON_COPIABLE(UploadBatcher)
+
+		struct Copy
+		{
+			VkBuffer buffer;
+			VkBufferCopy region;
+		};
+
+		explicit UploadBatcher(CommandPool& commandPool);
+		~UploadBatcher();
+
+		// BufferUtil::CreateDeviceBuffer with the copy left to the batch.
+		template <class T>
+		void CreateDeviceBuffer(
+			const char* name,
+			VkBufferUsageFlags usage,
+			const std::vector<T>& content,
+			std::unique_ptr<Buffer>& buffer,
+			std::unique_ptr<DeviceMemory>& memory);
+
+		// Stages size bytes for offset in the buffer. The data is copied right away and can change after the call.
+		void Upload(const Buffer& buffer, VkDeviceSize offset, const void* data, VkDeviceSize size);
+
+		bool Empty() const { return copies_.empty(); }
+		// Bytes staged by the current batch.
+		VkDeviceSize Size() const { return used_; }
+
+		// Submits the batch on a queue of the pool's family and waits for it.
+		void Submit();
+		// Records the batch, the caller orders what reads the buffers after it. False with nothing staged.
+		bool Record(VkCommandBuffer commandBuffer);
+
+		// The copies of the current batch, in staging order.
+		const std::vector<Copy>& Copies() const { return copies_; }
+
+	private:
+
+		void reserve(VkDeviceSize size);
+
+		CommandPool& commandPool_;
+		std::unique_ptr<Fence> fence_;
+
+		std::unique_ptr<Buffer> arena_;
+		std::unique_ptr<DeviceMemory> arenaMemory_;
+		uint8_t* arenaData_{};
+		VkDeviceSize capacity_{};
+		VkDeviceSize used_{};
+		std::vector<Copy> copies_;
+	};
+
+	template <class T>
+	void UploadBatcher::CreateDeviceBuffer(
+		const char* const name,
+		const VkBufferUsageFlags usage,
+		const std::vector<T>& content,
+		std::unique_ptr<Buffer>& buffer,
+		std::unique_ptr<DeviceMemory>& memory)
+	{
+		const auto& device = commandPool_.Device();
+		const auto& debugUtils = device.DebugUtils();
+		const auto contentSize = sizeof(content[0]) * content.size();
+		const VkMemoryAllocateFlags allocateFlags = usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+			? VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT
+			: 0;
+
+		buffer.reset(new Buffer(device, contentSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage));
+		memory.reset(new DeviceMemory(buffer->AllocateMemory(allocateFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)));
+
+		debugUtils.SetObjectName(buffer->Handle(), (name + std::string(" Buffer")).c_str());
+		debugUtils.SetObjectName(memory->Handle(), (name + std::string(" Memory")).c_str());
+
+		Upload(*buffer, 0, content.data(), contentSize);
+	}
+}
@@ -1,15 +1,21 @@
 ﻿
-#include "Gwaphics/Vulkan/Enumerate.hpp"
+#include "Gwaphics/Vulkan/Instance.hpp"
 #include "Gwaphics/Vulkan/Strings.hpp"
 #include "Gwaphics/Vulkan/SwapChain.hpp"
 #include "Gwaphics/Vulkan/Version.hpp"
 #include "Gwaphics/Utilities/Console.hpp"
 #include "Gwaphics/Application.hpp"
+#include "Gwaphics/HeadlessRenderer.hpp"
+#include "Gwaphics/RenderJobs.hpp"
 #include "UserSettings.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
 namespace
 {
@@ -20,6 +26,18 @@ namespace
 	void PrintVulkanDevices(const Vulkan::Application& application);
 	void PrintVulkanSwapChainInformation(const Vulkan::Application& application);
 	void SetVulkanDevice(Vulkan::Application& application);
+
+	struct Arguments
+	{
+		std::string scenePath = "assets/scenes/cornell.scene";
+		bool headless = false;
+		bool compareHalfShading = false; // headless, render with and without half float shading and compare
+		std::string jobs; // file of render jobs, "-" for stdin
+		Vulkan::HeadlessSettings render;
+	};
+
+	Arguments ParseArguments(int argc, const char* argv[]);
+	void RunRenderJobs(const Arguments& arguments, bool enableValidationLayers);
 }
 
 int main(int argc, const char* argv[]) noexcept
@@ -42,7 +60,33 @@ int main(int argc, const char* argv[]) noexcept
 		#else
 					false;
 		#endif
-		Vulkan::Application application(windowConfig, VkPresentModeKHR::VK_PRESENT_MODE_MAILBOX_KHR, EnableValidationLayers);
+		const Arguments arguments = ParseArguments(argc, argv);
+		if (!arguments.jobs.empty())
+		{
+			PrintVulkanSdkInformation();
+			RunRenderJobs(arguments, EnableValidationLayers);
+
+			return EXIT_SUCCESS;
+		}
+
+		if (arguments.headless)
+		{
+			PrintVulkanSdkInformation();
+
+			Vulkan::HeadlessRenderer renderer(EnableValidationLayers, arguments.scenePath);
+			if (arguments.compareHalfShading)
+			{
+				renderer.CompareHalfShading(arguments.render);
+			}
+			else
+			{
+				renderer.Render(arguments.render);
+			}
+
+			return EXIT_SUCCESS;
+		}
+
+		Vulkan::Application application(windowConfig, VkPresentModeKHR::VK_PRESENT_MODE_MAILBOX_KHR, EnableValidationLayers, arguments.scenePath);
 
 		PrintVulkanSdkInformation();
 		//PrintVulkanInstanceInformation(application);
@@ -69,6 +113,158 @@ int main(int argc, const char* argv[]) noexcept
 namespace
 {
 
+	// Usage: [scene] [--headless output.png|.hdr|.exr | --jobs file|-] [--spp N] [--time seconds] [--size WxH]
+	//        [--tracer megakernel|wavefront] [--preset reference|preview|diffuse] [--ray-query]
+	//        [--visibility-buffer] [--subgroup-traversal] [--half-shading | --compare-half-shading]
+	// Without --headless or --jobs the other options are ignored and the scene opens in the window. With --jobs
+	// they are the defaults of every job. --compare-half-shading renders the --headless image twice, with and
+	// without half float shading, and reports the difference.
+	Arguments ParseArguments(const int argc, const char* argv[])
+	{
+		Arguments arguments;
+		bool samplesGiven = false;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string argument = argv[i];
+			const auto value = [&]() -> std::string
+			{
+				if (i + 1 >= argc)
+				{
+					throw std::invalid_argument("missing value for " + argument);
+				}
+				return argv[++i];
+			};
+
+			if (argument == "--headless")
+			{
+				arguments.headless = true;
+				arguments.render.output = value();
+			}
+			else if (argument == "--jobs")
+			{
+				arguments.jobs = value();
+			}
+			else if (argument == "--spp")
+			{
+				arguments.render.samples = static_cast<uint32_t>(std::stoul(value()));
+				samplesGiven = true;
+			}
+			else if (argument == "--time")
+			{
+				arguments.render.timeBudget = std::stod(value());
+			}
+			else if (argument == "--size")
+			{
+				const std::string size = value();
+				const auto x = size.find('x');
+				if (x == std::string::npos)
+				{
+					throw std::invalid_argument("expected --size WIDTHxHEIGHT, got '" + size + "'");
+				}
+				arguments.render.width = static_cast<uint32_t>(std::stoul(size.substr(0, x)));
+				arguments.render.height = static_cast<uint32_t>(std::stoul(size.substr(x + 1)));
+			}
+			else if (argument == "--tracer")
+			{
+				const std::string tracer = value();
+				if (tracer == "megakernel") arguments.render.mode = Vulkan::TracerMode::Megakernel;
+				else if (tracer == "wavefront") arguments.render.mode = Vulkan::TracerMode::Wavefront;
+				else throw std::invalid_argument("unknown tracer '" + tracer + "'");
+			}
+			else if (argument == "--preset")
+			{
+				const std::string preset = value();
+				if (preset == "reference") arguments.render.preset = Vulkan::TracerPreset::Reference;
+				else if (preset == "preview") arguments.render.preset = Vulkan::TracerPreset::Preview;
+				else if (preset == "diffuse") arguments.render.preset = Vulkan::TracerPreset::DiffuseOnly;
+				else throw std::invalid_argument("unknown preset '" + preset + "'");
+			}
+			else if (argument == "--ray-query")
+			{
+				arguments.render.rayQuery = true;
+			}
+			else if (argument == "--visibility-buffer")
+			{
+				arguments.render.visibilityBuffer = true;
+			}
+			else if (argument == "--subgroup-traversal")
+			{
+				arguments.render.subgroupTraversal = true;
+			}
+			else if (argument == "--half-shading")
+			{
+				arguments.render.halfShading = true;
+			}
+			else if (argument == "--compare-half-shading")
+			{
+				arguments.compareHalfShading = true;
+			}
+			else if (argument.rfind("--", 0) == 0)
+			{
+				throw std::invalid_argument("unknown option " + argument);
+			}
+			else
+			{
+				arguments.scenePath = argument;
+			}
+		}
+
+		// a time budget alone renders until it runs out
+		if (arguments.render.timeBudget > 0.0 && !samplesGiven)
+		{
+			arguments.render.samples = 0;
+		}
+
+		if (arguments.render.width == 0 || arguments.render.height == 0)
+		{
+			throw std::invalid_argument("the image size must not be empty");
+		}
+
+		return arguments;
+	}
+
+	// Renders the jobs one after another on one renderer, only the first pays for loading the scene, building
+	// its BVH and compiling the pipelines.
+	void RunRenderJobs(const Arguments& arguments, const bool enableValidationLayers)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		Vulkan::HeadlessRenderer renderer(enableValidationLayers, arguments.scenePath);
+		const std::chrono::duration<double> setupTime = std::chrono::steady_clock::now() - start;
+		std::cout << "Scene ready in " << setupTime.count() << " s" << std::endl;
+
+		std::ifstream file;
+		if (arguments.jobs != "-")
+		{
+			file.open(arguments.jobs);
+			if (!file)
+			{
+				throw std::runtime_error("failed to open job file '" + arguments.jobs + "'");
+			}
+		}
+
+		Vulkan::HeadlessSettings defaults = arguments.render;
+		defaults.camera = renderer.SceneCamera();
+
+		Vulkan::RenderJobReader reader(arguments.jobs == "-" ? std::cin : file, arguments.jobs == "-" ? "stdin" : arguments.jobs, defaults);
+		Vulkan::HeadlessSettings job;
+		uint32_t jobs = 0;
+		while (reader.Next(job))
+		{
+			renderer.Render(job);
+			++jobs;
+		}
+
+		const std::chrono::duration<double> totalTime = std::chrono::steady_clock::now() - start;
+		const double renderTime = totalTime.count() - setupTime.count();
+		std::cout << jobs << " jobs in " << totalTime.count() << " s (" << setupTime.count() << " s setup)";
+		if (jobs != 0 && renderTime > 0.0)
+		{
+			std::cout << ", " << jobs * 3600.0 / renderTime << " jobs per hour";
+		}
+		std::cout << std::endl;
+	}
+
 	void PrintVulkanSdkInformation()
 	{
 		std::cout << "Vulkan SDK Header Version: " << VK_HEADER_VERSION << std::endl;
@@ -150,54 +346,15 @@ namespace
 
 	void SetVulkanDevice(Vulkan::Application& application)
 	{
-		const auto& physicalDevices = application.PhysicalDevices();
-		const auto result = std::find_if(physicalDevices.begin(), physicalDevices.end(), [](const VkPhysicalDevice& device)
-			{
-				// We want a device with geometry shader support.
-				VkPhysicalDeviceFeatures deviceFeatures;
-		vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
-		VkPhysicalDeviceProperties properties{};
-		vkGetPhysicalDeviceProperties(device, &properties);
-		return (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU);
-		//if (!deviceFeatures.geometryShader)
-		//{
-		//	return false;
-		//}
-
-		// We want a device that supports the ray tracing extension.
-		const auto extensions = Vulkan::GetEnumerateVector(device, static_cast<const char*>(nullptr), vkEnumerateDeviceExtensionProperties);
-		/*const auto hasRayTracing = std::find_if(extensions.begin(), extensions.end(), [](const VkExtensionProperties& extension)
-			{
-				return strcmp(extension.extensionName, VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME) == 0;
-			});
-
-		if (hasRayTracing == extensions.end())
-		{
-			return false;
-		}*/
-
-		// We want a device with a graphics queue.
-		const auto queueFamilies = Vulkan::GetEnumerateVector(device, vkGetPhysicalDeviceQueueFamilyProperties);
-		const auto hasGraphicsQueue = std::find_if(queueFamilies.begin(), queueFamilies.end(), [](const VkQueueFamilyProperties& queueFamily)
-			{
-				return queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
-			});
-
-		return hasGraphicsQueue != queueFamilies.end();
-			});
-
-		if (result == physicalDevices.end())
-		{
-			throw(std::runtime_error("cannot find a suitable device"));
-		}
+		const VkPhysicalDevice physicalDevice = Vulkan::ChoosePhysicalDevice(application.PhysicalDevices());
 
 		/*VkPhysicalDeviceProperties2 deviceProp{};
 		deviceProp.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
-		vkGetPhysicalDeviceProperties2(*result, &deviceProp);
+		vkGetPhysicalDeviceProperties2(physicalDevice, &deviceProp);
 
 		std::cout << "Setting Device [" << deviceProp.properties.deviceID << "]:" << std::endl;*/
 
-		application.SetPhysicalDevice(*result);
+		application.SetPhysicalDevice(physicalDevice);
 
 		std::cout << std::endl;
 	}